@@ -5,8 +5,17 @@
 #include <cstdlib>
 #include <ctime>
 #include <fstream>
+#include <thread>
 
 #include <gegelati.h>
+
+#include "../database/PackedCUDatabase.h"
+#include "../database/ParallelTargetsLoader.h"
+#include "../database/TargetStore.h"
+#include "../evaluation/ConfusionMatrix.h"
+#include "../evaluation/ParallelValidation.h"
+#include "../evaluation/PhaseTimers.h"
+#include "../instructions/IntegralImageHandler.h"
 /**
 * \brief Heritage of the LearningEnvironment Interface
 * This class defines the environment for a binary TPG interacting with a database
@@ -23,6 +32,18 @@ private:
     * \brief Randomness control
     **/
     Mutator::RNG rng;
+    /**
+    * \brief Seed for randomness control, the targets are drawn from it (Cf. loadTargets())
+    **/
+    size_t seed;
+    /**
+    * \brief Number of threads loading the targets (Cf. ParallelTargetsLoader) and evaluating the validation targets (Cf. ParallelValidation)
+    **/
+    size_t nbLoadingThreads;
+    /**
+    * \brief Confusion matrix of the last evaluated root (Cf. getConfusionMatrix())
+    **/
+    ConfusionMatrixCache confusionMatrixCache;
 
     /**
     * \brief Available actions for the LearningAgent.
@@ -49,16 +70,26 @@ private:
     /**
     * \brief Current LearningMode of the LearningEnvironment.
     * Either TRAINING, either VALIDATION, switch set of preloaded targets
-    * (TRAINING : trainingTargetsCU, VALIDATION : validationTargetsCU)
+    * (TRAINING : trainingTargets, VALIDATION : validationTargets)
     */
     Learn::LearningMode currentMode;
 
     /**
     * \brief Current State of the environment
-    * Vector containing all pixels of the current CU
-    * CU are 32x32 => 1024 values
+    * Wrapper on the pixels of the current CU (32x32 => 1024 values), pointing on one of the preloaded targets :
+    * loading the next CU only swaps the wrapped pointer, no pixel is copied.
     */
-    Data::PrimitiveTypeArray2D<uint8_t> currentCU;
+    Data::Array2DWrapper<uint8_t> currentCU;
+
+    /**
+    * \brief True if the integral images of the current CU are a data source of the environment (Cf. setIntegralImages())
+    */
+    bool integralImages;
+
+    /**
+    * \brief Integral images of the current CU, rebuilt when a CU is loaded if integralImages is set
+    */
+    IntegralImageHandler currentCUSums;
 
     /**
     * \brief Optimal split for the current CU extract from the .bin file
@@ -88,15 +119,15 @@ public:
 
     // ********************************************* TRAINING Arguments *********************************************
     /**
-    * \brief Vector of CU datas
-    * This vector contains ${NB_TRAINING_TARGETS} elements and is updated every ${NB_GENERATION_BEFORE_TARGETS_CHANGE}
+    * \brief Snapshot of the CU datas and their optimal split, shared with the clones
+    * This snapshot contains ${NB_TRAINING_TARGETS} elements and is replaced every ${NB_GENERATION_BEFORE_TARGETS_CHANGE}
+    * (the clones still using the previous one keep it alive)
     */
-    static std::vector<Data::PrimitiveTypeArray2D<uint8_t> *> *trainingTargetsCU;
+    TargetSnapshot<uint8_t> trainingTargets;
     /**
-    * \brief Vector of CU optimal split
-    * This vector contains ${NB_TRAINING_TARGETS} elements and is updated every ${NB_GENERATION_BEFORE_TARGETS_CHANGE}
+    * \brief Training targets replaced by the last change, their rows are refilled by the next one (Cf. TargetStore::recycle())
     */
-    static std::vector<uint8_t> *trainingTargetsOptimalSplits;
+    TargetSnapshot<uint8_t> retiredTrainingTargets;
     /**
     * \brief Index of the actual loaded CU for training
     */
@@ -104,15 +135,10 @@ public:
 
     // ********************************************* VALIDATION Arguments *********************************************
     /**
-    * \brief Vector of validation CU datas
-    * This vector contains ${NB_VALIDATION_TARGETS} elements and is loaded once at training beginning
+    * \brief Snapshot of the validation CU datas and their optimal split, shared with the clones
+    * This snapshot contains ${NB_VALIDATION_TARGETS} elements and is loaded once at training beginning
     */
-    static std::vector<Data::PrimitiveTypeArray2D<uint8_t>*> *validationTargetsCU;
-    /**
-    * \brief Vector of validation CU optimal split
-    * This vector contains ${NB_VALIDATION_TARGETS} elements and is loaded once at training beginning
-    */
-    static std::vector<uint8_t> *validationTargetsOptimalSplits;
+    TargetSnapshot<uint8_t> validationTargets;
     /**
     * \brief Index of the actual loaded CU for validation
     */
@@ -132,30 +158,62 @@ public:
     BinaryDefaultEnv(std::vector<uint64_t> actions, int speAct, const uint64_t nbTrainingElements, const uint64_t nbTrainingTargets, const uint64_t nbGeneTargetChange, const uint64_t nbValidationTarget, size_t seed)
             : LearningEnvironment(NB_ACTIONS),
               rng(seed),
+              seed(seed),
+              nbLoadingThreads(std::thread::hardware_concurrency()),
               availableActions(actions),
               specializedAction(speAct),
               score(0.0),
               currentMode(Learn::LearningMode::TRAINING),
-              currentCU(32, 32),    // 2D Array
+              currentCU(32, 32, nullptr),    // 2D Array, pointer set in LoadNextCU()
+              integralImages(false),
+              currentCUSums(32, 32),
               optimal_split(6),           // Unexisting split
               NB_TRAINING_ELEMENTS(nbTrainingElements),
               NB_TRAINING_TARGETS(nbTrainingTargets),
               NB_GENERATION_BEFORE_TARGETS_CHANGE(nbGeneTargetChange),
               NB_VALIDATION_TARGETS(nbValidationTarget),
+              trainingTargets(std::make_shared<TargetStore<uint8_t>>(32 * 32)),    // Empty until UpdatingTargets()
               actualTrainingCU(0),
+              validationTargets(std::make_shared<TargetStore<uint8_t>>(32 * 32)),
               actualValidationCU(0) {}
 
     // ********************************************* SPECIAL FUNCTIONS *********************************************
 
     /**
      * \brief Opens, reads and stores a random CU file in the database
-     * CU datas are returned and the corresponding split is stored in the mode vector)
+     * CU datas and the corresponding split are set in the given store
      *
-     * \param[in] index the index where the loaded CU will be stored
-     * \param[in] mode the LearningMode : store either in validationTargetsOptimalSplits or trainingTargetsOptimalSplits
-     * \return a PrimitiveTypeArray2D<uint8_t>* containing loaded CU datas
+     * \param[in,out] loaderRng the RNG used to draw the CU file
+     * \param[out] targets the store in which the CU is set
+     * \param[in] idx the index of the target to set
+     * \param[in] current_CU_path the path of the .bin database directory
+     * \return false if the file could not be opened
      */
-    Data::PrimitiveTypeArray2D<uint8_t>* getRandomCU(Learn::LearningMode mode, const char current_CU_path[100]);
+    bool getRandomCU(Mutator::RNG& loaderRng, TargetStore<uint8_t>& targets, uint64_t idx, const char current_CU_path[100]);
+
+    /**
+     * \brief Reads and stores a random CU from a packed database (Cf. PackedCUDatabase)
+     * CU index is drawn exactly as in getRandomCU() and the target is copied at once from the memory-mapped file.
+     *
+     * \param[in,out] loaderRng the RNG used to draw the CU
+     * \param[in] database the packed database (32x32 CUs)
+     * \param[out] targets the store in which the CU is set
+     * \param[in] idx the index of the target to set
+     */
+    bool getRandomCUFromPackedDatabase(Mutator::RNG& loaderRng, const PackedCUDatabase& database, TargetStore<uint8_t>& targets, uint64_t idx);
+
+    /**
+     * \brief Load nbTargets random CUs (packed database file, else .bin files) in the given store, with nbLoadingThreads threads
+     * Each target is drawn from the substream (seed, stream, index) : the loaded targets do not depend on the number of threads.
+     * CUs which could not be read are removed from the store.
+     *
+     * \param[in] stream the set of targets (generation number or ParallelTargetsLoader::VALIDATION_STREAM)
+     * \param[in] nbTargets the number of CUs to load
+     * \param[out] targets the store to fill (its rows are reused)
+     * \param[in] current_CU_path the path of the database (directory of .bin files or packed database file)
+     * \throw std::runtime_error if the packed database does not contain 32x32 CUs
+     */
+    void loadTargets(uint64_t stream, uint64_t nbTargets, TargetStore<uint8_t>& targets, const char current_CU_path[100]);
 
     /**
      * \brief Load the next preloaded CU either for training or for validation (depending on the currentMode)
@@ -165,21 +223,34 @@ public:
     /**
      * \brief Update Training and Validation Targets depending on the generation
      * For the first generation (numGen == 0), load NB_VALIDATION_TARGETS CUs for validation and NB_TRAINING_TARGETS CUs for training
-     * Else every NB_GENERATION_BEFORE_TARGETS_CHANGE, delete old training targets and load NB_TRAINING_TARGETS new CUs.
+     * Else every NB_GENERATION_BEFORE_TARGETS_CHANGE, replace the training targets by NB_TRAINING_TARGETS new CUs
+     * (loaded in the rows of the targets replaced at the previous change if no clone holds them anymore). The current
+     * training targets stay published until the new ones are loaded.
      *
      * \param[in] currentGen The number of the current generation
+     * \param[in] current_CU_path The path of the database (directory of .bin files or packed database file)
      */
     void UpdatingTargets(uint64_t currentGen, const char current_CU_path[100]);
 
     /**
-     * \brief Print the classification table of the best root in a .txt file
+     * \brief Get the confusion matrix of a root on the validation targets
+     * The validation targets are evaluated by nbLoadingThreads threads (Cf. ParallelValidation), unless the root
+     * is the one of the last call (Cf. ConfusionMatrixCache).
      *
      * \param[in] env the Environment
-     * \param[in] bestRoot the root whose classification table will be printed
+     * \param[in] root the evaluated root
+     */
+    const ConfusionMatrix& getConfusionMatrix(const Environment& env, const TPG::TPGVertex* root);
+
+    /**
+     * \brief Print the classification table of the best root in a .txt file
+     *
+     * \param[in] matrix the confusion matrix of the best root (Cf. getConfusionMatrix())
      * \param[in] numGen generation number
      * \param[in] outputFile the name of the destination file
+     * \param[in] readable print the readable table, else the compact (re-usable) line
      */
-    void printClassifStatsTable(const Environment& env, const TPG::TPGVertex* bestRoot, const int numGen, std::string const& outputFile, bool readable);
+    void printClassifStatsTable(const ConfusionMatrix& matrix, const int numGen, std::string const& outputFile, bool readable);
 
     /**
      * \brief Return a string corresponding to the name of the action :
@@ -203,6 +274,16 @@ public:
     Mutator::RNG getRng() const;
 
     // ********************************************* SETTERS *********************************************
+    /**
+     * \brief Setter for nbLoadingThreads (default: number of hardware threads)
+     */
+    void setNbLoadingThreads(size_t nbThreads);
+    /**
+     * \brief Setter for integralImages (default: false)
+     * The integral images are a second data source, for the NxN window instructions (Cf. InstructionSetFactory::getClassificationNames()) :
+     * must be set before the data sources are given to the LearningAgent, TPGs trained with them must be imported with them.
+     */
+    void setIntegralImages(bool enabled);
     /**
      * \brief Setter for currentMode
      */
@@ -210,11 +291,12 @@ public:
     /**
      * \brief Setter for currentCU
      */
-    void setCurrentCu(const Data::PrimitiveTypeArray2D<uint8_t> &currentCu);
+    void setCurrentCu(std::vector<uint8_t> &currentCu);
 
     // ********************************************* LearningEnvironment *********************************************
     /**
     * \brief Get a copy of the LearningEnvironment (Default implementation returns a null pointer)
+    * The copy shares the target snapshots of this environment, no target is copied.
     * \return a copy of the LearningEnvironment if it is copyable, otherwise this method returns a NULL pointer.
     */
     LearningEnvironment *clone() const;
@@ -5,10 +5,20 @@
 #include <cstdlib>
 #include <ctime>
 #include <fstream>
+#include <thread>
 #include <vector>
 
 #include <gegelati.h>
 
+#include "../database/PackedCUDatabase.h"
+#include "../database/ParallelTargetsLoader.h"
+#include "../database/TargetStore.h"
+#include "../database/TargetsPrefetcher.h"
+#include "../evaluation/ConfusionMatrix.h"
+#include "../evaluation/ParallelValidation.h"
+#include "../evaluation/PhaseTimers.h"
+#include "../instructions/IntegralImageHandler.h"
+
 class ClassEnv : public Learn::ClassificationLearningEnvironment {
 private:
 
@@ -22,6 +32,10 @@ private:
     Mutator::RNG rng;
     /// Seed for randomness control
     size_t seed;
+    /// Number of threads loading the targets (Cf. ParallelTargetsLoader) and evaluating the validation targets (Cf. ParallelValidation)
+    size_t nbLoadingThreads;
+    /// Confusion matrix of the last evaluated root (Cf. getConfusionMatrix())
+    ConfusionMatrixCache confusionMatrixCache;
 
     /**
     * \brief Available actions for the LearningAgent.
@@ -40,16 +54,22 @@ private:
     /**
     * \brief Current LearningMode of the LearningEnvironment.
     * Either TRAINING, either VALIDATION, switch set of preloaded targets
-    * (TRAINING : trainingTargetsCU, VALIDATION : validationTargetsCU)
+    * (TRAINING : trainingTargets, VALIDATION : validationTargets)
     */
     Learn::LearningMode currentMode;
 
     /**
     * \brief Current State of the environment
-    * Vector containing all pixels of the current CU
-    * CU are 32x32 => 1024 values
+    * Wrapper on the pixels of the current CU (32x32 => 1024 values), pointing on one of the preloaded targets :
+    * loading the next CU only swaps the wrapped pointer, no pixel is copied.
+    */
+    Data::Array2DWrapper<uint8_t> currentCU;
+
+    /**
+    * \brief Integral images of the current CU, rebuilt in LoadNextCU()
+    * Second data source of the environment : the NxN window instructions read their sums in O(1) (Cf. IntegralImageHandler).
     */
-    Data::PrimitiveTypeArray2D<uint8_t> currentCU;
+    IntegralImageHandler currentCUSums;
 
     // ---------- Intern Variables ----------
     // Optimal split for the current CU extract from the .bin file
@@ -57,6 +77,17 @@ private:
 
     void LoadNextCU();
 
+    /**
+    * \brief Load nbTargets CUs from the database (packed database file, else .bin files) in the given store, with nbLoadingThreads threads
+    * \param[in] stream the set of targets, each target is drawn from the substream (seed, stream, index)
+    * \param[in] stopRequested optional flag checked between two CUs to stop the loading early
+    */
+    void loadTargets(uint64_t stream, uint64_t nbTargets, TargetStore<uint8_t>& targets, const std::string& databasePath,
+                     const std::atomic<bool>* stopRequested = nullptr);
+
+    /// Start loading the training targets of generation nextGen in nextTrainingTargets.store
+    void prefetchNextTrainingTargets(uint64_t nextGen, const std::string& databasePath);
+
 public:
     // ---------- Intern Variables ----------
 
@@ -66,17 +97,21 @@ public:
     const uint64_t  NB_GENERATION_BEFORE_TARGETS_CHANGE;
 
     /**
-    * \brief List of CU datas and their corresponding optimal split
-    * Each of those vectors contains ${NB_TRAINING_TARGETS} elements and is updated every ${NB_GENERATION_BEFORE_TARGETS_CHANGE}
+    * \brief Snapshot of the CU datas and their corresponding optimal split, shared with the clones
+    * This snapshot contains ${NB_TRAINING_TARGETS} elements and is replaced every ${NB_GENERATION_BEFORE_TARGETS_CHANGE}
+    * (the clones still using the previous one keep it alive)
     */
-    static std::vector<Data::PrimitiveTypeArray2D<uint8_t> *> *trainingTargetsCU; //  PrimitiveTypeArray / Array2DWrapper
-    static std::vector<uint8_t> *trainingTargetsOptimalSplits;
+    TargetSnapshot<uint8_t> trainingTargets; // Rows wrapped by currentCU
+    /**
+    * \brief Next training targets of this environment, loaded in background while the current ones are used
+    * Published in trainingTargets every ${NB_GENERATION_BEFORE_TARGETS_CHANGE}. A clone gets neither the store nor the loading
+    */
+    PrefetchedTargets<uint8_t> nextTrainingTargets;
     // Index of the actual loaded CU
     uint64_t actualTrainingCU;
     // ****** VALIDATION Arguments ******
     const uint64_t NB_VALIDATION_TARGETS;       // default 1 000
-    static std::vector<Data::PrimitiveTypeArray2D<uint8_t>*> *validationTargetsCU; //  PrimitiveTypeArray / Array2DWrapper
-    static std::vector<uint8_t> *validationTargetsOptimalSplits;
+    TargetSnapshot<uint8_t> validationTargets; // Rows wrapped by currentCU, shared with the clones
     uint64_t actualValidationCU;
 
     // Constructor
@@ -84,30 +119,72 @@ public:
             : ClassificationLearningEnvironment(NB_ACTIONS),
               rng(seed),
               seed(seed),
+              nbLoadingThreads(std::thread::hardware_concurrency()),
               //availableActions(actions),
               //score(0),
               currentMode(Learn::LearningMode::TRAINING),
-              currentCU(32, 32),    // 2D Array
+              currentCU(32, 32, nullptr),    // 2D Array, pointer set in LoadNextCU()
+              currentCUSums(32, 32),
               //optimal_split(6),   // Unexisting split
               NB_TRAINING_TARGETS(nbActionsPerEval),
               NB_GENERATION_BEFORE_TARGETS_CHANGE(nbGeneTargetChange),
+              trainingTargets(std::make_shared<TargetStore<uint8_t>>(32 * 32)),    // Empty until UpdateTargets()
               actualTrainingCU(0),
               NB_VALIDATION_TARGETS(nbValidationTarget),
+              validationTargets(std::make_shared<TargetStore<uint8_t>>(32 * 32)),
               actualValidationCU(0) {}
 
-    void getRandomCU(Learn::LearningMode mode, const std::string& databasePath);
+    /// Stop the background loading of the next training targets if it was started by this environment
+    ~ClassEnv();
+
+    /**
+     * \brief Opens, reads and stores a random CU file in the database
+     *
+     * \param[in,out] loaderRng the RNG used to draw the CU
+     * \param[out] targets the store in which the CU pixels and the corresponding optimal split are set
+     * \param[in] idx the index of the target to set
+     * \param[in] databasePath unused, the .bin directory is hard-coded
+     * \return false if the file could not be opened
+     */
+    bool getRandomCU(Mutator::RNG& loaderRng, TargetStore<uint8_t>& targets, uint64_t idx, const std::string& databasePath);
+    /**
+     * \brief Reads and stores a random CU from a packed database (Cf. PackedCUDatabase)
+     * The CU index is drawn exactly as in getRandomCU() and the target is copied at once from the memory-mapped file.
+     *
+     * \param[in,out] loaderRng the RNG used to draw the CU
+     * \param[in] database the packed database (32x32 CUs)
+     * \param[out] targets the store in which the CU pixels and the corresponding optimal split are set
+     * \param[in] idx the index of the target to set
+     */
+    bool getRandomCUFromPackedDatabase(Mutator::RNG& loaderRng, const PackedCUDatabase& database, TargetStore<uint8_t>& targets, uint64_t idx);
     /**
      * \brief Update Training and Validation Targets depending on the generation
-     * For the first generation (numGen == 0), load NB_VALIDATION_TARGETS CU features for validation and NB_TRAINING_TARGETS CU features for training
-     * Else every NB_GENERATION_BEFORE_TARGETS_CHANGE, delete old training targets and load NB_TRAINING_TARGETS new CU features.
+     * For the first generation (numGen == 0), load NB_VALIDATION_TARGETS CUs for validation and NB_TRAINING_TARGETS CUs for training
+     * Else every NB_GENERATION_BEFORE_TARGETS_CHANGE, publish the NB_TRAINING_TARGETS new CUs (old rows are reused by the next loading if no clone holds them anymore).
+     * After each change, the next training targets are loaded in a background thread (Cf. TargetsPrefetcher).
+     * Each set of targets is loaded with nbLoadingThreads threads and only depends on the seed and the generation.
      *
      * \param[in] currentGen The number of the current generation
-     * \param[in] current_CU_path The path of the database
+     * \param[in] databasePath The path of the database (packed database file, else the .bin directory hard-coded in getRandomCU())
      */
     void UpdateTargets(uint64_t currentGen, const std::string& databasePath);
-    void printClassifStatsTable(const Environment& env, const TPG::TPGVertex* bestRoot, const uint64_t numGen, std::string const& outputFile, bool readable);
+    /// Set the number of threads loading and evaluating the targets (default: number of hardware threads)
+    void setNbLoadingThreads(size_t nbThreads);
+
+    /**
+     * \brief Get the confusion matrix of a root on the validation targets
+     * The validation targets are evaluated by nbLoadingThreads threads (Cf. ParallelValidation), unless the root
+     * is the one of the last call (Cf. ConfusionMatrixCache).
+     *
+     * \param[in] env the Environment
+     * \param[in] root the evaluated root
+     */
+    const ConfusionMatrix& getConfusionMatrix(const Environment& env, const TPG::TPGVertex* root);
+
+    void printClassifStatsTable(const ConfusionMatrix& matrix, const uint64_t numGen, std::string const& outputFile, bool readable);
 
     // -------- LearningEnvironment --------
+    /// Copy sharing the target snapshots of this environment, no target is copied
     LearningEnvironment *clone() const;
     bool isCopyable() const;
     void doAction(uint64_t actionID);
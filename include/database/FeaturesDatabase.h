@@ -0,0 +1,130 @@
+#ifndef TPGVVCPARTDATABASE_FEATURESDATABASE_H
+#define TPGVVCPARTDATABASE_FEATURESDATABASE_H
+
+#include <iostream>
+#include <cstdlib>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+* \brief Header written at the beginning of a binary features database file.
+*
+* A binary features database gathers every "<n>.csv" file of a features database (n from 0 to nbElements-1),
+* each CSV file being a single line "QP,split,feature_0,...,feature_{nbFeatures-1}".
+* The file stores two columns :
+*   - at valuesOffset : the nbElements rows of (nbFeatures + 1) doubles : the QP followed by the nbFeatures features
+*   - at labelsOffset : the nbElements optimal splits (uint8_t, 0: NP, 1: QT, 2: BTH, 3:BTV, 4: TTH, 5: TTV, 6: unknown)
+*/
+struct FeaturesDatabaseHeader {
+    /// Magic number identifying the file format ("TPGFTDB" + '\0')
+    char magic[8];
+    /// Version of the file format
+    uint32_t version;
+    /// Number of features of each CU (QP excluded)
+    uint32_t nbFeatures;
+    /// Number of CUs stored in the database
+    uint64_t nbElements;
+    /// Number of CUs of each class (0: NP, 1: QT, 2: BTH, 3:BTV, 4: TTH, 5: TTV)
+    uint64_t nbPerClass[6];
+    /// Position (in bytes) of the splits column in the file
+    uint64_t labelsOffset;
+    /// Position (in bytes) of the first row of values in the file (aligned on 8 bytes)
+    uint64_t valuesOffset;
+};
+
+/**
+* \brief Reader of a binary features database (see FeaturesDatabaseHeader for the file format)
+*
+* The file is memory-mapped (read-only, shared, read in memory on Windows) : loading a CU is a copy of its row, no text is parsed.
+* The file is created from a CSV features database with the TPGVVCPartDatabase_convertFeaturesDatabase executable.
+*/
+class FeaturesDatabase {
+
+private:
+    /// Path of the database file
+    const std::string path;
+
+    /// Beginning of the read-only mapping of the whole file
+    const uint8_t* mapping;
+
+    /// Size (in bytes) of the mapping
+    size_t mappingSize;
+
+#ifdef _WIN32
+    /// Contents of the whole file, read in memory instead of being mapped (mapping points on them)
+    std::vector<uint8_t> contents;
+#endif
+
+    /// Release the mapping of the file
+    void unmapFile();
+
+    /// Header read at the beginning of the file
+    FeaturesDatabaseHeader header;
+
+    /// Shared instances, one per database path (Cf. getShared())
+    static std::map<std::string, std::unique_ptr<FeaturesDatabase>> sharedDatabases;
+    /// Mutex protecting sharedDatabases
+    static std::mutex sharedDatabasesMutex;
+
+public:
+    /// Extension of binary features database files
+    static const std::string FILE_EXTENSION;
+    /// Magic number of binary features database files
+    static const char MAGIC[8];
+    /// Current version of the file format
+    static const uint32_t VERSION = 1;
+
+    // ********************************************* CONSTRUCTORS *********************************************
+    /**
+    * \brief Map a binary features database in memory and check its header
+    * \param[in] path the path of the database file
+    * \throw std::runtime_error if the file can't be mapped or is not a valid binary features database
+    */
+    explicit FeaturesDatabase(const std::string& path);
+
+    /// Unmap the database file
+    ~FeaturesDatabase();
+
+    /// Non-copyable (owns the mapping)
+    FeaturesDatabase(const FeaturesDatabase& other) = delete;
+    FeaturesDatabase& operator=(const FeaturesDatabase& other) = delete;
+
+    // ********************************************* SPECIAL FUNCTIONS *********************************************
+    /**
+    * \brief Return true if the given path designates a binary features database (based on its extension)
+    * Allows environments to keep a single databasePath argument for both CSV directories and binary files
+    */
+    static bool isFeaturesDatabase(const std::string& path);
+
+    /**
+    * \brief Get the instance associated to a database file, mapping it the first time it is requested
+    * Every environment (and every clone) reading the same file then shares the same mapping.
+    */
+    static FeaturesDatabase& getShared(const std::string& path);
+
+    /**
+    * \brief Get a pointer on the values of a CU inside the mapping : the QP followed by the nbFeatures features
+    * \param[in] index the index of the CU in the database
+    * \throw std::out_of_range if index is greater or equal to the number of CUs in the database
+    */
+    const double* getValues(uint64_t index) const;
+
+    /**
+    * \brief Get the optimal split of a CU
+    * \param[in] index the index of the CU in the database
+    * \throw std::out_of_range if index is greater or equal to the number of CUs in the database
+    */
+    uint8_t getSplit(uint64_t index) const;
+
+    // ********************************************* GETTERS *********************************************
+    const std::string& getPath() const;
+    uint32_t getNbFeatures() const;
+    uint64_t getNbElements() const;
+    uint64_t getNbPerClass(uint8_t split) const;
+};
+
+#endif //TPGVVCPARTDATABASE_FEATURESDATABASE_H
@@ -0,0 +1,129 @@
+#ifndef TPGVVCPARTDATABASE_PACKEDCUDATABASE_H
+#define TPGVVCPARTDATABASE_PACKEDCUDATABASE_H
+
+#include <iostream>
+#include <cstdlib>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+* \brief Header written at the beginning of a packed CU database file.
+*
+* A packed database is the concatenation of every "<n>.bin" file of a pixel database (n from 0 to nbElements-1).
+* Each record has the exact same layout as a .bin file: cuHeight*cuWidth pixel values (uint8_t)
+* followed by the optimal split (uint8_t). Records start at dataOffset and are stored with a fixed stride (recordSize).
+*/
+struct PackedCUDatabaseHeader {
+    /// Magic number identifying the file format ("TPGCUDB" + '\0')
+    char magic[8];
+    /// Version of the file format
+    uint32_t version;
+    /// Height of the CUs stored in the database
+    uint32_t cuHeight;
+    /// Width of the CUs stored in the database
+    uint32_t cuWidth;
+    /// Size (in bytes) of one record: cuHeight*cuWidth pixels + 1 optimal split
+    uint32_t recordSize;
+    /// Number of CUs stored in the database
+    uint64_t nbElements;
+    /// Number of CUs of each class (0: NP, 1: QT, 2: BTH, 3:BTV, 4: TTH, 5: TTV)
+    uint64_t nbPerClass[6];
+    /// Position (in bytes) of the first record in the file
+    uint64_t dataOffset;
+};
+
+/**
+* \brief Reader of a packed CU database (see PackedCUDatabaseHeader for the file format)
+*
+* The packed file is memory-mapped (read-only, shared, read in memory on Windows) : records are served directly from the mapping, without any
+* read system call, and the pages live in the page cache so that every training process of a node shares them.
+* The packed file is created from a .bin database with the TPGVVCPartDatabase_packCUDatabase executable.
+*/
+class PackedCUDatabase {
+
+private:
+    /// Path of the packed file
+    const std::string path;
+
+    /// Beginning of the read-only mapping of the whole file
+    const uint8_t* mapping;
+
+    /// Size (in bytes) of the mapping
+    size_t mappingSize;
+
+#ifdef _WIN32
+    /// Contents of the whole file, read in memory instead of being mapped (mapping points on them)
+    std::vector<uint8_t> contents;
+#endif
+
+    /// Release the mapping of the file
+    void unmapFile();
+
+    /// Header read at the beginning of the file
+    PackedCUDatabaseHeader header;
+
+    /// Shared instances, one per packed file path (Cf. getShared())
+    static std::map<std::string, std::unique_ptr<PackedCUDatabase>> sharedDatabases;
+    /// Mutex protecting sharedDatabases
+    static std::mutex sharedDatabasesMutex;
+
+public:
+    /// Extension of packed database files
+    static const std::string FILE_EXTENSION;
+    /// Magic number of packed database files
+    static const char MAGIC[8];
+    /// Current version of the file format
+    static const uint32_t VERSION = 1;
+
+    // ********************************************* CONSTRUCTORS *********************************************
+    /**
+    * \brief Map a packed database in memory and check its header
+    * \param[in] path the path of the packed file
+    * \throw std::runtime_error if the file can't be mapped or is not a valid packed database
+    */
+    explicit PackedCUDatabase(const std::string& path);
+
+    /// Unmap the packed file
+    ~PackedCUDatabase();
+
+    /// Non-copyable (owns the mapping)
+    PackedCUDatabase(const PackedCUDatabase& other) = delete;
+    PackedCUDatabase& operator=(const PackedCUDatabase& other) = delete;
+
+    // ********************************************* SPECIAL FUNCTIONS *********************************************
+    /**
+    * \brief Return true if the given path designates a packed database (based on its extension)
+    * Allows environments to keep a single databasePath argument for both .bin directories and packed files
+    */
+    static bool isPackedDatabase(const std::string& path);
+
+    /**
+    * \brief Get the instance associated to a packed file, mapping it the first time it is requested
+    * Every environment (and every clone) reading the same file then shares the same mapping.
+    */
+    static PackedCUDatabase& getShared(const std::string& path);
+
+    /**
+    * \brief Get a pointer on a record inside the mapping
+    * The cuHeight*cuWidth first bytes are the pixels values and the next one is the optimal split.
+    * The pointer stays valid as long as the database exists (i.e. for the whole program when using getShared()).
+    *
+    * \param[in] index the index of the CU in the database
+    * \throw std::out_of_range if index is greater or equal to the number of CUs in the database
+    */
+    const uint8_t* getCU(uint64_t index) const;
+
+    // ********************************************* GETTERS *********************************************
+    const std::string& getPath() const;
+    uint32_t getCuHeight() const;
+    uint32_t getCuWidth() const;
+    uint32_t getRecordSize() const;
+    uint64_t getNbElements() const;
+    uint64_t getNbPerClass(uint8_t split) const;
+};
+
+#endif //TPGVVCPARTDATABASE_PACKEDCUDATABASE_H
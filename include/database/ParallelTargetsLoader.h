@@ -0,0 +1,52 @@
+#ifndef TPGVVCPARTDATABASE_PARALLELTARGETSLOADER_H
+#define TPGVVCPARTDATABASE_PARALLELTARGETSLOADER_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/**
+* \brief Loads the targets of an environment with several threads
+*
+* Each target is loaded independently (one file, or one record of a packed database) by a loading function called
+* with the index of the target. Indices are distributed dynamically between the threads.
+*
+* To get the same targets whatever the number of threads, a target must not depend on the order of the loading :
+* the loading function draws it with its own RNG, seeded with getSubstreamSeed(seed, stream, index).
+*/
+class ParallelTargetsLoader {
+
+public:
+    /// Stream of the validation targets (training targets use the generation at which they are used as stream)
+    static const uint64_t VALIDATION_STREAM = UINT64_MAX;
+
+    /**
+    * \brief Loading function of one target, return false if the target could not be loaded
+    */
+    typedef std::function<bool(uint64_t idx)> Loader;
+
+    /**
+    * \brief Seed of the RNG drawing one target
+    * Mix of the three values (SplitMix64 finalizer), so that close seeds, streams or indices give unrelated substreams.
+    *
+    * \param[in] seed the seed of the environment
+    * \param[in] stream the set of targets (generation of the training targets or VALIDATION_STREAM)
+    * \param[in] idx the index of the target in its set
+    */
+    static uint64_t getSubstreamSeed(uint64_t seed, uint64_t stream, uint64_t idx);
+
+    /**
+    * \brief Call loader(idx) for every idx from 0 to nbTargets-1 with nbThreads threads (the calling thread included)
+    *
+    * \param[in] nbTargets the number of targets to load
+    * \param[in] nbThreads the number of threads (0 is considered as 1)
+    * \param[in] loader the loading function, called concurrently for different indices
+    * \param[in] stopRequested optional flag checked between two targets to stop the loading early
+    * \return the indices (sorted) of the targets whose loading failed or was not done because of a stop
+    * \throw the first exception thrown by the loader, once every thread is finished
+    */
+    static std::vector<uint64_t> run(uint64_t nbTargets, size_t nbThreads, const Loader& loader, const std::atomic<bool>* stopRequested = nullptr);
+};
+
+#endif //TPGVVCPARTDATABASE_PARALLELTARGETSLOADER_H
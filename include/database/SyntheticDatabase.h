@@ -0,0 +1,98 @@
+#ifndef TPGVVCPARTDATABASE_SYNTHETICDATABASE_H
+#define TPGVVCPARTDATABASE_SYNTHETICDATABASE_H
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+* \brief Generator of synthetic CU databases, in every format read by the environments
+*
+* The CU n of the database is drawn from its own RNG, seeded with ParallelTargetsLoader::getSubstreamSeed(seed, stream, n) :
+* the same seed gives the same database, whatever the formats written and their order. Only the raw outputs of
+* std::mt19937_64 are used (no std distribution) so that the database is the same with every standard library.
+*
+* The class counts follow the class weights exactly (largest remainders), the classes being shuffled over the CUs.
+* The pixels of a CU are a flat level with an edge matching its split (e.g. a horizontal edge in the middle for BTH,
+* four quadrants for QT) and some noise; its features are uniform values, the features k with k % 6 == split being
+* shifted : a TPG can learn something from both.
+*
+* Formats (the same CUs in each of them) :
+*   - pixels : "<n>.bin" files (cuHeight*cuWidth pixels then the split) and a packed database (Cf. PackedCUDatabase)
+*   - features : "<n>.csv" files ("QP,split,feature_0,...") and a binary features database (Cf. FeaturesDatabase)
+*/
+class SyntheticDatabase {
+
+private:
+    const uint64_t nbElements;
+    const uint32_t cuHeight;
+    const uint32_t cuWidth;
+    const uint32_t nbFeatures;
+    const uint64_t seed;
+
+    /// Optimal split of each CU
+    std::vector<uint8_t> splits;
+
+    /// Number of CUs of each class
+    std::vector<uint64_t> nbPerClass;
+
+    /// RNG of a CU, independent of the order of the generation
+    std::mt19937_64 getGenerator(uint64_t stream, uint64_t cuNumber) const;
+
+public:
+    /// Names of the splits in the CSV files (0: NS, 1: QT, 2: BTH, 3: BTV, 4: TTH, 5: TTV)
+    static const char* SPLIT_NAMES[6];
+
+    /**
+    * \brief Draw the splits of a database
+    * \param[in] classWeights the relative weight of each of the 6 classes (e.g. {1, 1, 1, 1, 1, 1} for a balanced database)
+    * \throw std::invalid_argument if there are not 6 non-negative weights with a positive sum, or if a CU dimension is 0
+    */
+    SyntheticDatabase(uint64_t nbElements, uint32_t cuHeight, uint32_t cuWidth, uint32_t nbFeatures,
+                      const std::vector<double>& classWeights, uint64_t seed);
+
+    /// Optimal split of a CU
+    uint8_t getSplit(uint64_t cuNumber) const;
+
+    /// Getter for nbPerClass
+    const std::vector<uint64_t>& getNbPerClass() const;
+
+    /**
+    * \brief Pixels of a CU
+    * \param[out] pixels the cuHeight*cuWidth pixels, row by row
+    */
+    void getPixels(uint64_t cuNumber, uint8_t* pixels) const;
+
+    /**
+    * \brief QP and features of a CU
+    * \param[out] values the QP followed by the nbFeatures features
+    */
+    void getFeatures(uint64_t cuNumber, double* values) const;
+
+    /**
+    * \brief Write one "<n>.bin" file per CU in directory (with the final '/')
+    * \throw std::runtime_error if a file can't be written
+    */
+    void writePixelFiles(const std::string& directory) const;
+
+    /**
+    * \brief Write one "<n>.csv" file per CU in directory (with the final '/'), the values written with all their digits
+    * \throw std::runtime_error if a file can't be written
+    */
+    void writeFeaturesFiles(const std::string& directory) const;
+
+    /**
+    * \brief Write the pixels in a packed database file (Cf. PackedCUDatabaseHeader)
+    * \throw std::runtime_error if the file can't be written
+    */
+    void writePackedDatabase(const std::string& file) const;
+
+    /**
+    * \brief Write the features in a binary features database file (Cf. FeaturesDatabaseHeader)
+    * \throw std::runtime_error if the file can't be written
+    */
+    void writeFeaturesDatabase(const std::string& file) const;
+};
+
+#endif //TPGVVCPARTDATABASE_SYNTHETICDATABASE_H
@@ -0,0 +1,207 @@
+#ifndef TPGVVCPARTDATABASE_TARGETSTORE_H
+#define TPGVVCPARTDATABASE_TARGETSTORE_H
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+* \brief Preloaded targets of an environment : the data of each target (pixels or features) and its optimal split
+*
+* Replaces the vectors of heap-allocated PrimitiveTypeArray (one new/delete per target and per refresh).
+* The data of each target is a row of rowSize values, labels are stored in a parallel array.
+* Rows are allocated the first time they are filled and kept by clear() : refreshing the targets reuses the same
+* memory, no allocation happens once the store has reached its size.
+*
+* Each row is a std::vector so that the environments can wrap it in a Data::ArrayWrapper (which only accepts a
+* std::vector) and switch from a target to the next one by swapping the wrapped pointer.
+*
+* Once loaded, a store is published as a TargetSnapshot : an environment and its clones share it (cloning only copies
+* a shared pointer) and nobody modifies it anymore. A refresh fills another store (Cf. recycle()) and publishes it,
+* the clones still using the previous snapshot keep it alive until they are destroyed.
+*
+* \tparam T type of the data (uint8_t for pixels, double for features)
+*/
+template <class T> class TargetStore {
+
+private:
+    /// Number of values in each row
+    size_t rowSize;
+
+    /// Data of the targets, only the nbTargets first rows are used
+    std::vector<std::vector<T>> rows;
+
+    /// Optimal split of each target
+    std::vector<uint8_t> labels;
+
+    /// Number of targets currently stored
+    size_t nbTargets;
+
+public:
+    /**
+    * \brief Create an empty store
+    * \param[in] rowSize number of values of each target
+    * \param[in] capacity number of rows allocated right away
+    */
+    explicit TargetStore(size_t rowSize, size_t capacity = 0) : rowSize(rowSize), nbTargets(0)
+    {
+        this->reserve(capacity);
+    }
+
+    /**
+    * \brief Allocate rows so that capacity targets can be stored without any allocation
+    */
+    void reserve(size_t capacity)
+    {
+        this->labels.reserve(capacity);
+        this->rows.reserve(capacity);
+        while (this->rows.size() < capacity)
+            this->rows.emplace_back(this->rowSize);
+    }
+
+    /**
+    * \brief Change the number of values of each row (for environments whose data size is only known at construction)
+    * Every target is removed and, if the size changes, the allocated rows are released.
+    */
+    void setRowSize(size_t newRowSize)
+    {
+        this->clear();
+        if (newRowSize != this->rowSize)
+        {
+            this->rowSize = newRowSize;
+            this->rows.clear();
+        }
+    }
+
+    /**
+    * \brief Add a target at the end of the store
+    * \param[in] label the optimal split of the target
+    * \return a pointer on the rowSize values of the new target, to be filled by the caller
+    */
+    T* addTarget(uint8_t label)
+    {
+        if (this->nbTargets == this->rows.size())
+            this->rows.emplace_back(this->rowSize);
+        this->labels.push_back(label);
+
+        return this->rows[this->nbTargets++].data();
+    }
+
+    /**
+    * \brief Set the number of targets, to fill them by index with setTarget() (e.g. from several threads)
+    * Rows and labels of the new targets are not initialized.
+    */
+    void resize(size_t size)
+    {
+        this->reserve(size);
+        this->labels.resize(size);
+        this->nbTargets = size;
+    }
+
+    /**
+    * \brief Set the label of a target and get its row to fill it
+    * Different targets can be set concurrently (the store itself is not modified).
+    * \return a pointer on the rowSize values of the target
+    */
+    T* setTarget(size_t idx, uint8_t label)
+    {
+        this->labels[idx] = label;
+        return this->rows[idx].data();
+    }
+
+    /**
+    * \brief Remove some targets, the order of the other targets is kept
+    * \param[in] sortedIndices the indices of the targets to remove, in increasing order
+    */
+    void removeTargets(const std::vector<uint64_t>& sortedIndices)
+    {
+        if (sortedIndices.empty())
+            return;
+
+        size_t idxDst = sortedIndices.front();
+        size_t idxRemoved = 0;
+        for (size_t idxSrc = idxDst; idxSrc < this->nbTargets; idxSrc++)
+        {
+            if (idxRemoved < sortedIndices.size() && sortedIndices[idxRemoved] == idxSrc)
+            {
+                idxRemoved++;
+                continue;
+            }
+            // Swapping rows keeps the removed rows allocated, at the end of the store
+            std::swap(this->rows[idxDst], this->rows[idxSrc]);
+            this->labels[idxDst] = this->labels[idxSrc];
+            idxDst++;
+        }
+        this->nbTargets = idxDst;
+        this->labels.resize(idxDst);
+    }
+
+    /**
+    * \brief Remove every target, rows are kept for the next targets
+    */
+    void clear()
+    {
+        this->nbTargets = 0;
+        this->labels.clear();
+    }
+
+    /// Number of targets currently stored
+    size_t size() const { return this->nbTargets; }
+
+    /// Number of values of each target
+    size_t getRowSize() const { return this->rowSize; }
+
+    /**
+    * \brief Get the row of a target (to be wrapped by a Data::ArrayWrapper)
+    * The ArrayWrapper only accepts a non-const std::vector, the environments never write in the rows they wrap :
+    * the row of a published snapshot can be wrapped.
+    * \throw std::out_of_range if idx is greater or equal to size()
+    */
+    std::vector<T>* getTarget(size_t idx) const
+    {
+        if (idx >= this->nbTargets)
+            throw std::out_of_range("Target " + std::to_string(idx) + " out of store of size " + std::to_string(this->nbTargets));
+        return const_cast<std::vector<T>*>(&this->rows[idx]);
+    }
+
+    /**
+    * \brief Get the optimal split of a target
+    * \throw std::out_of_range if idx is greater or equal to size()
+    */
+    uint8_t getLabel(size_t idx) const
+    {
+        return this->labels.at(idx);
+    }
+
+    /// Optimal splits of every target (size() values)
+    const std::vector<uint8_t>& getLabels() const { return this->labels; }
+
+    /**
+    * \brief Get an empty store to load the next targets in, reusing the rows of a retired snapshot when possible
+    * The rows are reused if no other environment (e.g. a clone) holds the snapshot anymore : once the stores have
+    * reached their size, a refresh allocates nothing. Otherwise the snapshot is left to its holders and a new store
+    * is allocated.
+    * \param[in] retired the snapshot replaced by the last refresh (may be null)
+    * \param[in] rowSize number of values of each target of the new store
+    */
+    static std::shared_ptr<TargetStore<T>> recycle(std::shared_ptr<const TargetStore<T>> retired, size_t rowSize)
+    {
+        // Nobody else can get the snapshot back once we hold its only reference
+        if (retired && retired.use_count() == 1)
+        {
+            std::shared_ptr<TargetStore<T>> store = std::const_pointer_cast<TargetStore<T>>(retired);
+            store->setRowSize(rowSize);
+            return store;
+        }
+        return std::make_shared<TargetStore<T>>(rowSize);
+    }
+};
+
+/**
+* \brief Published targets of an environment, shared by its clones and never modified (Cf. TargetStore)
+*/
+template <class T> using TargetSnapshot = std::shared_ptr<const TargetStore<T>>;
+
+#endif //TPGVVCPARTDATABASE_TARGETSTORE_H
@@ -0,0 +1,95 @@
+#ifndef TPGVVCPARTDATABASE_TARGETSPREFETCHER_H
+#define TPGVVCPARTDATABASE_TARGETSPREFETCHER_H
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+
+#include "TargetStore.h"
+
+/**
+* \brief Loads the next set of training targets in a background thread
+*
+* Environments preload NB_TRAINING_TARGETS targets which are used for NB_GENERATION_BEFORE_TARGETS_CHANGE generations.
+* Instead of loading the new set when it is needed (while every training thread waits), the environment starts loading
+* it in a second buffer right after a reload, the loading is then hidden behind the training of the next generations.
+* When the next reload happens, the environment waits for the end of the loading (usually already done) and swaps buffers.
+*/
+class TargetsPrefetcher {
+
+private:
+    /// Result of the current loading (invalid when no loading was started)
+    std::future<void> loading;
+
+    /// Set to true to ask the current loading to stop as soon as possible
+    std::atomic<bool> stopRequested;
+
+    /// Environment which started the current loading (Cf. stop())
+    const void* owner;
+
+public:
+    /**
+    * \brief Loading function, it should regularly check the given flag and return early when it is set to true
+    */
+    typedef std::function<void(const std::atomic<bool>& stopRequested)> Loader;
+
+    TargetsPrefetcher();
+
+    /// Stop and wait for the current loading
+    ~TargetsPrefetcher();
+
+    /**
+    * \brief Start a loading in a background thread
+    * The previous loading (if any) is waited first.
+    *
+    * \param[in] loaderOwner the environment starting the loading, whose buffers and functions are used by the loader
+    * \param[in] loader the loading function
+    */
+    void start(const void* loaderOwner, Loader loader);
+
+    /**
+    * \brief Wait for the end of the current loading
+    * \throw any exception thrown by the loader
+    */
+    void wait();
+
+    /**
+    * \brief Ask the current loading to stop and wait for it, if it was started by the given environment
+    * Called by an environment before being destroyed so that the loader never uses a deleted environment.
+    * Nothing is done for other environments (e.g. clones used by the LearningAgent).
+    *
+    * \param[in] loaderOwner the environment being destroyed
+    */
+    void stop(const void* loaderOwner);
+
+    /// Return true if a loading was started and not waited yet
+    bool isLoading() const;
+};
+
+/**
+* \brief Next training targets of an environment and the background loading filling them
+*
+* Only the environment loading its targets owns them : a copy (e.g. a clone evaluating roots in parallel) is empty and
+* idle, it neither holds the store being filled nor any loading. Two environments never share their next targets.
+*
+* \tparam T type of the data of the targets (Cf. TargetStore)
+*/
+template <class T> class PrefetchedTargets {
+
+public:
+    /// Store filled by the prefetcher, published as the training targets at the next change
+    std::shared_ptr<TargetStore<T>> store;
+
+    /// Background loader of store
+    TargetsPrefetcher prefetcher;
+
+    PrefetchedTargets() = default;
+
+    /// Copy of an environment : nothing is shared with the original
+    PrefetchedTargets(const PrefetchedTargets&) : store(), prefetcher() {}
+
+    PrefetchedTargets& operator=(const PrefetchedTargets&) = delete;
+};
+
+#endif //TPGVVCPARTDATABASE_TARGETSPREFETCHER_H
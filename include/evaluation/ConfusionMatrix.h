@@ -0,0 +1,113 @@
+#ifndef TPGVVCPARTDATABASE_CONFUSIONMATRIX_H
+#define TPGVVCPARTDATABASE_CONFUSIONMATRIX_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <gegelati.h>
+
+/**
+* \brief Result of the evaluation of a root on the validation targets
+* table[optimal class][action chosen by the root] is the number of validation targets of the optimal class
+* for which the root chose the action. Both reports (compact and readable) are written from it.
+*/
+class ConfusionMatrix {
+
+private:
+    /// Classification table, nbClasses x nbClasses
+    std::vector<std::vector<uint64_t>> table;
+
+public:
+    /// Empty matrix (no class)
+    ConfusionMatrix() = default;
+
+    /**
+    * \brief Matrix of a classification table (Cf. ParallelValidation::run())
+    * \param[in] table the classification table, square
+    */
+    explicit ConfusionMatrix(std::vector<std::vector<uint64_t>> table) : table(std::move(table)) {}
+
+    /// Number of classes
+    uint64_t getNbClasses() const { return this->table.size(); }
+
+    /// Classification table : getTable()[optimal class][chosen action]
+    const std::vector<std::vector<uint64_t>>& getTable() const { return this->table; }
+
+    /// Number of validation targets of each optimal class (sum of each row)
+    std::vector<uint64_t> getNbPerClass() const
+    {
+        std::vector<uint64_t> nbPerClass(this->table.size(), 0);
+        for (size_t i = 0; i < this->table.size(); i++)
+            for (uint64_t nb : this->table[i])
+                nbPerClass[i] += nb;
+        return nbPerClass;
+    }
+
+    /// Number of validation targets whose optimal class was chosen (sum of the diagonal)
+    uint64_t getNbCorrect() const
+    {
+        uint64_t nbCorrect = 0;
+        for (size_t i = 0; i < this->table.size(); i++)
+            nbCorrect += this->table[i][i];
+        return nbCorrect;
+    }
+};
+
+/**
+* \brief Last confusion matrix computed by an environment, with the root it was computed for
+*
+* The best root often stays the same from one generation to the next : it is then not evaluated again.
+* The root is identified by its address and the (program, destination) of its outgoing edges. The programs are kept
+* alive by the cache, so that a new root allocated at the address of a deleted one can not be mistaken for it.
+* The cache must be cleared when the validation targets change.
+*/
+class ConfusionMatrixCache {
+
+private:
+    /// Root of the cached matrix (nullptr if empty)
+    const TPG::TPGVertex* root = nullptr;
+    /// Program and destination of each outgoing edge of the root
+    std::vector<std::pair<std::shared_ptr<Program::Program>, const TPG::TPGVertex*>> edges;
+    /// Cached matrix
+    ConfusionMatrix matrix;
+
+    /// Program and destination of each outgoing edge of a root
+    static std::vector<std::pair<std::shared_ptr<Program::Program>, const TPG::TPGVertex*>> getEdges(const TPG::TPGVertex* root)
+    {
+        std::vector<std::pair<std::shared_ptr<Program::Program>, const TPG::TPGVertex*>> rootEdges;
+        for (const TPG::TPGEdge* edge : root->getOutgoingEdges())
+            rootEdges.emplace_back(edge->getProgramSharedPointer(), edge->getDestination());
+        return rootEdges;
+    }
+
+public:
+    /**
+    * \brief Get the confusion matrix of the root, computed by compute() if it is not the cached root
+    * \param[in] root the evaluated root
+    * \param[in] compute the evaluation of the root on the validation targets
+    */
+    const ConfusionMatrix& get(const TPG::TPGVertex* root, const std::function<ConfusionMatrix()>& compute)
+    {
+        auto rootEdges = getEdges(root);
+        if (root != this->root || rootEdges != this->edges)
+        {
+            this->matrix = compute();
+            this->root = root;
+            this->edges = std::move(rootEdges);
+        }
+        return this->matrix;
+    }
+
+    /// Forget the cached matrix
+    void clear()
+    {
+        this->root = nullptr;
+        this->edges.clear();
+        this->matrix = ConfusionMatrix();
+    }
+};
+
+#endif //TPGVVCPARTDATABASE_CONFUSIONMATRIX_H
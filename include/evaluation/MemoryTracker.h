@@ -0,0 +1,54 @@
+#ifndef TPGVVCPARTDATABASE_MEMORYTRACKER_H
+#define TPGVVCPARTDATABASE_MEMORYTRACKER_H
+
+#include <atomic>
+#include <cstdint>
+
+/**
+* \brief Heap and resident memory of the process
+*
+* In a MEMORY_TRACKING build (cmake -DMEMORY_TRACKING=ON), the global operator new and delete count every allocation
+* of the program (targets, cloned environments, TPG graph, GEGELATI included) : live bytes, peak of the live bytes and
+* number of allocations. Otherwise the heap counters stay at 0 and nothing is added to the allocations.
+*
+* The resident set size (RSS) and its peak are read from /proc/self/status (0 if not available, e.g. on Windows).
+*/
+class MemoryTracker {
+
+private:
+    static std::atomic<uint64_t> liveBytes;
+    static std::atomic<uint64_t> peakBytes;
+    static std::atomic<uint64_t> phasePeakBytes;
+    static std::atomic<uint64_t> nbAllocations;
+
+public:
+    /// True if the allocations are counted (MEMORY_TRACKING build)
+    static bool isCountingAllocations();
+
+    /// Called by operator new and operator delete
+    static void countAllocation(uint64_t size);
+    static void countDeallocation(uint64_t size);
+
+    /// Bytes allocated and not freed
+    static uint64_t getLiveBytes();
+
+    /// Peak of the live bytes since the start of the program
+    static uint64_t getPeakBytes();
+
+    /// Peak of the live bytes since the last resetPhasePeakBytes()
+    static uint64_t getPhasePeakBytes();
+
+    /// Restart the peak of getPhasePeakBytes() from the live bytes
+    static void resetPhasePeakBytes();
+
+    /// Allocations since the start of the program
+    static uint64_t getNbAllocations();
+
+    /// Current resident set size of the process (VmRSS), 0 if not available
+    static uint64_t getResidentBytes();
+
+    /// Peak resident set size of the process (VmHWM), 0 if not available
+    static uint64_t getPeakResidentBytes();
+};
+
+#endif //TPGVVCPARTDATABASE_MEMORYTRACKER_H
@@ -0,0 +1,43 @@
+#ifndef TPGVVCPARTDATABASE_PARALLELVALIDATION_H
+#define TPGVVCPARTDATABASE_PARALLELVALIDATION_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <gegelati.h>
+
+/**
+* \brief Evaluates a root on the validation targets of an environment with several threads
+*
+* The validation targets are split in contiguous ranges, one per thread. Each thread works on its own clone of the
+* LearningEnvironment (the preloaded targets are shared), with its own Environment and TPGExecutionEngine built on the
+* data sources of the clone. The classification tables of the threads are summed at the end : the result does not
+* depend on the number of threads.
+*/
+class ParallelValidation {
+
+public:
+    /**
+    * \brief Load the validation target idx in the given clone of the LearningEnvironment and return its optimal class
+    */
+    typedef std::function<uint64_t(Learn::LearningEnvironment& le, uint64_t idx)> TargetLoader;
+
+    /**
+    * \brief Compute the classification table of the root on nbTargets validation targets
+    *
+    * \param[in] le the LearningEnvironment to clone (must be copyable)
+    * \param[in] env the Environment of the TPG (instruction set, registers and constants are reused)
+    * \param[in] root the root to evaluate
+    * \param[in] nbTargets the number of validation targets
+    * \param[in] nbClasses the number of classes (and actions)
+    * \param[in] nbThreads the number of threads (0 is considered as 1), the calling thread included
+    * \param[in] loadTarget the loading function of one validation target in a clone
+    * \return the classification table : classifTable[optimal class][action chosen by the root]
+    * \throw std::runtime_error if a class or an action is not in [0, nbClasses-1], or the first exception thrown by a thread
+    */
+    static std::vector<std::vector<uint64_t>> run(const Learn::LearningEnvironment& le, const Environment& env, const TPG::TPGVertex& root,
+                                                  uint64_t nbTargets, uint64_t nbClasses, size_t nbThreads, const TargetLoader& loadTarget);
+};
+
+#endif //TPGVVCPARTDATABASE_PARALLELVALIDATION_H
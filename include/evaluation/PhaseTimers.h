@@ -0,0 +1,139 @@
+#ifndef TPGVVCPARTDATABASE_PHASETIMERS_H
+#define TPGVVCPARTDATABASE_PHASETIMERS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#include <gegelati.h>
+
+#include "MemoryTracker.h"
+
+/**
+* \brief Time spent by a training main in each phase of a generation, written as one CSV line per generation
+*
+* For each phase : wall time, CPU time of the process (every thread, e.g. the loading and evaluation threads), CUs
+* loaded and bytes of CU data loaded (Cf. countLoadedCUs(), called by the environments when their targets are loaded).
+* The loads are attributed to the phase running when they end : the training targets prefetched in background
+* (Cf. TargetsPrefetcher) are counted in the phase they overlap.
+*
+* The mains open a Scope around their steps (targets update, validation, file writes), the PhaseTimersLogger splits
+* trainOneGeneration() into mutation, evaluation and decimation (and the validation of GEGELATI if enabled).
+*
+* Optionally (Cf. enableMemoryReport()), the memory of each phase is written in a second CSV file : heap growth, heap
+* peak and allocations of the phase (Cf. MemoryTracker, MEMORY_TRACKING build) and RSS at its end, then the live heap,
+* peak heap, RSS and peak RSS of the process at the end of the generation.
+*/
+class PhaseTimers {
+
+public:
+    enum Phase { TARGETS, MUTATION, EVALUATION, DECIMATION, VALIDATION, FILES, NB_PHASES };
+
+    /// Name of a phase in the CSV header
+    static const char* getPhaseName(Phase phase);
+
+    /// CPU time (user + system) of every thread of the process since its start, in seconds
+    static double getProcessCpuTime();
+
+    /**
+    * \brief Phase running during the lifetime of the scope (the previous phase is stopped, none runs after the scope)
+    */
+    class Scope {
+    private:
+        PhaseTimers& timers;
+    public:
+        Scope(PhaseTimers& timers, Phase phase);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+private:
+    struct PhaseRecord {
+        double wallTime;
+        double cpuTime;
+        uint64_t nbCUs;
+        uint64_t nbBytes;
+        int64_t heapGrowth;
+        uint64_t heapPeak;
+        uint64_t nbAllocations;
+        uint64_t residentBytes;
+    };
+
+    /// CUs and bytes loaded by every environment since the start of the program
+    static std::atomic<uint64_t> loadedCUs;
+    static std::atomic<uint64_t> loadedBytes;
+
+    std::ofstream file;
+
+    /// Memory CSV file, written if memoryReport
+    std::ofstream memoryFile;
+    bool memoryReport;
+
+    /// Records of the current generation
+    PhaseRecord records[NB_PHASES];
+
+    /// Running phase, NB_PHASES if none, and the counters at its start
+    Phase current;
+    std::chrono::steady_clock::time_point wallStart;
+    double cpuStart;
+    uint64_t cusStart;
+    uint64_t bytesStart;
+    uint64_t heapStart;
+    uint64_t allocationsStart;
+
+public:
+    /**
+    * \brief Open the CSV file and write its header
+    * \throw std::runtime_error if the file can't be opened
+    */
+    explicit PhaseTimers(const std::string& filePath);
+
+    /**
+    * \brief Also write the memory of each phase and of each generation in a second CSV file
+    * \throw std::runtime_error if the file can't be opened
+    */
+    void enableMemoryReport(const std::string& filePath);
+
+    /// Start a phase (the running phase is stopped)
+    void start(Phase phase);
+
+    /// Stop the running phase, if any
+    void stop();
+
+    /**
+    * \brief Write the records of a generation in the CSV file(s) and reset them
+    * The running phase is stopped.
+    */
+    void writeGeneration(uint64_t generation);
+
+    /**
+    * \brief Count CUs loaded in a TargetStore (thread-safe)
+    * \param[in] nbBytes the size of their data (pixels or features) in the store
+    */
+    static void countLoadedCUs(uint64_t nbCUs, uint64_t nbBytes);
+};
+
+/**
+* \brief Logger of the LearningAgent starting the phases of PhaseTimers inside trainOneGeneration()
+*/
+class PhaseTimersLogger : public Log::LALogger {
+
+private:
+    PhaseTimers& timers;
+
+public:
+    PhaseTimersLogger(Learn::LearningAgent& la, PhaseTimers& timers);
+
+    void logHeader() override;
+    void logNewGeneration(uint64_t& generationNumber) override;
+    void logAfterPopulateTPG() override;
+    void logAfterEvaluate(std::multimap<std::shared_ptr<Learn::EvaluationResult>, const TPG::TPGVertex*>& results) override;
+    void logAfterDecimate() override;
+    void logAfterValidate(std::multimap<std::shared_ptr<Learn::EvaluationResult>, const TPG::TPGVertex*>& results) override;
+    void logEndOfTraining() override;
+};
+
+#endif //TPGVVCPARTDATABASE_PHASETIMERS_H
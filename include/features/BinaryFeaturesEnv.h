@@ -5,10 +5,20 @@
 #include <cstdlib>
 #include <ctime>
 #include <fstream>
+#include <thread>
 #include <vector>
 
 #include <gegelati.h>
 
+#include "../database/FeaturesDatabase.h"
+#include "../database/ParallelTargetsLoader.h"
+#include "../database/TargetStore.h"
+#include "../database/TargetsPrefetcher.h"
+#include "../evaluation/ConfusionMatrix.h"
+#include "../evaluation/ParallelValidation.h"
+#include "../evaluation/PhaseTimers.h"
+#include "FeatureType.h"
+
 /**
 * \brief Heritage of the ClassificationLearningEnvironment Interface
 * This class defines the environment for a binary TPG interacting with a database of CU Features (custom size)
@@ -37,16 +47,32 @@ private:
     Mutator::RNG rng;
     /// Seed for randomness control
     size_t seed;
+    /// Number of threads loading the targets (Cf. ParallelTargetsLoader) and evaluating the validation targets (Cf. ParallelValidation)
+    size_t nbLoadingThreads;
+    /// Confusion matrix of the last evaluated root (Cf. getConfusionMatrix())
+    ConfusionMatrixCache confusionMatrixCache;
 
     /// Current LearningMode of the LearningEnvironment (either TRAINING, either VALIDATION). The set of preloaded targets depends on this mode
     Learn::LearningMode currentMode;
 
     /**
     * \brief Current State of the environment
-    * Vector containing all the features computed from CU pixels by CNN
+    * Wrapper on all the features computed from CU pixels by CNN, pointing on one of the preloaded targets :
+    * loading the next CU only swaps the wrapped pointer, no feature is copied.
     * CU are NB_FEATURES + 1 (for the QP value) size (=> for 32x32 CUs: 113 values)
     */
-    Data::PrimitiveTypeArray<double> currentState;
+    Data::ArrayWrapper<FeatureType> currentState;
+
+    /**
+    * \brief Load nbTargets CU features from the database (binary features database file, else .csv files) in the given store, with nbLoadingThreads threads
+    * \param[in] stream the set of targets, each target is drawn from the substream (seed, stream, index)
+    * \param[in] stopRequested optional flag checked between two CUs to stop the loading early
+    */
+    void loadTargets(uint64_t stream, uint64_t nbTargets, TargetStore<FeatureType>& targets, const std::string& databasePath,
+                     const std::atomic<bool>* stopRequested = nullptr);
+
+    /// Start loading the training targets of generation nextGen in nextTrainingTargets.store
+    void prefetchNextTrainingTargets(uint64_t nextGen, const std::string& databasePath);
 
 public:
     // ********************************************* Intern Variables *********************************************
@@ -62,33 +88,29 @@ public:
 
     // ********************************************* TRAINING Arguments *********************************************
     /**
-    * \brief Vector containing TRAINING targets data
-    * This vector contains NB_TRAINING_TARGETS elements and is updated every NB_GENERATION_BEFORE_TARGETS_CHANGE
-    * Elements in this vector are accessed iteratively from 0 to NB_TRAINING_TARGETS (then loop to 0)
+    * \brief Snapshot of the TRAINING targets data (QP + NB_FEATURES features) and their optimal split
+    * This snapshot contains NB_TRAINING_TARGETS elements, shared with the clones of the environment, and is replaced
+    * every NB_GENERATION_BEFORE_TARGETS_CHANGE (the clones still using the previous one keep it alive).
+    * Elements in this snapshot are accessed iteratively from 0 to NB_TRAINING_TARGETS (then loop to 0)
     * The index actualTrainingCU keeps track of the current one.
     */
-    static std::vector<Data::PrimitiveTypeArray<double> *> *trainingTargetsData;
+    TargetSnapshot<FeatureType> trainingTargets;
     /**
-    * \brief Vector containing TRAINING targets optimal split (associated to the corresponding target in trainingTargetsData)
-    * This vector contains NB_TRAINING_TARGETS elements and is updated every NB_GENERATION_BEFORE_TARGETS_CHANGE
+    * \brief Next training targets of this environment, loaded in background while the current ones are used
+    * Published in trainingTargets every ${NB_GENERATION_BEFORE_TARGETS_CHANGE}. A clone gets neither the store nor the loading
     */
-    static std::vector<uint8_t> *trainingTargetsSplits;
+    PrefetchedTargets<FeatureType> nextTrainingTargets;
     /// Index of the actual loaded training target
     uint64_t actualTrainingCU;
 
     // ********************************************* VALIDATION Arguments *********************************************
     /**
-    * \brief Vector containing VALIDATION targets data
-    * This vector contains NB_VALIDATION_TARGETS elements and is loaded once at training beginning
-    * Elements in this vector are accessed iteratively from 0 to NB_VALIDATION_TARGETS (then loop to 0)
+    * \brief Snapshot of the VALIDATION targets data and their optimal split, shared with the clones of the environment
+    * This snapshot contains NB_VALIDATION_TARGETS elements and is loaded once at training beginning
+    * Elements in this snapshot are accessed iteratively from 0 to NB_VALIDATION_TARGETS (then loop to 0)
     * The index actualValidationCU keeps track of the current one.
     */
-    static std::vector<Data::PrimitiveTypeArray<double>*> *validationTargetsData;
-    /**
-    * \brief Vector containing VALIDATION targets optimal split (associated to the corresponding target in validationTargetsData)
-    * This vector contains NB_VALIDATION_TARGETS elements and is loaded once at training beginning
-    */
-    static std::vector<uint8_t> *validationTargetsSplits;
+    TargetSnapshot<FeatureType> validationTargets;
     /// Index of the actual loaded validation target
     uint64_t actualValidationCU;
 
@@ -118,15 +140,20 @@ public:
               NB_FEATURES(nbFeatures),
               rng(seed),
               seed(seed),
+              nbLoadingThreads(std::thread::hardware_concurrency()),
               currentMode(Learn::LearningMode::TRAINING),
-              currentState(NB_FEATURES + 1),
+              currentState(NB_FEATURES + 1, nullptr),    // Pointer set in LoadNextCUFeatures()
               NB_DATABASE_ELEMENTS(nbTrainingElements),
               NB_TRAINING_TARGETS(nbTrainingTargets),
               NB_VALIDATION_TARGETS(nbValidationTarget),
               NB_GENERATION_BEFORE_TARGETS_CHANGE(nbGeneTargetChange),
+              trainingTargets(std::make_shared<TargetStore<FeatureType>>(nbFeatures + 1)),    // Empty until UpdateTargets()
               actualTrainingCU(0),
+              validationTargets(std::make_shared<TargetStore<FeatureType>>(nbFeatures + 1)),
               actualValidationCU(0) {}
 
+    /// Stop the background loading of the next training targets if it was started by this environment
+    ~BinaryFeaturesEnv();
 
     // *************************************************** GETTERS *****************************************************
     uint64_t getCuHeight() const;
@@ -135,19 +162,34 @@ public:
     const std::vector<uint8_t> &getActions0() const;
     const std::vector<uint8_t> &getActions1() const;
     // *************************************************** SETTERS *****************************************************
-    void setCurrentState(const Data::PrimitiveTypeArray<double> &currentState);
+    /// Wrap the given features (NB_FEATURES + 1 values) in currentState, no value is copied
+    void setCurrentState(std::vector<FeatureType> &currentState);
 
     // *********************************************** SPECIAL FUNCTIONS ***********************************************
 
     /**
      * \brief Opens, reads and stores a random CSV file in the database
      * Each CSV file contains 10 CU features (and their correspond optimal split)
-     * CU features stored in trainingTargetsCUFeatures or validationTargetsCUFeatures and the corresponding split is stored in the mode vector
+     * CU features and the corresponding split are added to the given store
      *
-     * \param[in] mode The LearningMode : store either in validationTargetsOptimalSplits or trainingTargetsOptimalSplits
+     * \param[in,out] loaderRng The RNG used to draw the CSV file
+     * \param[out] targets The store in which the CU features and the corresponding optimal split are set
+     * \param[in] idx The index of the target to set
      * \param[in] databasePath The path of the database
+     * \return false if the file could not be read
+     */
+    bool getRandomCUFeaturesFromCSVFile(Mutator::RNG& loaderRng, TargetStore<FeatureType>& targets, uint64_t idx, const std::string& databasePath);
+
+    /**
+     * \brief Reads and stores a random CU from a binary features database (Cf. FeaturesDatabase)
+     * Same random draw and same features array as getRandomCUFeaturesFromCSVFile(), without any text parsing.
+     *
+     * \param[in,out] loaderRng The RNG used to draw the CU
+     * \param[in] database The binary features database (NB_FEATURES features per CU)
+     * \param[out] targets The store in which the CU features and the corresponding optimal split are set
+     * \param[in] idx The index of the target to set
      */
-    void getRandomCUFeaturesFromCSVFile(Learn::LearningMode mode, const std::string& databasePath);
+    bool getRandomCUFeaturesFromBinaryDatabase(Mutator::RNG& loaderRng, const FeaturesDatabase& database, TargetStore<FeatureType>& targets, uint64_t idx);
 
     /// Load the next preloaded features either for training or for validation (depending on the currentMode)
     void LoadNextCUFeatures();
@@ -155,24 +197,47 @@ public:
     /**
      * \brief Update Training and Validation Targets depending on the generation
      * For the first generation (numGen == 0), load NB_VALIDATION_TARGETS CU features for validation and NB_TRAINING_TARGETS CU features for training
-     * Else every NB_GENERATION_BEFORE_TARGETS_CHANGE, delete old training targets and load NB_TRAINING_TARGETS new CU features.
+     * Else every NB_GENERATION_BEFORE_TARGETS_CHANGE, publish the NB_TRAINING_TARGETS new CU features (old rows are reused by the next loading if no clone holds them anymore).
+     * After each change, the next training targets are loaded in a background thread (Cf. TargetsPrefetcher).
+     * Each set of targets is loaded with nbLoadingThreads threads and only depends on the seed and the generation.
      *
      * \param[in] currentGen The number of the current generation
-     * \param[in] current_CU_path The path of the database
+     * \param[in] databasePath The path of the database (directory of .csv files or binary features database file)
      */
     void UpdateTargets(uint64_t currentGen, const std::string& databasePath);
 
+    /**
+     * \brief Wait until the next training targets are loaded in background (Cf. UpdateTargets())
+     * \throw the exception of the loading if it failed
+     */
+    void waitForPrefetch();
+
+    /**
+     * \brief Set the number of threads loading and evaluating the targets (default: number of hardware threads)
+     */
+    void setNbLoadingThreads(size_t nbThreads);
+
     void updateCurrentClass(uint8_t optimalSplit);
 
     /**
-     * \brief Print the classification table of the best root in a .txt file
+     * \brief Get the confusion matrix of a root on the validation targets
+     * The validation targets are evaluated by nbLoadingThreads threads (Cf. ParallelValidation), unless the root
+     * is the one of the last call (Cf. ConfusionMatrixCache).
      *
      * \param[in] env the Environment
-     * \param[in] bestRoot the root whose classification table will be printed
+     * \param[in] root the evaluated root
+     */
+    const ConfusionMatrix& getConfusionMatrix(const Environment& env, const TPG::TPGVertex* root);
+
+    /**
+     * \brief Print the classification table of the best root in a .txt file
+     *
+     * \param[in] matrix the confusion matrix of the best root (Cf. getConfusionMatrix())
      * \param[in] numGen generation number
      * \param[in] outputFile the name of the destination file
+     * \param[in] readable print the readable table, else the compact (re-usable) line
      */
-    void printClassifStatsTable(const Environment& env, const TPG::TPGVertex* bestRoot, const int numGen, const std::string& outputFile, bool readable);
+    void printClassifStatsTable(const ConfusionMatrix& matrix, const int numGen, const std::string& outputFile, bool readable);
 
     /**
      * \brief Return a uint8_t corresponding to the number of the action :
@@ -191,6 +256,7 @@ public:
     // ********************************************* LearningEnvironment *********************************************
     /**
     * \brief Get a copy of the LearningEnvironment (Default implementation returns a null pointer)
+    * The copy shares the target snapshots of this environment, no target is copied.
     * \return a copy of the LearningEnvironment if it is copyable, otherwise this method returns a NULL pointer.
     */
     LearningEnvironment *clone() const;
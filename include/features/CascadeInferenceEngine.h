@@ -0,0 +1,135 @@
+#ifndef TPGVVCPARTDATABASE_CASCADEINFERENCEENGINE_H
+#define TPGVVCPARTDATABASE_CASCADEINFERENCEENGINE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gegelati.h>
+
+#include "../inference/TPGModelRegistry.h"
+#include "FeatureType.h"
+
+/**
+* \brief Topology of a cascade of binary TPGs (each trained in a BinaryFeaturesEnv), described as data
+*
+* Each node is a binary TPG, each of its two actions leads either to another node, either to a split, either to nothing.
+* The evaluation of a CU starts at every entry node and follows the branches : the chosen splits of the CU are the
+* splits reached. A node can only lead to a node of greater index (no cycle).
+*/
+struct CascadeTopology {
+    /// Outcome of one action of a node
+    struct Branch {
+        enum Type { NONE, NODE, SPLIT };
+        /// Kind of outcome
+        Type type;
+        /// Index of the next node (NODE) or number of the split (SPLIT, 0: NP, 1: QT, 2: BTH, 3:BTV, 4: TTH, 5: TTV)
+        uint64_t value;
+
+        static Branch none() { return {NONE, 0}; }
+        static Branch node(uint64_t idx) { return {NODE, idx}; }
+        static Branch split(uint64_t split) { return {SPLIT, split}; }
+    };
+
+    /// One binary TPG of the cascade
+    struct Node {
+        /// Name of the .dot file of the TPG, without extension (Cf. BinaryFeaturesEnv::getActionName())
+        std::string tpgName;
+        /// Outcome of the action 0 and of the action 1 of the TPG
+        Branch branches[2];
+    };
+
+    /// Nodes of the cascade
+    std::vector<Node> nodes;
+    /// Indices of the nodes where the evaluation of a CU starts
+    std::vector<uint64_t> entries;
+
+    /**
+    * \brief Every available binary TPG is executed, each one chooses its split with its action 0
+    * \param[in] availableSplits the splits whose TPG is used (the NP TPG is always used)
+    */
+    static CascadeTopology allBinaryParallel(const std::vector<bool>& availableSplits);
+
+    /// Waterfall NP, QT, then direction (horizontal or vertical) and then binary or ternary split in this direction
+    static CascadeTopology directionWaterfall();
+
+    /// Waterfall NP, QT, BTH, BTV, TTH (TTV if every TPG refuses its split)
+    static CascadeTopology linearWaterfall();
+};
+
+/**
+* \brief Inference of a cascade of binary features TPGs
+*
+* The TPGs are taken from a TPGModelRegistry whose only data source is the input buffer : a wrapper on the current
+* CU features (QP + nbFeatures values, as BinaryFeaturesEnv::currentState). Each node executes the flattened policy of
+* its TPG (Cf. FlatTPGEngine). The features of a CU are loaded once in the program pool of the registry, so a program
+* shared by several TPGs of the cascade (or by several teams of a TPG) is executed once per CU.
+* The registry (and the imported TPGs) can be shared by several cascades and reused for every evaluation round.
+*/
+class CascadeInferenceEngine {
+
+private:
+    /// Topology of the cascade
+    const CascadeTopology topology;
+
+    /// Registry of the imported TPGs
+    TPGModelRegistry& registry;
+
+    /// Flattened policy of the TPG of each node (owned by the registry)
+    std::vector<FlatTPGEngine*> engines;
+
+    /// Programs of every TPG of the cascade, with their bids for the current CU (owned by the registry)
+    FlatProgramPool* programPool;
+
+    /**
+    * \brief Follow the branches of the cascade from each entry node
+    * \param[in] executeNode function returning the action of the TPG of a node on the current CU
+    * \return the chosen splits, bit i set if split i was chosen
+    */
+    template <class ExecuteNode> uint8_t followCascade(ExecuteNode executeNode);
+
+public:
+    /**
+    * \brief Get the TPGs of the cascade from the registry (imported if they were not yet)
+    *
+    * \param[in] registry the registry of the TPGs, whose only data source is input
+    * \param[in] input the input buffer, wrapping QP + nbFeatures values (float in a FEATURES_FLOAT build)
+    * \param[in] opcodes the opcode of each instruction of the instruction set of the registry (Cf. InstructionSetFactory::getOpcodes())
+    * \param[in] topology the topology of the cascade
+    * \throw std::runtime_error if the topology is not valid or if a TPG can not be imported or flattened
+    */
+    CascadeInferenceEngine(TPGModelRegistry& registry, const Data::ArrayWrapper<FeatureType>& input,
+                           const std::vector<FlatOpcode>& opcodes, CascadeTopology topology);
+
+    /**
+    * \brief Evaluate the cascade on one CU
+    * \param[in] cu the QP and the features of the CU
+    * \return the chosen splits, bit i set if split i was chosen
+    */
+    uint8_t evaluate(const std::vector<double>& cu);
+
+    /**
+    * \brief Evaluate the cascade on a batch of CUs, with the programs executed on FlatProgramPool::BATCH_SIZE CUs at once
+    * \param[in] cus the QP and the features of each CU
+    * \param[out] chosenSplits the chosen splits of each CU (Cf. evaluate()), resized to the size of the batch
+    */
+    void evaluate(const std::vector<std::vector<double>*>& cus, std::vector<uint8_t>& chosenSplits);
+
+    /**
+    * \brief Evaluate the next CUs with the features and the float instructions in double precision (FEATURES_FLOAT build)
+    *
+    * Reference of the validation of the float pipeline : the decisions of a float cascade are compared with the decisions
+    * of the same TPGs on the unrounded features (Cf. FlatProgramPool::setDoublePrecision()). No effect in a double build.
+    * \param[in] enable true for double precision, false for the single precision of the training
+    */
+    void setDoublePrecision(bool enable);
+
+    /// Getter for topology
+    const CascadeTopology& getTopology() const;
+
+    /// Getter for programPool
+    const FlatProgramPool& getProgramPool() const;
+};
+
+#endif //TPGVVCPARTDATABASE_CASCADEINFERENCEENGINE_H
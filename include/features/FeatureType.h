@@ -0,0 +1,18 @@
+#ifndef TPGVVCPARTDATABASE_FEATURETYPE_H
+#define TPGVVCPARTDATABASE_FEATURETYPE_H
+
+/**
+* Type of the CU features stored by the features environments and read by the features TPGs.
+*
+* The CNN features are computed in single precision : building with -DFEATURES_FLOAT=1 (Cf. CMakeLists.txt) stores
+* them as float, which halves the memory of the target stores. The features instruction sets then read them with
+* float instructions (Cf. InstructionSetFactory::getFeaturesNames()), the registers of the programs stay double.
+* TPGs trained in one precision must be used in the same precision.
+*/
+#ifdef FEATURES_FLOAT
+typedef float FeatureType;
+#else
+typedef double FeatureType;
+#endif
+
+#endif //TPGVVCPARTDATABASE_FEATURETYPE_H
@@ -5,10 +5,20 @@
 #include <cstdlib>
 #include <ctime>
 #include <fstream>
+#include <thread>
 #include <vector>
 
 #include <gegelati.h>
 
+#include "../database/FeaturesDatabase.h"
+#include "../database/ParallelTargetsLoader.h"
+#include "../database/TargetStore.h"
+#include "../database/TargetsPrefetcher.h"
+#include "../evaluation/ConfusionMatrix.h"
+#include "../evaluation/ParallelValidation.h"
+#include "../evaluation/PhaseTimers.h"
+#include "FeatureType.h"
+
 /**
 * \brief Heritage of the LearningEnvironment Interface
 * This class defines the environment for TPG interacting with a database
@@ -22,11 +32,23 @@ private:
     * \brief Randomness control
     **/
     Mutator::RNG rng;
+    /**
+    * \brief Seed for randomness control
+    **/
+    size_t seed;
+    /**
+    * \brief Number of threads loading the targets (Cf. ParallelTargetsLoader) and evaluating the validation targets (Cf. ParallelValidation)
+    **/
+    size_t nbLoadingThreads;
+    /**
+    * \brief Confusion matrix of the last evaluated root (Cf. getConfusionMatrix())
+    **/
+    ConfusionMatrixCache confusionMatrixCache;
 
     /**
     * \brief Current LearningMode of the LearningEnvironment.
     * Either TRAINING, either VALIDATION, switch set of preloaded targets
-    * (TRAINING : trainingTargetsCUFeatures, VALIDATION : validationTargetsCUFeatures)
+    * (TRAINING : trainingTargets, VALIDATION : validationTargets)
     */
     Learn::LearningMode currentMode;
 
@@ -35,10 +57,22 @@ private:
 
     /**
     * \brief Current State of the environment
-    * Vector containing all the probability computed from CU pixels by CNN
+    * Wrapper on all the probability computed from CU pixels by CNN, pointing on one of the preloaded targets :
+    * loading the next CU only swaps the wrapped pointer, no value is copied.
     * CU are CSV_FILE_WIDTH + 1 (QP) size => 113 values
     */
-    Data::PrimitiveTypeArray<double> currentState;
+    Data::ArrayWrapper<FeatureType> currentState;
+
+    /**
+    * \brief Load nbTargets CU features from the database (binary features database file, else .csv files) in the given store, with nbLoadingThreads threads
+    * \param[in] stream the set of targets, each target is drawn from the substream (seed, stream, index)
+    * \param[in] stopRequested optional flag checked between two CUs to stop the loading early
+    */
+    void loadTargets(uint64_t stream, uint64_t nbTargets, TargetStore<FeatureType>& targets, const std::string& databasePath,
+                     const std::atomic<bool>* stopRequested = nullptr);
+
+    /// Start loading the training targets of generation nextGen in nextTrainingTargets.store
+    void prefetchNextTrainingTargets(uint64_t nextGen, const std::string& databasePath);
 
 public:
     // ********************************************* Intern Variables *********************************************
@@ -63,15 +97,16 @@ public:
 
     // ********************************************* TRAINING Arguments *********************************************
     /**
-    * \brief Vector of CU datas
-    * This vector contains ${NB_TRAINING_TARGETS} elements and is updated every ${NB_GENERATION_BEFORE_TARGETS_CHANGE}
+    * \brief Snapshot of the CU features (QP + CSV_FILE_WIDTH features) and their optimal split, shared with the clones
+    * This snapshot contains ${NB_TRAINING_TARGETS} elements and is replaced every ${NB_GENERATION_BEFORE_TARGETS_CHANGE}
+    * (the clones still using the previous one keep it alive)
     */
-    static std::vector<Data::PrimitiveTypeArray<double> *> *trainingTargetsCUFeatures;
+    TargetSnapshot<FeatureType> trainingTargets;
     /**
-    * \brief Vector of CU optimal split
-    * This vector contains ${NB_TRAINING_TARGETS} elements and is updated every ${NB_GENERATION_BEFORE_TARGETS_CHANGE}
+    * \brief Next training targets of this environment, loaded in background while the current ones are used
+    * Published in trainingTargets every ${NB_GENERATION_BEFORE_TARGETS_CHANGE}. A clone gets neither the store nor the loading
     */
-    static std::vector<uint8_t> *trainingTargetsOptimalSplits;
+    PrefetchedTargets<FeatureType> nextTrainingTargets;
     /**
     * \brief Index of the actual loaded CU for training
     */
@@ -79,15 +114,10 @@ public:
 
     // ********************************************* VALIDATION Arguments *********************************************
     /**
-    * \brief Vector of validation CU datas
-    * This vector contains ${NB_VALIDATION_TARGETS} elements and is loaded once at training beginning
-    */
-    static std::vector<Data::PrimitiveTypeArray<double>*> *validationTargetsCUFeatures;
-    /**
-    * \brief Vector of validation CU optimal split
-    * This vector contains ${NB_VALIDATION_TARGETS} elements and is loaded once at training beginning
+    * \brief Snapshot of the validation CU features and their optimal split, shared with the clones
+    * This snapshot contains ${NB_VALIDATION_TARGETS} elements and is loaded once at training beginning
     */
-    static std::vector<uint8_t> *validationTargetsOptimalSplits;
+    TargetSnapshot<FeatureType> validationTargets;
     /**
     * \brief Index of the actual loaded CU for validation
     */
@@ -105,38 +135,59 @@ public:
     FeaturesEnv(std::vector<uint64_t> actions, const uint64_t nbTrainingElements, const uint64_t nbTrainingTargets, const uint64_t nbGeneTargetChange, const uint64_t nbValidationTarget, size_t seed)
             : ClassificationLearningEnvironment(actions.size()),
               rng(seed),
+              seed(seed),
+              nbLoadingThreads(std::thread::hardware_concurrency()),
               currentMode(Learn::LearningMode::TRAINING),
-              currentState(CSV_FILE_WIDTH + 1),
+              currentState(CSV_FILE_WIDTH + 1, nullptr),    // Pointer set in LoadNextCUFeatures()
               NB_TRAINING_ELEMENTS(nbTrainingElements),
               NB_TRAINING_TARGETS(nbTrainingTargets),
               NB_VALIDATION_TARGETS(nbValidationTarget),
               NB_GENERATION_BEFORE_TARGETS_CHANGE(nbGeneTargetChange),
+              trainingTargets(std::make_shared<TargetStore<FeatureType>>(CSV_FILE_WIDTH + 1)),    // +1 for QP, empty until UpdatingTargets()
               actualTrainingCU(0),
+              validationTargets(std::make_shared<TargetStore<FeatureType>>(CSV_FILE_WIDTH + 1)),
               actualValidationCU(0) {}
 
+    /**
+    * \brief Stop the background loading of the next training targets if it was started by this environment
+    */
+    ~FeaturesEnv();
+
     // ********************************************* SPECIAL FUNCTIONS *********************************************
 
     /**
      * \brief Opens, reads and stores a random CSV file in the database
      * Each CSV file contains 10 CU features (and their correspond optimal split)
-     * CU features stored in trainingTargetsCUFeatures or validationTargetsCUFeatures and the corresponding split is stored in the mode vector
+     * CU features and the corresponding split are added to the given store (published snapshots are never modified)
      *
-     * \param[in] mode The LearningMode : store either in validationTargetsOptimalSplits or trainingTargetsOptimalSplits
+     * \param[out] targets The store in which the CU features and the corresponding optimal splits are added
      * \param[in] current_CU_path The path of the database
-     * \return a PrimitiveTypeArray<double>* containing loaded CU features
      */
-    void getRandomCUFeaturesFromOriginalCSVFile(Learn::LearningMode mode, const char current_CU_path[100]);
+    void getRandomCUFeaturesFromOriginalCSVFile(TargetStore<FeatureType>& targets, const char current_CU_path[100]);
 
     /**
      * \brief Opens, reads and stores a random CSV file in the database
      * Each CSV file contains 10 CU features (and their correspond optimal split)
-     * CU features stored in trainingTargetsCUFeatures or validationTargetsCUFeatures and the corresponding split is stored in the mode vector
+     * CU features and the corresponding split are added to the given store
      *
-     * \param[in] mode The LearningMode : store either in validationTargetsOptimalSplits or trainingTargetsOptimalSplits
-     * \param[in] current_CU_path The path of the database
-     * \return a PrimitiveTypeArray<double>* containing loaded CU features
+     * \param[in,out] loaderRng The RNG used to draw the CSV file
+     * \param[out] targets The store in which the CU features and the corresponding optimal split are set
+     * \param[in] idx The index of the target to set
+     * \param[in] databasePath The path of the database
+     * \return false if the file could not be read
+     */
+    bool getRandomCUFeaturesFromSimpleCSVFile(Mutator::RNG& loaderRng, TargetStore<FeatureType>& targets, uint64_t idx, const std::string& databasePath);
+
+    /**
+     * \brief Reads and stores a random CU from a binary features database (Cf. FeaturesDatabase)
+     * Same random draw and same features array as getRandomCUFeaturesFromSimpleCSVFile(), without any text parsing.
+     *
+     * \param[in,out] loaderRng The RNG used to draw the CU
+     * \param[in] database The binary features database (CSV_FILE_WIDTH features per CU)
+     * \param[out] targets The store in which the CU features and the corresponding optimal split are set
+     * \param[in] idx The index of the target to set
      */
-    void getRandomCUFeaturesFromSimpleCSVFile(Learn::LearningMode mode, const char current_CU_path[100]);
+    bool getRandomCUFeaturesFromBinaryDatabase(Mutator::RNG& loaderRng, const FeaturesDatabase& database, TargetStore<FeatureType>& targets, uint64_t idx);
 
     /**
      * \brief Load the next preloaded features either for training or for validation (depending on the currentMode)
@@ -146,22 +197,39 @@ public:
     /**
      * \brief Update Training and Validation Targets depending on the generation
      * For the first generation (numGen == 0), load NB_VALIDATION_TARGETS CU features for validation and NB_TRAINING_TARGETS CU features for training
-     * Else every NB_GENERATION_BEFORE_TARGETS_CHANGE, delete old training targets and load NB_TRAINING_TARGETS new CU features.
+     * Else every NB_GENERATION_BEFORE_TARGETS_CHANGE, publish the NB_TRAINING_TARGETS new CU features (old rows are reused by the next loading if no clone holds them anymore).
+     * After each change, the next training targets are loaded in a background thread (Cf. TargetsPrefetcher).
+     * Each set of targets is loaded with nbLoadingThreads threads and only depends on the seed and the generation.
      *
      * \param[in] currentGen The number of the current generation
-     * \param[in] current_CU_path The path of the database
+     * \param[in] current_CU_path The path of the database (directory of .csv files or binary features database file)
      */
     void UpdatingTargets(uint64_t currentGen, const char current_CU_path[100]);
 
     /**
-     * \brief Print the classification table of the best root in a .txt file
+     * \brief Set the number of threads loading and evaluating the targets (default: number of hardware threads)
+     */
+    void setNbLoadingThreads(size_t nbThreads);
+
+    /**
+     * \brief Get the confusion matrix of a root on the validation targets
+     * The validation targets are evaluated by nbLoadingThreads threads (Cf. ParallelValidation), unless the root
+     * is the one of the last call (Cf. ConfusionMatrixCache).
      *
      * \param[in] env the Environment
-     * \param[in] bestRoot the root whose classification table will be printed
+     * \param[in] root the evaluated root
+     */
+    const ConfusionMatrix& getConfusionMatrix(const Environment& env, const TPG::TPGVertex* root);
+
+    /**
+     * \brief Print the classification table of the best root in a .txt file
+     *
+     * \param[in] matrix the confusion matrix of the best root (Cf. getConfusionMatrix())
      * \param[in] numGen generation number
      * \param[in] outputFile the name of the destination file
+     * \param[in] readable print the readable table, else the compact (re-usable) line
      */
-    void printClassifStatsTable(const Environment& env, const TPG::TPGVertex* bestRoot, const int numGen, std::string const& outputFile, bool readable);
+    void printClassifStatsTable(const ConfusionMatrix& matrix, const int numGen, std::string const& outputFile, bool readable);
 
     /**
      * \brief Return a uint8_t corresponding to number of the action :
@@ -173,6 +241,7 @@ public:
     // ********************************************* LearningEnvironment *********************************************
     /**
     * \brief Get a copy of the LearningEnvironment (Default implementation returns a null pointer)
+    * The copy shares the target snapshots of this environment, no target is copied.
     * \return a copy of the LearningEnvironment if it is copyable, otherwise this method returns a NULL pointer.
     */
     LearningEnvironment *clone() const;
@@ -0,0 +1,245 @@
+#ifndef TPGVVCPARTDATABASE_FLATPROGRAMPOOL_H
+#define TPGVVCPARTDATABASE_FLATPROGRAMPOOL_H
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include <gegelati.h>
+
+#include "../instructions/InstructionSetFactory.h"
+#include "TPGOperand.h"
+
+/**
+* \brief Flattened programs of the TPGs of an Environment, with the bid of each program memoised for the current input
+*
+* The lines of every program are stored in a single array (intron lines are dropped, operands are resolved once,
+* Cf. TPGOperand) and their constants in a single pool. A program is added once : two programs with the same lines
+* and the same constants share their slot, even if they come from different TPGs (e.g. the binary TPGs of a cascade).
+*
+* Every call to setInput() starts a new input epoch. The bid of a program is computed at its first request during an
+* epoch and reused by every other edge (of any team, of any TPG of the pool) referencing this program.
+*
+* setInputBatch() loads up to BATCH_SIZE CUs at once, as lanes : each value (register or input) is stored as an array of
+* BATCH_SIZE lanes, and each line of a program runs over every lane in a loop that the compiler vectorises (AVX2 or
+* AVX-512 when FlatProgramPool.cpp is compiled for the host with -DINFERENCE_SIMD=ON, Cf. CMakeLists.txt). Every program of
+* the pool is executed on the batch, the engines then follow the path of each lane with getBatchBid().
+*
+* With a float input (FEATURES_FLOAT build), the features are rounded to float when they are loaded and the float
+* opcodes compute in single precision, as the float lambdas. setDoublePrecision() keeps the features in double and
+* computes the float opcodes in double, to measure the decisions changed by the single precision.
+*
+* The pool owns the scratch buffers of the programs : one pool (and its engines) per thread.
+*/
+class FlatProgramPool {
+
+private:
+    /// Line of a program, with its operands resolved
+    struct FlatLine {
+        FlatOpcode opcode;
+        /// Destination register
+        uint32_t destination;
+        /// First operand : index in values (double, float), in the pixels (uint8_t) or in the constant pool (CONV2D_U8)
+        uint32_t a;
+        /// Second operand : index in values (double, float), in the pixels (uint8_t) or in the constant pool (MULT_BY_CONST)
+        uint32_t b;
+    };
+
+    /// Lines [firstLine, firstLine + nbLines[ of the lines array
+    struct FlatProgram {
+        uint32_t firstLine;
+        uint32_t nbLines;
+    };
+
+    /// Environment of the programs
+    const Environment& env;
+
+    /// Opcode of each instruction of the instruction set of env
+    const std::vector<FlatOpcode> opcodes;
+
+    /// Layout of the single data source of env
+    const TPGInputLayout input;
+
+    /// Number of values of the input
+    const uint64_t inputSize;
+
+    /// True if the input is the pixels of the CU (uint8_t), false if it is its features (double or float)
+    const bool pixelsInput;
+
+    /// True if the input is float features
+    const bool floatInput;
+
+    /// True if the features are kept in double and the float opcodes computed in double (Cf. setDoublePrecision())
+    bool doublePrecision;
+
+    /// Flattened programs
+    std::vector<FlatProgram> programs;
+    std::vector<FlatLine> lines;
+    std::vector<int32_t> constantPool;
+
+    /// Slot of each program already added, by content (Cf. addProgram())
+    std::map<std::vector<int64_t>, uint32_t> programSlots;
+
+    /// Registers followed by a copy of the features (the double and float operands index this single array)
+    std::vector<double> values;
+
+    /// Pixels of the current input
+    const uint8_t* pixels;
+
+    /// Current input epoch (incremented by setInput())
+    uint64_t epoch;
+
+    /// Bid of each program, valid if its bidEpoch is the current epoch
+    std::vector<double> bids;
+    std::vector<uint64_t> bidEpochs;
+
+    /// Values of the batch, value v of lane l at v * BATCH_SIZE + l (registers then features, as values)
+    std::vector<double> batchValues;
+
+    /// Pixels of the batch, pixel p of lane l at p * BATCH_SIZE + l
+    std::vector<uint8_t> batchPixels;
+
+    /// Bid of each program for each lane of the batch, at slot * BATCH_SIZE + lane
+    std::vector<double> batchBids;
+
+    /// Number of lanes of the current batch
+    size_t nbLanes;
+
+    /// Number of bids requested and of programs actually executed since the creation of the pool
+    uint64_t nbBidRequests;
+    uint64_t nbExecutions;
+
+    /// True if operand idx_op of the opcode is read in the constants of the program
+    static bool isConstantOperand(FlatOpcode opcode, size_t idx_op);
+
+    /**
+    * \brief Execute a program on the current input
+    * \return the bid of the program (its register 0)
+    */
+    double executeProgram(const FlatProgram& program);
+
+    /**
+    * \brief Execute a program on every lane of the current batch
+    * \param[out] laneBids the bid of the program for each lane (BATCH_SIZE values)
+    */
+    void executeProgramBatch(const FlatProgram& program, double* laneBids);
+
+    /**
+    * \brief 3x3 convolution of a window of every lane, accumulated on integers (vectorised over the lanes)
+    * \tparam Accumulator int32_t or int64_t, large enough for the sum of the products
+    * \param[in] window the top-left pixel of the window in the pixels of the batch (lane 0)
+    * \param[out] result the convolution of each of the nbLanes lanes
+    */
+    template <typename Accumulator>
+    static void conv2DLanes(const int32_t* coeff, const uint8_t* window, size_t width, size_t nbLanes, double* result);
+
+    /// Execute every program of the pool on the current batch (new input epoch)
+    void executeBatch();
+
+public:
+    /// Maximum number of CUs of a batch (Cf. setInputBatch())
+    static const size_t BATCH_SIZE = 64;
+
+    /**
+    * \brief Create an empty pool
+    *
+    * \param[in] env the Environment of the programs (a single data source, with the given layout)
+    * \param[in] opcodes the opcode of each instruction of the instruction set of env
+    * \param[in] input the layout of the data source of env
+    * \throw std::runtime_error if env doesn't have a single data source, if an opcode is missing or
+    * FlatOpcode::UNSUPPORTED, or if the input is neither double, float nor uint8_t
+    */
+    FlatProgramPool(const Environment& env, std::vector<FlatOpcode> opcodes, TPGInputLayout input);
+
+    /**
+    * \brief Flatten a program, unless a program with the same lines and constants is already in the pool
+    * \param[in] program the program
+    * \return the slot of the program in the pool
+    * \throw std::runtime_error if an operand doesn't match the opcode of its instruction
+    */
+    uint32_t addProgram(const Program::Program& program);
+
+    /**
+    * \brief Start a new input epoch on the features of a CU
+    * \param[in] features the QP and the features of the CU (input.width values, copied, rounded to float if the input is float)
+    * \throw std::runtime_error if the input of the TPGs is uint8_t
+    */
+    void setInput(const double* features);
+
+    /**
+    * \brief Start a new input epoch on the pixels of a CU
+    * \param[in] cuPixels the pixels of the CU (input.width * input.height values, row by row, not copied)
+    * \throw std::runtime_error if the input of the TPGs is not uint8_t
+    */
+    void setInput(const uint8_t* cuPixels);
+
+    /**
+    * \brief Execute every program of the pool on a batch of CUs (new input epoch)
+    * \param[in] features the QP and the features of each CU (at most BATCH_SIZE CUs)
+    * \throw std::runtime_error if the input of the TPGs is uint8_t or if the batch is too large
+    */
+    void setInputBatch(const std::vector<const double*>& features);
+
+    /**
+    * \brief Execute every program of the pool on a batch of CUs (new input epoch)
+    * \param[in] cuPixels the pixels of each CU (at most BATCH_SIZE CUs)
+    * \throw std::runtime_error if the input of the TPGs is not uint8_t or if the batch is too large
+    */
+    void setInputBatch(const std::vector<const uint8_t*>& cuPixels);
+
+    /**
+    * \brief Get the bid of a program for a CU of the current batch
+    * \param[in] slot the slot of the program (Cf. addProgram())
+    * \param[in] lane the index of the CU in the batch
+    */
+    double getBatchBid(uint32_t slot, size_t lane)
+    {
+        this->nbBidRequests++;
+        return this->batchBids[slot * BATCH_SIZE + lane];
+    }
+
+    /// Number of CUs of the current batch
+    size_t getNbLanes() const;
+
+    /**
+    * \brief Get the bid of a program on the current input, executed only at its first request of the epoch
+    * \param[in] slot the slot of the program (Cf. addProgram())
+    */
+    double getBid(uint32_t slot)
+    {
+        this->nbBidRequests++;
+        if (this->bidEpochs[slot] != this->epoch)
+        {
+            this->bids[slot] = this->executeProgram(this->programs[slot]);
+            this->bidEpochs[slot] = this->epoch;
+            this->nbExecutions++;
+        }
+        return this->bids[slot];
+    }
+
+    /**
+    * \brief Compute the float opcodes in double precision, on features not rounded to float (from the next input)
+    * \param[in] enable true for the double precision reference, false for the single precision of the float lambdas
+    */
+    void setDoublePrecision(bool enable);
+
+    /// Getter for doublePrecision
+    bool isDoublePrecision() const;
+
+    /// Check if opcodes and input are the ones of the pool
+    bool matches(const std::vector<FlatOpcode>& otherOpcodes, const TPGInputLayout& otherInput) const;
+
+    /// Number of distinct programs of the pool
+    size_t getNbPrograms() const;
+
+    /// Number of lines executed for the bids of every program of the pool
+    size_t getNbLines() const;
+
+    /// Number of bids requested since the creation of the pool
+    uint64_t getNbBidRequests() const;
+
+    /// Number of programs executed since the creation of the pool (the other bids were memoised), once per lane in batch
+    uint64_t getNbExecutions() const;
+};
+
+#endif //TPGVVCPARTDATABASE_FLATPROGRAMPOOL_H
@@ -0,0 +1,113 @@
+#ifndef TPGVVCPARTDATABASE_FLATTPGENGINE_H
+#define TPGVVCPARTDATABASE_FLATTPGENGINE_H
+
+#include <cstdint>
+#include <vector>
+
+#include <gegelati.h>
+
+#include "FlatProgramPool.h"
+
+/**
+* \brief Inference-only execution engine of the policy of a TPG root, flattened in contiguous arrays
+*
+* The subgraph reachable from the root (e.g. after Learn::LearningAgent::keepBestPolicy()) is copied once in an array
+* of vertices and an array of edges (contiguous for each team, in the order of its outgoing edges), the programs being
+* flattened in a FlatProgramPool which can be shared by the TPGs of a cascade.
+* An execution is a loop over these arrays with a switch on the opcode of each line : no virtual call, no allocation,
+* and no program executed twice on the same input (Cf. FlatProgramPool::getBid()).
+* The decisions are the decisions of TPG::TPGExecutionEngine (NaN bids count as -infinity, ties go to the last edge,
+* visited teams are excluded).
+*
+* The engine owns its scratch buffer (visited teams) : one engine (and pool) per thread.
+*/
+class FlatTPGEngine {
+
+private:
+    /// Team (actionID == TEAM) or action, with its edges [firstEdge, firstEdge + nbEdges[ of the edges array
+    struct FlatVertex {
+        uint64_t actionID;
+        uint32_t firstEdge;
+        uint32_t nbEdges;
+    };
+
+    struct FlatEdge {
+        /// Slot of the program in the pool
+        uint32_t program;
+        uint32_t destination;
+    };
+
+    /// actionID of the teams
+    static const uint64_t TEAM = UINT64_MAX;
+
+    /// Programs of the policy, and their memoised bids
+    FlatProgramPool& pool;
+
+    /// Flattened policy, the root is the vertex 0
+    std::vector<FlatVertex> vertices;
+    std::vector<FlatEdge> edges;
+
+    /// Teams visited by the current execution
+    std::vector<uint8_t> visited;
+
+    /**
+    * \brief Follow the policy from the root
+    * \param[in] getBid function returning the bid of the program of a slot of the pool
+    * \return the ID of the action reached, UINT64_MAX if every edge of a team leads to a visited team
+    */
+    template <class BidFunction> uint64_t followPolicy(BidFunction getBid);
+
+public:
+    /**
+    * \brief Flatten the policy of a root
+    *
+    * \param[in] root the root of the TPG
+    * \param[in] pool the pool where the programs of the TPG are added (Environment of the TPG, must outlive the engine)
+    * \throw std::runtime_error if an operand doesn't match the opcode of its instruction
+    */
+    FlatTPGEngine(const TPG::TPGVertex* root, FlatProgramPool& pool);
+
+    /**
+    * \brief Execute the policy on the current input of the pool (Cf. FlatProgramPool::setInput())
+    * \return the ID of the action reached, UINT64_MAX if every edge of a team leads to a visited team
+    */
+    uint64_t execute();
+
+    /**
+    * \brief Execute the policy on the features of a CU (new input of the pool)
+    * \param[in] features the QP and the features of the CU
+    * \return the ID of the action reached by the root
+    * \throw std::runtime_error if the input of the TPG is not double
+    */
+    uint64_t execute(const double* features);
+
+    /**
+    * \brief Execute the policy on the pixels of a CU (new input of the pool)
+    * \param[in] cuPixels the pixels of the CU, row by row
+    * \return the ID of the action reached by the root
+    * \throw std::runtime_error if the input of the TPG is not uint8_t
+    */
+    uint64_t execute(const uint8_t* cuPixels);
+
+    /**
+    * \brief Execute the policy on a CU of the current batch of the pool (Cf. FlatProgramPool::setInputBatch())
+    * \param[in] lane the index of the CU in the batch
+    * \return the ID of the action reached, UINT64_MAX if every edge of a team leads to a visited team
+    */
+    uint64_t executeLane(size_t lane);
+
+    /**
+    * \brief Execute the policy on a list of CUs, by batches of FlatProgramPool::BATCH_SIZE CUs
+    * \param[in] features the QP and the features of each CU
+    * \param[out] actionIDs the ID of the action reached for each CU, resized to the number of CUs
+    */
+    void executeBatch(const std::vector<const double*>& features, std::vector<uint64_t>& actionIDs);
+
+    /// Getter for pool
+    FlatProgramPool& getProgramPool() const;
+
+    /// Number of vertices reachable from the root
+    size_t getNbVertices() const;
+};
+
+#endif //TPGVVCPARTDATABASE_FLATTPGENGINE_H
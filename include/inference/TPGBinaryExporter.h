@@ -0,0 +1,84 @@
+#ifndef TPGVVCPARTDATABASE_TPGBINARYEXPORTER_H
+#define TPGVVCPARTDATABASE_TPGBINARYEXPORTER_H
+
+#include <cstdint>
+#include <string>
+
+#include <gegelati.h>
+
+/**
+* \brief Header written at the beginning of a binary TPG file.
+*
+* A binary TPG file stores the policy of a single root : the vertices, programs and edges reachable from it.
+* The header is followed by flat arrays, in this order :
+*   - vertices  : nbVertices uint64_t, the action ID of each action vertex, TEAM_VERTEX for teams (vertex 0 is the root)
+*   - edges     : nbEdges x 3 uint32_t, (source vertex, destination vertex, program), in the order of the outgoing
+*                 edges of each source vertex (the order in which bids are compared)
+*   - constants : nbPrograms x nbConstants int32_t, the constants of each program
+*   - lineCounts: nbPrograms uint32_t, the number of lines of each program
+*   - lines     : nbLines x (2 + 2 x maxNbOperands) uint32_t, (destination, instruction, then (data source, location)
+*                 for each operand), the lines of every program one after the other
+* Intron lines are not exported : they have no effect on the result of a program.
+*/
+struct TPGBinaryHeader {
+    /// Magic number identifying the file format ("TPGBIN" + '\0' + '\0')
+    char magic[8];
+    /// Version of the file format
+    uint32_t version;
+    /// Environment the programs were trained in (checked when the file is imported)
+    uint32_t nbInstructions;
+    uint32_t nbRegisters;
+    uint32_t nbConstants;
+    uint32_t nbDataSources;
+    uint32_t maxNbOperands;
+    /// Size of the arrays following the header
+    uint32_t nbVertices;
+    uint32_t nbEdges;
+    uint32_t nbPrograms;
+    uint32_t nbLines;
+};
+
+/**
+* \brief Exporter of the policy of a TPG root in a binary TPG file (see TPGBinaryHeader for the file format)
+*
+* Unlike the .dot export, the file is meant to be loaded by the inference programs (Cf. TPGBinaryImporter) : no text is
+* parsed and intron lines are dropped. Usage mirrors File::TPGGraphDotExporter.
+*/
+class TPGBinaryExporter {
+
+private:
+    /// Path of the exported file
+    std::string filePath;
+
+    /// TPGGraph whose roots are exported
+    const TPG::TPGGraph& tpg;
+
+public:
+    /// Extension of binary TPG files
+    static const std::string FILE_EXTENSION;
+    /// Magic number of binary TPG files
+    static const char MAGIC[8];
+    /// Value of a vertex which is a team in the vertices array
+    static const uint64_t TEAM_VERTEX = UINT64_MAX;
+    /// Current version of the file format
+    static const uint32_t VERSION = 1;
+
+    /**
+    * \brief Create an exporter of the roots of a TPGGraph
+    * \param[in] filePath the path of the exported file
+    * \param[in] tpg the TPGGraph whose roots are exported
+    */
+    TPGBinaryExporter(const char* filePath, const TPG::TPGGraph& tpg);
+
+    /// Change the path of the exported file
+    void setNewFilePath(const char* newFilePath);
+
+    /**
+    * \brief Export the policy of a root of the TPGGraph (the root and every vertex reachable from it)
+    * \param[in] root the exported root, e.g. the best root after Learn::LearningAgent::keepBestPolicy()
+    * \throw std::runtime_error if the file can't be written
+    */
+    void print(const TPG::TPGVertex* root) const;
+};
+
+#endif //TPGVVCPARTDATABASE_TPGBINARYEXPORTER_H
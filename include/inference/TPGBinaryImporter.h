@@ -0,0 +1,34 @@
+#ifndef TPGVVCPARTDATABASE_TPGBINARYIMPORTER_H
+#define TPGVVCPARTDATABASE_TPGBINARYIMPORTER_H
+
+#include <string>
+
+#include <gegelati.h>
+
+#include "TPGBinaryExporter.h"
+
+/**
+* \brief Importer of a binary TPG file (see TPGBinaryHeader for the file format)
+*
+* The whole file is read at once and the policy is rebuilt in the given TPGGraph : the first root of the graph is then
+* the exported root. Usage mirrors File::TPGGraphDotImporter.
+*/
+class TPGBinaryImporter {
+
+public:
+    /**
+    * \brief Import a binary TPG file in a TPGGraph
+    * \param[in] filePath the path of the binary TPG file
+    * \param[in] env the Environment of the TPGGraph, identical to the one the programs were trained in
+    * \param[out] tpg the TPGGraph where the policy is added
+    * \throw std::runtime_error if the file can't be read, is not a valid binary TPG file or doesn't match env
+    */
+    TPGBinaryImporter(const char* filePath, Environment& env, TPG::TPGGraph& tpg);
+
+    /**
+    * \brief Return true if the given path designates a binary TPG file (based on its extension)
+    */
+    static bool isBinaryTPGFile(const std::string& path);
+};
+
+#endif //TPGVVCPARTDATABASE_TPGBINARYIMPORTER_H
@@ -0,0 +1,77 @@
+#ifndef TPGVVCPARTDATABASE_TPGCODEGENERATOR_H
+#define TPGVVCPARTDATABASE_TPGCODEGENERATOR_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include <gegelati.h>
+
+#include "TPGOperand.h"
+
+/**
+* \brief Ahead-of-time generator of a standalone C++ function from the policy of a TPG root
+*
+* The generated file only depends on the standard library : every program becomes a straight-line function on a local
+* register array (intron lines are dropped) and every team a case of a switch comparing the bids of its edges, with the
+* exact semantics of TPG::TPGExecutionEngine (NaN bids count as -infinity, ties go to the last edge, visited vertices
+* are excluded). The generated function reads the same input as the single data source of the Environment :
+*   uint64_t functionName(const inputType* input)   // returns the action ID
+*
+* Each instruction is described by a C++ template where "%k" is replaced by the expression of operand k and "%Sk" by
+* the row stride of operand k (for 2D windows of the input). The templates must compute exactly what the instruction
+* computes (same operations, same order) for the generated decisions to match bit for bit (Cf. InstructionSetFactory).
+*/
+class TPGCodeGenerator {
+
+private:
+    /// Environment of the TPGs
+    const Environment& env;
+
+    /// C++ template of each instruction of the instruction set, in the order of the set
+    const std::vector<std::string> instructionTemplates;
+
+    /// C++ code inserted before the programs (helper functions used by the templates)
+    const std::string helpers;
+
+    /// Layout of the input
+    const TPGInputLayout input;
+
+    /**
+    * \brief Get the C++ expression of an operand of a line
+    * \param[in] program the program of the line, whose constants are read
+    * \param[in] programIdx the index of the program in the generated file (name of its constant array)
+    * \param[in] type the type of the operand (Cf. Instructions::Instruction::getOperandTypes())
+    * \param[in] operand the (data source, location) pair of the operand
+    * \param[out] stride the row stride of the operand (width of the input for a 2D window, else 0)
+    * \throw std::runtime_error if the operand can't be resolved (Cf. TPGOperand::resolve())
+    */
+    std::string getOperandExpression(const Program::Program& program, size_t programIdx, const std::type_info& type,
+                                     const std::pair<uint64_t, uint64_t>& operand, uint64_t& stride) const;
+
+public:
+    /**
+    * \brief Create a generator for the TPGs of an Environment
+    *
+    * \param[in] env the Environment of the TPGs (a single data source, with the given layout)
+    * \param[in] instructionTemplates the C++ template of each instruction of the instruction set of env
+    * \param[in] helpers the C++ code of the helper functions used by the templates
+    * \param[in] input the layout of the data source of env
+    * \throw std::runtime_error if env doesn't have a single data source or a template is missing
+    */
+    TPGCodeGenerator(const Environment& env, std::vector<std::string> instructionTemplates, std::string helpers,
+                     TPGInputLayout input);
+
+    /**
+    * \brief Write the C++ file of the policy of a root
+    * \param[in] root the root of the TPG
+    * \param[in] functionName the name of the generated function
+    * \param[out] output the stream where the C++ file is written
+    * \throw std::runtime_error if a program uses an operand type which is not supported
+    */
+    void generate(const TPG::TPGVertex* root, const std::string& functionName, std::ostream& output) const;
+};
+
+#endif //TPGVVCPARTDATABASE_TPGCODEGENERATOR_H
@@ -0,0 +1,97 @@
+#ifndef TPGVVCPARTDATABASE_TPGMODELREGISTRY_H
+#define TPGVVCPARTDATABASE_TPGMODELREGISTRY_H
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gegelati.h>
+
+#include "FlatTPGEngine.h"
+
+/**
+* \brief Trained TPGs of an inference run, imported once and reused for every evaluation round
+*
+* Every TPG is imported at its first use, in a TPGGraph built on the Environment of the registry : from its binary file
+* (Cf. TPGBinaryExporter) when there is one, else from its .dot file.
+* The data sources of this Environment belong to the caller (e.g. the state of a single LearningEnvironment, or an
+* input buffer) : loading a CU in them is enough for every TPG of the registry.
+*/
+class TPGModelRegistry {
+
+private:
+    /// Environment of every TPG of the registry
+    Environment env;
+
+    /// Directory of the .dot files (with the final '/')
+    const std::string tpgDirectory;
+
+    /// Imported TPGs, by name
+    std::map<std::string, std::unique_ptr<TPG::TPGGraph>> graphs;
+
+    /// First root of each imported TPG, by name
+    std::map<std::string, const TPG::TPGVertex*> roots;
+
+    /// Execution engine of every TPG of the registry
+    TPG::TPGExecutionEngine tee;
+
+    /// Programs of the flattened TPGs, shared by every flattened TPG (created by the first getFlatEngine())
+    std::unique_ptr<FlatProgramPool> programPool;
+
+    /// Flattened policy of the imported TPGs, by name (Cf. getFlatEngine())
+    std::map<std::string, std::unique_ptr<FlatTPGEngine>> flatEngines;
+
+public:
+    /**
+    * \brief Create an empty registry
+    *
+    * \param[in] set the instruction set used to train the TPGs
+    * \param[in] dataSources the data sources the TPGs were trained on (must outlive the registry)
+    * \param[in] nbRegisters the number of registers used to train the TPGs
+    * \param[in] nbConstants the number of constants used to train the TPGs
+    * \param[in] tpgDirectory the directory of the .dot files (with the final '/')
+    */
+    TPGModelRegistry(const Instructions::Set& set, const std::vector<std::reference_wrapper<const Data::DataHandler>>& dataSources,
+                     size_t nbRegisters, size_t nbConstants, std::string tpgDirectory);
+
+    /// The TPGGraphs and the engine reference env
+    TPGModelRegistry(const TPGModelRegistry&) = delete;
+    TPGModelRegistry& operator=(const TPGModelRegistry&) = delete;
+
+    /**
+    * \brief Get the first root of a TPG, imported from tpgDirectory/tpgName.tpgb (or .dot) at its first use
+    * \param[in] tpgName the name of the .dot file, without extension
+    * \throw std::runtime_error if the file can not be imported or has no root
+    */
+    const TPG::TPGVertex* getRoot(const std::string& tpgName);
+
+    /**
+    * \brief Execute a root on the current content of the data sources
+    * \return the ID of the action reached by the root
+    */
+    uint64_t execute(const TPG::TPGVertex* root);
+
+    /**
+    * \brief Get the flattened policy of the first root of a TPG, built at its first use (Cf. getRoot())
+    *
+    * Every flattened TPG of the registry shares the same FlatProgramPool : on a given input, a program common to
+    * several TPGs is executed once.
+    *
+    * \param[in] tpgName the name of the .dot file, without extension
+    * \param[in] opcodes the opcode of each instruction of the instruction set (Cf. InstructionSetFactory::getOpcodes())
+    * \param[in] input the layout of the single data source of the registry
+    * \throw std::runtime_error if the TPG can not be imported or flattened, or if opcodes or input differ from the
+    * ones of the previous calls
+    */
+    FlatTPGEngine& getFlatEngine(const std::string& tpgName, const std::vector<FlatOpcode>& opcodes, const TPGInputLayout& input);
+
+    /// Number of imported TPGs
+    size_t getNbGraphs() const;
+
+    /// Getter for env
+    const Environment& getEnvironment() const;
+};
+
+#endif //TPGVVCPARTDATABASE_TPGMODELREGISTRY_H
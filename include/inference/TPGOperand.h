@@ -0,0 +1,54 @@
+#ifndef TPGVVCPARTDATABASE_TPGOPERAND_H
+#define TPGVVCPARTDATABASE_TPGOPERAND_H
+
+#include <cstdint>
+#include <string>
+#include <typeinfo>
+#include <utility>
+
+#include <gegelati.h>
+
+/// Layout of the input of a TPG, i.e. of the single data source of its Environment
+struct TPGInputLayout {
+    /// C++ type of the input values ("double" for the features, "uint8_t" for the pixels)
+    std::string cType;
+    /// Type of the input values
+    const std::type_info& type;
+    /// Width of the input (number of values for a 1D input)
+    uint64_t width;
+    /// Height of the input (1 for a 1D input)
+    uint64_t height;
+};
+
+/**
+* \brief Operand of a program line, resolved once for the inference backends (Cf. TPGCodeGenerator, FlatTPGEngine)
+*
+* Operands are resolved as in GEGELATI's ProgramExecutionEngine : data source 0 is the registers, 1 the constants of
+* the program (if any), then the data source of the Environment, the location being scaled to the address space of the
+* operand type (the possible positions of the window for an array).
+*/
+struct TPGOperand {
+    enum Source { REGISTER, CONSTANT, INPUT };
+
+    /// Where the operand is read
+    Source source;
+    /// Index of the (first) value read in its source
+    uint64_t offset;
+    /// Distance between two rows of a 2D window of the input (0 for any other operand)
+    uint64_t stride;
+    /// Number of values read (1 for a scalar, 9 for a Data::Constant[9] or a uint8_t[3][3], ...)
+    uint64_t size;
+
+    /**
+    * \brief Resolve an operand of a line
+    * \param[in] env the Environment of the program
+    * \param[in] input the layout of the data source of env
+    * \param[in] type the type of the operand (Cf. Instructions::Instruction::getOperandTypes())
+    * \param[in] operand the (data source, location) pair of the operand
+    * \throw std::runtime_error if the type is not supported or can't be read in the designated source
+    */
+    static TPGOperand resolve(const Environment& env, const TPGInputLayout& input, const std::type_info& type,
+                              const std::pair<uint64_t, uint64_t>& operand);
+};
+
+#endif //TPGVVCPARTDATABASE_TPGOPERAND_H
@@ -0,0 +1,133 @@
+#ifndef TPGVVCPARTDATABASE_INSTRUCTIONSETFACTORY_H
+#define TPGVVCPARTDATABASE_INSTRUCTIONSETFACTORY_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gegelati.h>
+
+/// Operation of an instruction, executed by the FlatTPGEngine (Cf. FlatProgramPool)
+enum class FlatOpcode : uint8_t {
+    // double instructions (registers or features)
+    MINUS, ADD, MULT, DIV, MAX, EXP, LN, MULT_BY_CONST,
+    // uint8_t instructions (pixels)
+    MINUS_U8, ADD_U8, MULT_U8, DIV_U8, MAX_U8, MULT_BY_CONST_U8,
+    // Data::Constant[9] x uint8_t[3][3] window of the pixels
+    CONV2D_U8,
+    // float instructions (features, Cf. FeatureType.h)
+    MINUS_F32, ADD_F32, MULT_F32, DIV_F32, MAX_F32, EXP_F32, LN_F32, MULT_BY_CONST_F32,
+    // Instruction the FlatTPGEngine can't execute (rejected by FlatProgramPool)
+    UNSUPPORTED
+};
+
+/**
+* \brief Instruction sets of the TPGs, built from a list of instruction names
+*
+* Every main (training, inference, code generation) builds its set from the same name lists (Cf. getPixelsNames(),
+* getFeaturesNames()...) : the instruction indices of a trained TPG are the same when it is imported. Each instruction
+* is a TypedInstructions::KernelInstruction, with its C++ template (Cf. TPGCodeGenerator) and, for the binary TPGs, its
+* opcode (Cf. FlatTPGEngine). The factory owns its instructions and deletes them.
+*
+* The training mains write the names of their set in SIGNATURE_FILE next to the exported TPGs (writeSignature()),
+* the inference mains check it before importing them (checkSignature()) : TPGs without this file are refused.
+*/
+class InstructionSetFactory {
+
+private:
+    /// Instruction available in the factory
+    struct NamedInstruction {
+        std::string name;
+        std::unique_ptr<Instructions::Instruction> (*create)();
+        /// C++ template of the instruction (Cf. TPGCodeGenerator)
+        std::string codeTemplate;
+        /// Opcode of the instruction in the FlatTPGEngine, FlatOpcode::UNSUPPORTED if it can't execute it
+        FlatOpcode opcode;
+    };
+
+    /// Every instruction available, by name
+    static const std::vector<NamedInstruction>& getAvailableInstructions();
+
+    /// Names of the instructions of the set, in the order of the set
+    const std::vector<std::string> names;
+
+    /// Instructions of the set (owned by the factory)
+    std::vector<std::unique_ptr<Instructions::Instruction>> instructions;
+
+    /// Entry of each instruction of the set in getAvailableInstructions()
+    std::vector<const NamedInstruction*> entries;
+
+    /// Instruction set of the TPGs
+    Instructions::Set set;
+
+public:
+    /// Helper functions used by the templates (copied in the generated files)
+    static const std::string HELPERS;
+
+    /// Name of the file listing the instructions of the exported TPGs
+    static const std::string SIGNATURE_FILE;
+
+    /**
+    * \brief Set of the classification TPG (Cf. classTPG.cpp) : uint8_t, NxN windows, double and conv2D instructions
+    * The windows are read from the integral images of the CU : the environment must provide an IntegralImageHandler.
+    */
+    static std::vector<std::string> getClassificationNames();
+
+    /// Set of the classification TPGs trained before the integral images : the NxN windows are copied from the pixels
+    static std::vector<std::string> getPixelWindowNames();
+
+    /// Set of the binary pixels TPGs (Cf. binaryTPGs.cpp) : uint8_t, double and conv2D instructions
+    static std::vector<std::string> getPixelsNames();
+
+    /// Set of the binary features TPGs (Cf. binaryFeaturesTPG.cpp) : double instructions (then float ones in a FEATURES_FLOAT build)
+    static std::vector<std::string> getFeaturesNames();
+
+    /// Set of the classification features TPG (Cf. featuresTPG.cpp) : the binary features set with a double conv2D
+    static std::vector<std::string> getClassificationFeaturesNames();
+
+    /**
+    * \brief Build an instruction set
+    * \param[in] names the names of the instructions, in the order of the set
+    * \throw std::runtime_error if a name is unknown
+    */
+    explicit InstructionSetFactory(std::vector<std::string> names);
+
+    /// The set references the instructions of the factory
+    InstructionSetFactory(const InstructionSetFactory&) = delete;
+    InstructionSetFactory& operator=(const InstructionSetFactory&) = delete;
+
+    /// Getter for set
+    const Instructions::Set& getSet() const;
+
+    /// Getter for names
+    const std::vector<std::string>& getNames() const;
+
+    /**
+    * \brief C++ template of each instruction of the set (Cf. TPGCodeGenerator)
+    * \throw std::runtime_error if an instruction has no template
+    */
+    std::vector<std::string> getTemplates() const;
+
+    /**
+    * \brief Opcode of each instruction of the set (Cf. FlatTPGEngine)
+    * \throw std::runtime_error if an instruction can't be flattened
+    */
+    std::vector<FlatOpcode> getOpcodes() const;
+
+    /**
+    * \brief Write the names of the instructions in directory/SIGNATURE_FILE, one per line
+    * \param[in] directory the directory of the exported TPGs (with the final '/', empty for the working directory)
+    */
+    void writeSignature(const std::string& directory) const;
+
+    /**
+    * \brief Check the names of directory/SIGNATURE_FILE against the set
+    * \param[in] directory the directory of the imported TPGs (with the final '/', empty for the working directory)
+    * \throw std::runtime_error if SIGNATURE_FILE is missing or if the TPGs of the directory were trained with another
+    * instruction set
+    */
+    void checkSignature(const std::string& directory) const;
+};
+
+#endif //TPGVVCPARTDATABASE_INSTRUCTIONSETFACTORY_H
@@ -0,0 +1,84 @@
+#ifndef TPGVVCPARTDATABASE_INTEGRALIMAGEHANDLER_H
+#define TPGVVCPARTDATABASE_INTEGRALIMAGEHANDLER_H
+
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+#include <gegelati.h>
+
+/**
+* \brief Sum of the pixels and sum of their squares over an NxN window of a CU
+* Operand of the window instructions (Cf. TypedInstructions::WindowMean), provided by an IntegralImageHandler.
+*/
+template <int N> struct WindowSums {
+    uint32_t sum;
+    uint32_t squareSum;
+};
+
+/**
+* \brief Data source exposing the summed-area tables (integral images) of the pixels of a CU
+*
+* The table of the pixels and the table of their squares are built once per CU (setPixels()), then every NxN window
+* (2 <= N <= 5) is provided as a WindowSums<N> computed with 4 lookups in each table, whatever N : the window
+* instructions no longer copy and sum the N*N pixels at each execution.
+* The address of a window is the one of its top-left pixel, among the (width - N + 1) x (height - N + 1) windows.
+*/
+class IntegralImageHandler : public Data::DataHandler {
+
+private:
+    /// Dimensions of the CU
+    const size_t width;
+    const size_t height;
+
+    /// (width + 1) x (height + 1) tables, row by row : the value at (x, y) is the sum over the pixels [0, x[ x [0, y[
+    std::vector<uint32_t> sums;
+    std::vector<uint32_t> squareSums;
+
+    /**
+    * \brief Window of each size returned by the last getDataAt(), no allocation of the sums at each fetch
+    * The window instructions have a single operand : a window is used before the next one of the same size is fetched.
+    */
+    mutable std::tuple<WindowSums<2>, WindowSums<3>, WindowSums<4>, WindowSums<5>> fetchedWindows;
+
+    /**
+    * \brief Size N of the windows of a type
+    * \return N if type is WindowSums<N> with MIN_WINDOW <= N <= MAX_WINDOW, else 0
+    */
+    static int getWindowSize(const std::type_info& type);
+
+    /// Sum over the window of size n at the given address in the table
+    uint32_t getWindowSum(const std::vector<uint32_t>& table, int n, size_t address) const;
+
+    template <int N> Data::UntypedSharedPtr getWindow(size_t address) const;
+
+protected:
+    size_t updateHash() const override;
+
+public:
+    /// Sizes of the windows provided
+    static const int MIN_WINDOW = 2;
+    static const int MAX_WINDOW = 5;
+
+    /**
+    * \brief Handler of a CU of width x height pixels, zero until the first call to setPixels()
+    */
+    IntegralImageHandler(size_t width, size_t height);
+
+    /**
+    * \brief Build the tables of a new CU
+    * \param[in] pixels the width x height pixels of the CU, row by row
+    */
+    void setPixels(const uint8_t* pixels);
+
+    // -------- DataHandler --------
+    bool canHandle(const std::type_info& type) const override;
+    size_t getAddressSpace(const std::type_info& type) const override;
+    size_t getLargestAddressSpace() const override;
+    void resetData() override;
+    const Data::UntypedSharedPtr getDataAt(const std::type_info& type, const size_t address) const override;
+    std::vector<size_t> getAddressesAccessed(const std::type_info& type, const size_t address) const override;
+    Data::DataHandler* clone() const override;
+};
+
+#endif //TPGVVCPARTDATABASE_INTEGRALIMAGEHANDLER_H
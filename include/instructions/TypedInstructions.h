@@ -0,0 +1,171 @@
+#ifndef TPGVVCPARTDATABASE_TYPEDINSTRUCTIONS_H
+#define TPGVVCPARTDATABASE_TYPEDINSTRUCTIONS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <gegelati.h>
+
+#include "IntegralImageHandler.h"
+
+/**
+* \brief Instructions of the TPGs, as concrete Instructions::Instruction subclasses (Cf. InstructionSetFactory)
+*
+* A KernelInstruction takes its operand types as template parameters and its operation from the static compute()
+* function of a kernel : unlike Instructions::LambdaInstruction, no std::function is called, the kernel is inlined in
+* execute(). The kernels perform the same operations, in the same order, as the lambdas the TPGs were trained with.
+*/
+namespace TypedInstructions {
+
+    /// Access to a scalar operand, passed by reference to the kernel
+    template <typename T> struct Operand {
+        typedef std::shared_ptr<const T> Holder;
+        static Holder hold(const Data::UntypedSharedPtr& argument) { return argument.getSharedPointer<const T>(); }
+        static const T& get(const Holder& holder) { return *holder; }
+    };
+
+    /// Access to an array operand (1D or 2D), passed to the kernel as a pointer to its first element (or row)
+    template <typename T, size_t N> struct Operand<T[N]> {
+        typedef std::shared_ptr<const std::remove_all_extents_t<T>[]> Holder;
+        static Holder hold(const Data::UntypedSharedPtr& argument)
+        {
+            return argument.getSharedPointer<const std::remove_all_extents_t<T>[]>();
+        }
+        static const T* get(const Holder& holder) { return reinterpret_cast<const T*>(holder.get()); }
+    };
+
+    /**
+    * \brief Instruction computing Kernel::compute() on operands of types Operands
+    *
+    * \tparam Kernel a struct with a static compute() function taking the operands (Cf. Operand)
+    * \tparam Operands the operand types, without const (e.g. uint8_t[3][3])
+    */
+    template <class Kernel, typename... Operands>
+    class KernelInstruction final : public Instructions::Instruction {
+
+    private:
+        template <size_t... I>
+        double executeKernel(const std::vector<Data::UntypedSharedPtr>& arguments, std::index_sequence<I...>) const
+        {
+            // The holders keep the operands alive (e.g. a window copied by the data source) during the computation
+            std::tuple<typename Operand<Operands>::Holder...> holders(Operand<Operands>::hold(arguments[I])...);
+            return Kernel::compute(Operand<Operands>::get(std::get<I>(holders))...);
+        }
+
+    public:
+        KernelInstruction()
+        {
+            (this->operandTypes.push_back(typeid(Operands)), ...);
+        }
+
+        double execute(const std::vector<Data::UntypedSharedPtr>& arguments) const override
+        {
+#ifndef NDEBUG
+            if (!this->checkOperandTypes(arguments))
+                return 0.0;
+#endif
+            return this->executeKernel(arguments, std::index_sequence_for<Operands...>());
+        }
+    };
+
+    // ------------------ Elementary kernels (uint8_t, double or float operands) ------------------
+    struct Minus { template <typename T> static double compute(T a, T b) { return a - b; } };
+    struct Add   { template <typename T> static double compute(T a, T b) { return a + b; } };
+    struct Mult  { template <typename T> static double compute(T a, T b) { return a * b; } };
+    struct Max   { template <typename T> static double compute(T a, T b) { return std::max(a, b); } };
+    struct Exp   { template <typename T> static double compute(T a) { return std::exp(a); } };
+    struct Ln    { template <typename T> static double compute(T a) { return std::log(a); } };
+
+    struct Div {
+        template <typename T> static double compute(T a, T b)
+        {
+            // b is cast to double for uint8_t to avoid the integer division by zero
+            if constexpr (std::is_integral<T>::value)
+                return a / (double) b;
+            else
+                return a / b;
+        }
+    };
+
+    struct MultByConst {
+        template <typename T> static double compute(T a, const Data::Constant& c)
+        {
+            if constexpr (std::is_same<T, float>::value)
+                return a * (float) c.value;
+            else
+                return a * (double) c;
+        }
+    };
+
+    /**
+    * \brief 3x3 convolution of a window of the data source
+    * On pixels, the products and their sum are integers : they are computed on int64_t, exactly as the double
+    * accumulation of the training lambda (at most 2^43, below the 2^53 mantissa) but without 18 conversions.
+    */
+    struct Conv2D {
+        template <typename T> static double compute(const Data::Constant* coeff, const T (*data)[3])
+        {
+            if constexpr (std::is_integral<T>::value)
+            {
+                int64_t sum = 0;
+                for (int i = 0; i < 3; i++)
+                    for (int j = 0; j < 3; j++)
+                        sum += (int64_t) coeff[i * 3 + j].value * data[i][j];
+                return (double) sum;
+            }
+            double res = 0.0;
+            for (int i = 0; i < 3; i++)
+                for (int j = 0; j < 3; j++)
+                    res += (double) coeff[i * 3 + j] * data[i][j];
+            return res;
+        }
+    };
+
+    // ------------------ NxN window kernels of the classification TPG ------------------
+    /// Sum of the window, accumulated in an uint8_t as the training lambda (wraps above 255)
+    template <int N> struct Mean {
+        static double compute(const uint8_t (*data)[N])
+        {
+            uint8_t sum = 0;
+            for (int i = 0; i < N; i++)
+                for (int j = 0; j < N; j++)
+                    sum += data[i][j];
+            return sum;
+        }
+    };
+
+    /// Mean of the window : the training lambda sums the pixels, not their squared deviation
+    template <int N> struct Var {
+        static double compute(const uint8_t (*data)[N])
+        {
+            double sum = 0;
+            for (int i = 0; i < N; i++)
+                for (int j = 0; j < N; j++)
+                    sum += data[i][j];
+            return sum / (N * N);
+        }
+    };
+
+    // ------------------ NxN window kernels on the integral images of the CU (Cf. IntegralImageHandler) ------------------
+    /// Mean of the pixels of the window
+    template <int N> struct WindowMean {
+        static double compute(const WindowSums<N>& window) { return window.sum / (double) (N * N); }
+    };
+
+    /// Variance of the pixels of the window : (N*N * sum(x^2) - sum(x)^2) / (N*N)^2, computed exactly on integers
+    template <int N> struct WindowVar {
+        static double compute(const WindowSums<N>& window)
+        {
+            const int64_t nbPixels = N * N;
+            return (double) (nbPixels * window.squareSum - (int64_t) window.sum * window.sum) / (double) (nbPixels * nbPixels);
+        }
+    };
+}
+
+#endif //TPGVVCPARTDATABASE_TYPEDINSTRUCTIONS_H
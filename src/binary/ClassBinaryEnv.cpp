@@ -1,4 +1,5 @@
 #include "../../include/binary/ClassBinaryEnv.h"
+#include <cstring>
 #include <vector>
 
 // ********************************************************************* //
@@ -18,6 +19,8 @@ std::vector<std::reference_wrapper<const Data::DataHandler>> BinaryClassifEnv::g
 {
     // Return a vector containing every element constituting the State of the environment
     std::vector<std::reference_wrapper<const Data::DataHandler>> result{this->currentCU};
+    if (this->integralImages)
+        result.emplace_back(this->currentCUSums);
     return result;
 }
 
@@ -61,18 +64,11 @@ bool BinaryClassifEnv::isTerminal() const
 // *************************** PartCU FUNCTIONS ************************ //
 // ********************************************************************* //
 
-// ****** TRAINING Arguments ******
-std::vector<Data::PrimitiveTypeArray2D<uint8_t> *> *BinaryClassifEnv::trainingTargetsCU = new std::vector<Data::PrimitiveTypeArray2D<uint8_t>*>;
-std::vector<uint8_t> *BinaryClassifEnv::trainingTargetsOptimalSplits = new std::vector<uint8_t>;
-// ****** VALIDATION Arguments ******
-std::vector<Data::PrimitiveTypeArray2D<uint8_t>*> *BinaryClassifEnv::validationTargetsCU = new std::vector<Data::PrimitiveTypeArray2D<uint8_t>*>;
-std::vector<uint8_t> *BinaryClassifEnv::validationTargetsOptimalSplits = new std::vector<uint8_t>;
-
-Data::PrimitiveTypeArray2D<uint8_t> *BinaryClassifEnv::getRandomCU(Learn::LearningMode mode, const char current_CU_path[100])
+bool BinaryClassifEnv::getRandomCU(Mutator::RNG& loaderRng, TargetStore<uint8_t>& targets, uint64_t idx, const char current_CU_path[100])
 {
     // ------------------ Opening and Reading a random CU file ------------------
     // Generate the path for a random CU
-    uint32_t next_CU_number = this->rng.getInt32(0, NB_TRAINING_ELEMENTS - 1);
+    uint32_t next_CU_number = loaderRng.getInt32(0, NB_TRAINING_ELEMENTS - 1);
     char next_CU_number_string[100];
     std::sprintf(next_CU_number_string, "%d", next_CU_number);
     char CU_path[100];
@@ -88,7 +84,7 @@ Data::PrimitiveTypeArray2D<uint8_t> *BinaryClassifEnv::getRandomCU(Learn::Learni
         char error_file_path[300] = "File opening failed : ";
         std::strcat(error_file_path, CU_path);
         std::perror(error_file_path);
-        return nullptr; // return EXIT_FAILURE;
+        return false;
     }
 
     // Stocking content in a uint8_t tab, first 32x32 uint8_t are CU pixels values and the 1025th value is the optimal split
@@ -100,18 +96,9 @@ Data::PrimitiveTypeArray2D<uint8_t> *BinaryClassifEnv::getRandomCU(Learn::Learni
     // Important ...
     std::fclose(input);
 
-    // Creating a new PrimitiveTypeArray<uint8_t> and filling it
-    auto *randomCU = new Data::PrimitiveTypeArray2D<uint8_t>(32, 32);   // 2D Array
-    for (uint32_t pxlIndex = 0; pxlIndex < 32 * 32; pxlIndex++)
-        randomCU->setDataAt(typeid(uint8_t), pxlIndex, contents[pxlIndex]);
-
-    // Updating the corresponding optimal split depending of the current mode
-    if (mode == Learn::LearningMode::TRAINING)
-        BinaryClassifEnv::trainingTargetsOptimalSplits->push_back(contents[1024]);
-    else if (mode == Learn::LearningMode::VALIDATION)
-        BinaryClassifEnv::validationTargetsOptimalSplits->push_back(contents[1024]);
-
-    return randomCU;
+    // Storing the 32x32 pixels values and the optimal split in the given targets, the row will be wrapped by currentCU in LoadNextCU()
+    std::memcpy(targets.setTarget(idx, contents[1024]), &contents[0], 32 * 32);
+    return true;
 }
 
 void BinaryClassifEnv::UpdatingTargets(uint64_t currentGen, const char current_CU_path[100])
@@ -119,105 +106,140 @@ void BinaryClassifEnv::UpdatingTargets(uint64_t currentGen, const char current_C
     // Each ${nbGeneTargetChange} generation, generate new random training targets so that different targets are used
     if (currentGen % NB_GENERATION_BEFORE_TARGETS_CHANGE == 0)
     {
-        // ---  Deleting old targets ---
-        if (currentGen != 0) // Don't clear trainingTargets before initializing them
+        if (currentGen == 0) // Load VALIDATION Targets at the beginning of the training (i == 0)
         {
-            this->reset(0, Learn::LearningMode::TRAINING);
-            for (uint64_t idx_targ = 0; idx_targ < NB_TRAINING_TARGETS; idx_targ++)
-                delete BinaryClassifEnv::trainingTargetsCU->at(idx_targ);   // targets are allocated in getRandomCU()
-            BinaryClassifEnv::trainingTargetsCU->clear();
-            BinaryClassifEnv::trainingTargetsOptimalSplits->clear();
-            this->actualTrainingCU = 0;
-        }
-        else        // Load VALIDATION Targets at the beginning of the training (i == 0)
-        {
-            for (uint64_t idx_targ = 0; idx_targ < NB_VALIDATION_TARGETS; idx_targ++)
-            {
-                Data::PrimitiveTypeArray2D<uint8_t>* target = this->getRandomCU(Learn::LearningMode::VALIDATION, current_CU_path);
-                BinaryClassifEnv::validationTargetsCU->push_back(target);
-            }
+            auto validationStore = std::make_shared<TargetStore<uint8_t>>(32 * 32);
+            this->loadTargets(ParallelTargetsLoader::VALIDATION_STREAM, NB_VALIDATION_TARGETS, *validationStore, current_CU_path);
+            this->validationTargets = validationStore;
+            this->confusionMatrixCache.clear();
         }
 
-        // ---  Loading next targets ---
-        for (uint64_t idx_targ = 0; idx_targ < NB_TRAINING_TARGETS; idx_targ++)
+        // ---  Loading next targets in the rows retired at the previous change (unless a clone still uses them) ---
+        // The current targets stay published until the new ones are loaded, even if the loading fails
+        std::shared_ptr<TargetStore<uint8_t>> trainingStore = TargetStore<uint8_t>::recycle(std::move(this->retiredTrainingTargets), 32 * 32);
+        this->loadTargets(currentGen, NB_TRAINING_TARGETS, *trainingStore, current_CU_path);
+
+        // ---  Publishing them ---
+        this->retiredTrainingTargets = std::move(this->trainingTargets);
+        this->trainingTargets = std::move(trainingStore);
+        if (currentGen != 0)
         {
-            Data::PrimitiveTypeArray2D<uint8_t>* target = this->getRandomCU(Learn::LearningMode::TRAINING, current_CU_path);
-            BinaryClassifEnv::trainingTargetsCU->push_back(target);
-            // Optimal split is saved in LE->trainingTargetsOptimalSplits inside getRandomCU()
+            // Only now : reset() wraps the first new target in currentCU, no pointer on the retired rows remains
+            this->actualTrainingCU = 0;
+            this->reset(0, Learn::LearningMode::TRAINING);
+            this->actualTrainingCU = 0;
         }
     }
 }
 
+bool BinaryClassifEnv::getRandomCUFromPackedDatabase(Mutator::RNG& loaderRng, const PackedCUDatabase& database, TargetStore<uint8_t>& targets, uint64_t idx)
+{
+    // Same random draw as with getRandomCU()
+    uint32_t next_CU_number = loaderRng.getInt32(0, (int) NB_TRAINING_ELEMENTS - 1);
+
+    // Record in the mapping : 32x32 pixels values followed by the optimal split
+    const uint8_t* record = database.getCU(next_CU_number);
+
+    // Copying the pixels at once, the row will be wrapped by currentCU in LoadNextCU()
+    std::memcpy(targets.setTarget(idx, record[1024]), record, 32 * 32);
+    return true;
+}
+
+void BinaryClassifEnv::loadTargets(uint64_t stream, uint64_t nbTargets, TargetStore<uint8_t>& targets, const char current_CU_path[100])
+{
+    const PackedCUDatabase* database = nullptr;
+    if (PackedCUDatabase::isPackedDatabase(current_CU_path))
+    {
+        database = &PackedCUDatabase::getShared(current_CU_path);
+        if (database->getCuHeight() != 32 || database->getCuWidth() != 32)
+            throw std::runtime_error("Packed database " + database->getPath() + " does not contain 32x32 CUs");
+    }
+
+    targets.resize(nbTargets);
+    std::vector<uint64_t> failed = ParallelTargetsLoader::run(nbTargets, this->nbLoadingThreads, [&](uint64_t idx) {
+        // Each target has its own RNG : same targets whatever the number of threads
+        Mutator::RNG loaderRng(ParallelTargetsLoader::getSubstreamSeed(this->seed, stream, idx));
+        if (database)
+            return this->getRandomCUFromPackedDatabase(loaderRng, *database, targets, idx);
+        return this->getRandomCU(loaderRng, targets, idx, current_CU_path);
+    });
+    targets.removeTargets(failed);
+    PhaseTimers::countLoadedCUs(nbTargets - failed.size(), (nbTargets - failed.size()) * targets.getRowSize() * sizeof(uint8_t));
+    // The environments loop on the loaded targets only : an empty store can't be used
+    if (targets.size() == 0 && nbTargets != 0)
+        throw std::runtime_error("No target could be loaded from " + std::string(current_CU_path));
+}
+
+void BinaryClassifEnv::setNbLoadingThreads(size_t nbThreads)
+{
+    this->nbLoadingThreads = nbThreads;
+}
+
+void BinaryClassifEnv::setIntegralImages(bool enabled)
+{
+    this->integralImages = enabled;
+}
+
 void BinaryClassifEnv::LoadNextCU()
 {
     // Checking validity is no longer necessary
     if (this->currentMode == Learn::LearningMode::TRAINING)
     {
-        this->currentCU = *BinaryClassifEnv::trainingTargetsCU->at(this->actualTrainingCU);
+        std::vector<uint8_t>* target = this->trainingTargets->getTarget(this->actualTrainingCU);
+        this->currentCU.setPointer(target);
+        if (this->integralImages)
+            this->currentCUSums.setPixels(target->data());
 
         // Updating next split solution :
         //   -  If the optimal split is not the specialized action, the optimal split is set to 0
         //   -  Else the optimal split is set to 1
-        this->currentClass = (BinaryClassifEnv::trainingTargetsOptimalSplits->at(this->actualTrainingCU) != this->specializedAction) ? 0 : 1;
+        this->currentClass = (this->trainingTargets->getLabel(this->actualTrainingCU) != this->specializedAction) ? 0 : 1;
         this->actualTrainingCU++;
 
         // Looping on the beginning of training targets
-        if (this->actualTrainingCU >= NB_TRAINING_TARGETS)
+        if (this->actualTrainingCU >= this->trainingTargets->size())
             this->actualTrainingCU = 0;
     }
     else if (this->currentMode == Learn::LearningMode::VALIDATION)
     {
-        this->currentCU = *BinaryClassifEnv::validationTargetsCU->at(this->actualValidationCU);
+        std::vector<uint8_t>* target = this->validationTargets->getTarget(this->actualValidationCU);
+        this->currentCU.setPointer(target);
+        if (this->integralImages)
+            this->currentCUSums.setPixels(target->data());
 
         // Updating next split solution :
         //   -  If the optimal split is not the specialized action, the optimal split is set to 0
         //   -  Else the optimal split is set to 1
-        this->currentClass = (BinaryClassifEnv::validationTargetsOptimalSplits->at(this->actualValidationCU) != this->specializedAction) ? 0 : 1;
+        this->currentClass = (this->validationTargets->getLabel(this->actualValidationCU) != this->specializedAction) ? 0 : 1;
         this->actualValidationCU++;
 
         // Looping on the beginning of validation targets
-        if (this->actualValidationCU >= NB_VALIDATION_TARGETS)
+        if (this->actualValidationCU >= this->validationTargets->size())
             this->actualValidationCU = 0;
     }
 }
 
-void BinaryClassifEnv::printClassifStatsTable(const Environment& env, const TPG::TPGVertex* bestRoot, const int numGen, std::string const& outputFile, bool readable)
+const ConfusionMatrix& BinaryClassifEnv::getConfusionMatrix(const Environment& env, const TPG::TPGVertex* root)
 {
-    // Create a new TPGExecutionEngine from the environment
-    TPG::TPGExecutionEngine tee(env, nullptr);
-
-    // Change the LearningMode in VALIDATION
-    this->reset(0, Learn::LearningMode::VALIDATION);
+    // Unchanged root since the last call : same matrix
+    return this->confusionMatrixCache.get(root, [&]() {
+        // Fill the table : the validation targets are split between nbLoadingThreads clones of this environment
+        return ConfusionMatrix(ParallelValidation::run(*this, env, *root, this->validationTargets->size(), 2, this->nbLoadingThreads,
+                [](Learn::LearningEnvironment& le, uint64_t idx) {
+                    // Load the validation target idx in the clone and get answer
+                    auto& clone = (BinaryClassifEnv&) le;
+                    clone.actualValidationCU = idx;
+                    clone.LoadNextCU();
+                    return (uint64_t) clone.currentClass;
+                }));
+    });
+}
 
-    // Fill the table
+void BinaryClassifEnv::printClassifStatsTable(const ConfusionMatrix& matrix, const int numGen, std::string const& outputFile, bool readable)
+{
     const int nbClasses = 2;
-
-    uint64_t classifTable[nbClasses][nbClasses] = {{0}};
-    uint64_t nbPerClass[nbClasses] = {0};
-    uint8_t actionID;
-
-    for (uint64_t nbImage = 0; nbImage < this->NB_VALIDATION_TARGETS; nbImage++)
-    {
-        // Get answer
-        uint64_t optimalActionID = this->currentClass;
-        nbPerClass[optimalActionID]++;
-
-        // std::cout << optimalActionID << " : " << nbPerClass[optimalActionID] << std::endl;
-
-        // Execute
-        auto path = tee.executeFromRoot(*bestRoot);
-        const auto *action = (const TPG::TPGAction *) path.at(path.size() - 1);
-        actionID = (uint8_t) action->getActionID();
-
-        // Increment table
-        classifTable[optimalActionID][actionID]++;
-
-        // Do action in order to trigger image update and load the next CU
-        this->LoadNextCU();
-    }
-
-    // Reset the learning mode to TESTING
-    this->reset(0, Learn::LearningMode::TESTING);
+    const std::vector<std::vector<uint64_t>>& classifTable = matrix.getTable();
+    std::vector<uint64_t> nbPerClass = matrix.getNbPerClass();
 
     // Computing Score and ScoreMax
     double validationScore = 0.0;
@@ -335,4 +357,9 @@ int BinaryClassifEnv::getSpecializedAction() const { return specializedAction; }
 Mutator::RNG BinaryClassifEnv::getRng() const { return rng; }
 uint8_t BinaryClassifEnv::getOptimalSplit() const { return this->currentClass; }
 
-void BinaryClassifEnv::setCurrentCu(const Data::PrimitiveTypeArray2D<uint8_t> &currentCu) { currentCU = currentCu; }
+void BinaryClassifEnv::setCurrentCu(std::vector<uint8_t> &currentCu)
+{
+    currentCU.setPointer(&currentCu);
+    if (this->integralImages)
+        this->currentCUSums.setPixels(currentCu.data());
+}
@@ -9,6 +9,8 @@
 
 #include "../../include/binary/DefaultBinaryEnv.h"
 #include "../../include/binary/ClassBinaryEnv.h"
+#include "../../include/inference/TPGBinaryExporter.h"
+#include "../../include/instructions/InstructionSetFactory.h"
 
 /**
  * \brief Manage training run : press 'q' or 'Q' to stop the training
@@ -46,55 +48,9 @@ int main(int argc, char* argv[])
 
     // ************************************************** INSTRUCTIONS *************************************************
 
-    // Create the instruction set for programs
-    Instructions::Set set;
-
-    // uint8_t instructions (for pixels values)
-    auto minus = [](uint8_t a, uint8_t b)->double {return a - b; };
-    auto add   = [](uint8_t a, uint8_t b)->double {return a + b; };
-    auto mult  = [](uint8_t a, uint8_t b)->double {return a * b; };
-    auto div   = [](uint8_t a, uint8_t b)->double {return a / (double)b; }; // cast b to double to avoid div by zero (uint8_t)
-    auto max   = [](uint8_t a, uint8_t b)->double {return std::max(a, b); };
-    auto multByConst = [](uint8_t a, Data::Constant c)->double {return a * (double)c; };
-
-    // double instructions (for TPG programs)
-    auto minus_double = [](double a, double b)->double {return a - b; };
-    auto add_double   = [](double a, double b)->double {return a + b; };
-    auto mult_double  = [](double a, double b)->double {return a * b; };
-    auto div_double   = [](double a, double b)->double {return a / b; };
-    auto max_double   = [](double a, double b)->double {return std::max(a, b); };
-    auto ln_double    = [](double a)->double {return std::log(a); };
-    auto exp_double   = [](double a)->double {return std::exp(a); };
-    auto multByConst_double = [](double a, Data::Constant c)->double {return a * (double)c; };
-    auto conv2D_double = [](const Data::Constant coeff[9], const uint8_t data[3][3])->double
-    {
-        double res = 0.0;
-        for (int i = 0; i < 3; i++)
-            for (int j = 0; j < 3; j++)
-                res += (double)coeff[i * 3 + j] * data[i][j];
-        return res;
-    };
-
-    // Add those instructions to instruction set
-    // uint8_t
-    set.add(*(new Instructions::LambdaInstruction<uint8_t, uint8_t>(minus)));
-    set.add(*(new Instructions::LambdaInstruction<uint8_t, uint8_t>(add)));
-    set.add(*(new Instructions::LambdaInstruction<uint8_t, uint8_t>(mult)));
-    set.add(*(new Instructions::LambdaInstruction<uint8_t, uint8_t>(div)));
-    set.add(*(new Instructions::LambdaInstruction<uint8_t, uint8_t>(max)));
-    set.add(*(new Instructions::LambdaInstruction<uint8_t, Data::Constant>(multByConst)));
-
-    // double
-    set.add(*(new Instructions::LambdaInstruction<double, double>(minus_double)));
-    set.add(*(new Instructions::LambdaInstruction<double, double>(add_double)));
-    set.add(*(new Instructions::LambdaInstruction<double, double>(mult_double)));
-    set.add(*(new Instructions::LambdaInstruction<double, double>(div_double)));
-    set.add(*(new Instructions::LambdaInstruction<double, double>(max_double)));
-    set.add(*(new Instructions::LambdaInstruction<double>(exp_double)));
-    set.add(*(new Instructions::LambdaInstruction<double>(ln_double)));
-    set.add(*(new Instructions::LambdaInstruction<double, Data::Constant>(multByConst_double)));
-    set.add(*(new Instructions::LambdaInstruction<const Data::Constant[9], const uint8_t[3][3]>(conv2D_double)));
-
+    // Create the instruction set for programs (Cf. InstructionSetFactory)
+    // uint8_t instructions for the pixels, double instructions for the registers, conv2D
+    InstructionSetFactory instructions(InstructionSetFactory::getPixelsNames());
 
     // ******************************************* PARAMETERS AND ENVIRONMENT ******************************************
 
@@ -123,11 +79,12 @@ int main(int argc, char* argv[])
     // ---------------- Instantiate Environment and Agent ----------------
     // LearningEnvironment
     auto *LE = new BinaryClassifEnv({0, 1}, speAct, nbTrainingElements, nbTrainingTargets, nbGeneTargetChange, nbValidationTarget, 0);
+    LE->setNbLoadingThreads(params.nbThreads);
     // Creating a second environment used to compute the classification table
-    Environment env(set, LE->getDataSources(), params.nbRegisters, params.nbProgramConstant);
+    Environment env(instructions.getSet(), LE->getDataSources(), params.nbRegisters, params.nbProgramConstant);
 
     // Instantiate and Init the Learning Agent (non-parallel : LearningAgent / parallel ParallelLearningAgent)
-    Learn::ParallelLearningAgent la(*LE, set, params);
+    Learn::ParallelLearningAgent la(*LE, instructions.getSet(), params);
     la.init();
 
     // ---------------- Initialising paths ----------------
@@ -164,6 +121,7 @@ int main(int argc, char* argv[])
 
     //const char parametersPrintPath[100] = "/home/cleonard/dev/TpgVvcPartDatabase/build/jsonParams.json";
     std::string const fileClassificationTableName("/home/cleonard/dev/TpgVvcPartDatabase/fileClassificationTable.txt");
+    std::string const memoryUsageName("/home/cleonard/dev/TpgVvcPartDatabase/memoryUsage.csv");
 
     // ---------------- Printing training overview  ----------------
     std::cout << "This binary TPG is specialized in the " << speActionName << " split" << std::endl << std::endl;
@@ -201,6 +159,14 @@ int main(int argc, char* argv[])
     stats.open("bestPolicyStats.md");
     Log::LAPolicyStatsLogger policyStatsLogger(la, stats);
 
+    // Time spent in each phase of the generations, one line per generation (Cf. PhaseTimers)
+    PhaseTimers phaseTimers("phaseTimings.csv");
+    PhaseTimersLogger phaseTimersLogger(la, phaseTimers);
+#ifdef MEMORY_TRACKING
+    // Memory of each phase, next to the classification tables (Cf. MemoryTracker)
+    phaseTimers.enableMemoryReport(memoryUsageName);
+#endif
+
 
     // *********************************************** MAIN TRAINING LOOP **********************************************
 
@@ -210,20 +176,30 @@ int main(int argc, char* argv[])
     for (uint64_t i = 0; i < params.nbGenerations && !exitProgram; i++)
     {
         // Update Training and Validation targets depending on the generation
-        LE->UpdatingTargets(i, datasetPath);
+        {
+            PhaseTimers::Scope scope(phaseTimers, PhaseTimers::TARGETS);
+            LE->UpdatingTargets(i, datasetPath);
+        }
 
         // Save best generation policy
-        char buff[20];
-        sprintf(buff, "out_%" PRIu64 ".dot", i);
-        dotExporter.setNewFilePath(buff);
-        dotExporter.print();
+        {
+            PhaseTimers::Scope scope(phaseTimers, PhaseTimers::FILES);
+            char buff[20];
+            sprintf(buff, "out_%" PRIu64 ".dot", i);
+            dotExporter.setNewFilePath(buff);
+            dotExporter.print();
+        }
 
         // Train
         la.trainOneGeneration(i);
 
         // Print Classification Table
         const TPG::TPGVertex* bestRoot = la.getBestRoot().first;
-        LE->printClassifStatsTable(env, bestRoot, (int) i, fileClassificationTableName, false);
+        phaseTimers.start(PhaseTimers::VALIDATION);
+        const ConfusionMatrix& bestRootMatrix = LE->getConfusionMatrix(env, bestRoot);   // Both reports are written from one evaluation
+        phaseTimers.start(PhaseTimers::FILES);
+        LE->printClassifStatsTable(bestRootMatrix, (int) i, fileClassificationTableName, false);
+        phaseTimers.writeGeneration(i);
     }
 
     // ************************************************** TRAINING END *************************************************
@@ -231,6 +207,11 @@ int main(int argc, char* argv[])
     la.keepBestPolicy();
     dotExporter.setNewFilePath("out_best.dot");
     dotExporter.print();
+    // Compact binary export of the best policy, loaded by the inference programs (Cf. TPGModelRegistry)
+    TPGBinaryExporter binaryExporter("out_best.tpgb", la.getTPGGraph());
+    binaryExporter.print(la.getBestRoot().first);
+    // Names of the instructions, checked when the TPGs are imported
+    instructions.writeSignature("");
 
     TPG::PolicyStats ps;
     ps.setEnvironment(la.getTPGGraph().getEnvironment());
@@ -244,8 +225,6 @@ int main(int argc, char* argv[])
     stats.close();
 
     // cleanup
-    for (unsigned int i = 0; i < set.getNbInstructions(); i++)
-        delete (&set.getInstruction(i));
     delete LE;
 
 #ifndef NO_CONSOLE_CONTROL
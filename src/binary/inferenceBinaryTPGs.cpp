@@ -7,9 +7,10 @@
 
 #include "../../include/binary/DefaultBinaryEnv.h"
 #include "../../include/binary/ClassBinaryEnv.h"
+#include "../../include/inference/TPGModelRegistry.h"
+#include "../../include/instructions/InstructionSetFactory.h"
 
-void importTPG(BinaryClassifEnv* le, Environment& env, TPG::TPGGraph& tpg);
-Data::PrimitiveTypeArray2D<uint8_t>* getRandomCU(const char datasetPath[100], BinaryClassifEnv* le, std::vector<uint8_t>* splitList, uint64_t index_targ);
+std::vector<uint8_t>* getRandomCU(const char datasetPath[100], BinaryClassifEnv* le, std::vector<uint8_t>* splitList, uint64_t index_targ);
 void runOneTPG(const TPG::TPGVertex* root, TPG::TPGExecutionEngine& tee, BinaryClassifEnv* le);
 
 int main(int argc, char* argv[])
@@ -17,143 +18,62 @@ int main(int argc, char* argv[])
     std::cout << "Start VVC Partitionning Optimization with binary TPGs solution" << std::endl;
     int nbEval = 50;
     std::cout << nbEval << " evaluations" << std::endl;
+    // ************************************************** INSTRUCTIONS *************************************************
+
+    // Create the instruction set for programs : the set of the training, in the same order (Cf. InstructionSetFactory)
+    InstructionSetFactory instructions(InstructionSetFactory::getPixelsNames());
+    instructions.checkSignature(ROOT_DIR "/TPG/");
+
+    // ******************************************* PARAMETERS AND ENVIRONMENT ******************************************
+
+    // ---------------- Load and initialize parameters from .json file ----------------
+    Learn::LearningParameters params;
+    File::ParametersParser::loadParametersFromJson(ROOT_DIR "/TPG/params.json", params);
+
+    // Initialising the number of CUs used
+    uint64_t nbTrainingElements = 110000;   // Balanced database with 55000 elements of one class and 11000 elements of each other class : 110000
+    // Balanced database with full classes : 330000
+    // Unbalanced database : 1136424
+    // Number of CUs preload changed every nbGeneTargetChange generation for training and load only once for validation
+    uint64_t nbTrainingTargets = 10000;
+    uint64_t nbGeneTargetChange = 30;
+    uint64_t nbValidationTarget = 1000;
+
+    // ************************************************** INSTANCES *************************************************
+
+    // ---------------- Instantiate 1 LearningEnvironment and the registry of the 5 TPGs (imported once for every evaluation) ----------------
+    // Every binary TPG reads the same 32x32 CU: a single LearningEnvironment provides the data sources of the shared
+    // Environment, the TPGs only differ by their specializedAction (i.e. the .dot file imported).
+    auto *leNP = new BinaryClassifEnv({0, 1}, 0, nbTrainingElements, nbTrainingTargets, nbGeneTargetChange,
+                                      nbValidationTarget, 0);
+    TPGModelRegistry registry(instructions.getSet(), leNP->getDataSources(), params.nbRegisters, params.nbProgramConstant, ROOT_DIR "/TPG/");
+
+    // ---------------- Import TPG graph from .tpgb file (or .dot file) and flatten its policy ----------------
+    std::vector<FlatOpcode> opcodes = instructions.getOpcodes();
+    TPGInputLayout layout{"uint8_t", typeid(uint8_t), 32, 32};
+    FlatTPGEngine& tpgNP = registry.getFlatEngine(BinaryClassifEnv::getActionName(0), opcodes, layout);
+    FlatTPGEngine& tpgQT = registry.getFlatEngine(BinaryClassifEnv::getActionName(1), opcodes, layout);
+    FlatTPGEngine& tpgBTH = registry.getFlatEngine(BinaryClassifEnv::getActionName(2), opcodes, layout);
+    FlatTPGEngine& tpgBTV = registry.getFlatEngine(BinaryClassifEnv::getActionName(3), opcodes, layout);
+    //FlatTPGEngine& tpgTTH = registry.getFlatEngine(BinaryClassifEnv::getActionName(4), opcodes, layout);
+    FlatTPGEngine& tpgTTV = registry.getFlatEngine(BinaryClassifEnv::getActionName(5), opcodes, layout);
+    // Programs of the 5 TPGs, executed on batches of CUs
+    FlatProgramPool& programPool = tpgNP.getProgramPool();
+
+    // Path to the global database with 330.000 elements (55.000 of each class)
+    char datasetPath[100] = "/home/cleonard/Data/dataset_tpg_balanced/dataset_tpg_32x32_27_balanced2/";
+
     double moyenne = 0.0;
     for(int i = 0; i < nbEval; i++)
     {
-        // ************************************************** INSTRUCTIONS *************************************************
-
-        // Create the instruction set for programs
-        Instructions::Set set;
-
-        // uint8_t instructions (for pixels values)
-        auto minus = [](uint8_t a, uint8_t b) -> double { return a - b; };
-        auto add = [](uint8_t a, uint8_t b) -> double { return a + b; };
-        auto mult = [](uint8_t a, uint8_t b) -> double { return a * b; };
-        auto div = [](uint8_t a, uint8_t b) -> double {
-            return a / (double) b;
-        }; // cast b to double to avoid div by zero (uint8_t)
-        auto max = [](uint8_t a, uint8_t b) -> double { return std::max(a, b); };
-        auto multByConst = [](uint8_t a, Data::Constant c) -> double { return a * (double) c; };
-
-        // double instructions (for TPG programs)
-        auto minus_double = [](double a, double b) -> double { return a - b; };
-        auto add_double = [](double a, double b) -> double { return a + b; };
-        auto mult_double = [](double a, double b) -> double { return a * b; };
-        auto div_double = [](double a, double b) -> double { return a / b; };
-        auto max_double = [](double a, double b) -> double { return std::max(a, b); };
-        auto ln_double = [](double a) -> double { return std::log(a); };
-        auto exp_double = [](double a) -> double { return std::exp(a); };
-        auto multByConst_double = [](double a, Data::Constant c) -> double { return a * (double) c; };
-        auto conv2D_double = [](const Data::Constant coeff[9], const uint8_t data[3][3]) -> double {
-            double res = 0.0;
-            for (int i = 0; i < 3; i++) {
-                for (int j = 0; j < 3; j++) {
-                    res += (double) coeff[i * 3 + j] * data[i][j];
-                }
-            }
-            return res;
-        };
-
-        // Add those instructions to instruction set
-        set.add(*(new Instructions::LambdaInstruction<uint8_t, uint8_t>(minus)));
-        set.add(*(new Instructions::LambdaInstruction<uint8_t, uint8_t>(add)));
-        set.add(*(new Instructions::LambdaInstruction<uint8_t, uint8_t>(mult)));
-        set.add(*(new Instructions::LambdaInstruction<uint8_t, uint8_t>(div)));
-        set.add(*(new Instructions::LambdaInstruction<uint8_t, uint8_t>(max)));
-        set.add(*(new Instructions::LambdaInstruction<uint8_t, Data::Constant>(multByConst)));
-        set.add(*(new Instructions::LambdaInstruction<double, double>(minus_double)));
-        set.add(*(new Instructions::LambdaInstruction<double, double>(add_double)));
-        set.add(*(new Instructions::LambdaInstruction<double, double>(mult_double)));
-        set.add(*(new Instructions::LambdaInstruction<double, double>(div_double)));
-        set.add(*(new Instructions::LambdaInstruction<double, double>(max_double)));
-        set.add(*(new Instructions::LambdaInstruction<double>(exp_double)));
-        set.add(*(new Instructions::LambdaInstruction<double>(ln_double)));
-        set.add(*(new Instructions::LambdaInstruction<double, Data::Constant>(multByConst_double)));
-        set.add(*(new Instructions::LambdaInstruction<const Data::Constant[9], const uint8_t[3][3]>(conv2D_double)));
-
-        // ******************************************* PARAMETERS AND ENVIRONMENT ******************************************
-
-        // ---------------- Load and initialize parameters from .json file ----------------
-        Learn::LearningParameters params;
-        File::ParametersParser::loadParametersFromJson(ROOT_DIR "/TPG/params.json", params);
-
-        // Initialising the number of CUs used
-        uint64_t nbTrainingElements = 110000;   // Balanced database with 55000 elements of one class and 11000 elements of each other class : 110000
-        // Balanced database with full classes : 330000
-        // Unbalanced database : 1136424
-        // Number of CUs preload changed every nbGeneTargetChange generation for training and load only once for validation
-        uint64_t nbTrainingTargets = 10000;
-        uint64_t nbGeneTargetChange = 30;
-        uint64_t nbValidationTarget = 1000;
-
-        // ************************************************** INSTANCES *************************************************
-
-        // ---------------- Instantiate 6 LearningEnvironments, 6 Environments, 6 TPGGraphs and 6 TPGExecutionEngines ----------------
-        // 6 LearningEnvironments are required because each instance own its specializedAction, its target vector, etc...
-        // And therefore, each of the following object (Environment, TPGGraph, Engine, ...) depends on the learningEnvironment. So, 6 of each.
-        auto *leNP = new BinaryClassifEnv({0, 1}, 0, nbTrainingElements, nbTrainingTargets, nbGeneTargetChange,
-                                          nbValidationTarget, 0);
-        auto *leQT = new BinaryClassifEnv({0, 1}, 1, nbTrainingElements, nbTrainingTargets, nbGeneTargetChange,
-                                          nbValidationTarget, 0);
-        auto *leBTH = new BinaryClassifEnv({0, 1}, 2, nbTrainingElements, nbTrainingTargets, nbGeneTargetChange,
-                                           nbValidationTarget, 0);
-        auto *leBTV = new BinaryClassifEnv({0, 1}, 3, nbTrainingElements, nbTrainingTargets, nbGeneTargetChange,
-                                           nbValidationTarget, 0);
-        //auto *leTTH = new BinaryClassifEnv({0, 1}, 4, nbTrainingElements, nbTrainingTargets, nbGeneTargetChange, nbValidationTarget, 0);
-        auto *leTTV = new BinaryClassifEnv({0, 1}, 5, nbTrainingElements, nbTrainingTargets, nbGeneTargetChange,
-                                           nbValidationTarget, 0);
-
-        // Instantiate the environment that will embed the LearningEnvironment
-        Environment envNP(set, leNP->getDataSources(), params.nbRegisters, params.nbProgramConstant);
-        Environment envQT(set, leQT->getDataSources(), params.nbRegisters, params.nbProgramConstant);
-        Environment envBTH(set, leBTH->getDataSources(), params.nbRegisters, params.nbProgramConstant);
-        Environment envBTV(set, leBTV->getDataSources(), params.nbRegisters, params.nbProgramConstant);
-        //Environment envTTH(set, leTTH->getDataSources(), params.nbRegisters, params.nbProgramConstant);
-        Environment envTTV(set, leTTV->getDataSources(), params.nbRegisters, params.nbProgramConstant);
-
-        // Instantiate the TPGGraph that we will load
-        auto tpgNP = TPG::TPGGraph(envNP);
-        auto tpgQT = TPG::TPGGraph(envQT);
-        auto tpgBTH = TPG::TPGGraph(envBTH);
-        auto tpgBTV = TPG::TPGGraph(envBTV);
-        //auto tpgTTH = TPG::TPGGraph(envTTH);
-        auto tpgTTV = TPG::TPGGraph(envTTV);
-
-        // Instantiate the tee that will handle the decisions taken by the TPG
-        TPG::TPGExecutionEngine teeNP(envNP);
-        TPG::TPGExecutionEngine teeQT(envQT);
-        TPG::TPGExecutionEngine teeBTH(envBTH);
-        TPG::TPGExecutionEngine teeBTV(envBTV);
-        //TPG::TPGExecutionEngine teeTTH(envTTH);
-        TPG::TPGExecutionEngine teeTTV(envTTV);
-
-        // ---------------- Import TPG graph from .dot file ----------------
-        importTPG(leNP, envNP, tpgNP);
-        importTPG(leQT, envQT, tpgQT);
-        importTPG(leBTH, envBTH, tpgBTH);
-        importTPG(leBTV, envBTV, tpgBTV);
-        //importTPG(leTTH, envTTH, tpgTTH);
-        importTPG(leTTV, envTTV, tpgTTV);
-
-        // ---------------- Execute TPG from root on the environment ----------------
-        auto rootNP = tpgNP.getRootVertices().front();
-        auto rootQT = tpgQT.getRootVertices().front();
-        auto rootBTH = tpgBTH.getRootVertices().front();
-        auto rootBTV = tpgBTV.getRootVertices().front();
-        //auto rootTTH = tpgTTH.getRootVertices().front();
-        auto rootTTV = tpgTTV.getRootVertices().front();
-
         // ************************************************** MAIN RUN *************************************************
-        // Path to the global database with 330.000 elements (55.000 of each class)
-        char datasetPath[100] = "/home/cleonard/Data/dataset_tpg_balanced/dataset_tpg_32x32_27_balanced2/";
-
-        auto *dataHandler = new std::vector<Data::PrimitiveTypeArray2D<uint8_t> *>;
+        auto *dataHandler = new std::vector<std::vector<uint8_t> *>;
         auto *splitList = new std::vector<uint8_t>;
 
         // Load a vector of 1000 CUs (dataHandler) and their corresponding split (splitList)
         // -------------------------- Load a global vector of 1.000 CUs --------------------------
         for (uint64_t idx_targ = 0; idx_targ < leNP->NB_VALIDATION_TARGETS; idx_targ++) {
-            Data::PrimitiveTypeArray2D<uint8_t> *target = getRandomCU(datasetPath, leNP, splitList, idx_targ);
+            std::vector<uint8_t> *target = getRandomCU(datasetPath, leNP, splitList, idx_targ);
             dataHandler->push_back(target);
             // Optimal split is stored in splitList inside getRandomCU()
         }
@@ -164,15 +84,18 @@ int main(int argc, char* argv[])
         int chosenAction = -1;
 
         // Run NB_VALIDATION_TARGETS times the TPG, each time on a different CU
+        std::vector<const uint8_t*> batch;
         for (uint64_t nbCU = 0; nbCU < leNP->NB_VALIDATION_TARGETS; nbCU++)
         {
-            // -------------------------- Load next CU for all TPGs --------------------------
-            leNP->setCurrentCu(*dataHandler->at(nbCU));
-            leQT->setCurrentCu(*dataHandler->at(nbCU));
-            leBTH->setCurrentCu(*dataHandler->at(nbCU));
-            leBTV->setCurrentCu(*dataHandler->at(nbCU));
-            //leTTH->setCurrentCu(*dataHandler->at(nbCU));
-            leTTV->setCurrentCu(*dataHandler->at(nbCU));
+            // -------------------------- Next batch of CUs, every program executed on BATCH_SIZE CUs at once --------------------------
+            size_t lane = nbCU % FlatProgramPool::BATCH_SIZE;
+            if (lane == 0)
+            {
+                batch.clear();
+                for (uint64_t idx_cu = nbCU; idx_cu < leNP->NB_VALIDATION_TARGETS && batch.size() < FlatProgramPool::BATCH_SIZE; idx_cu++)
+                    batch.push_back(dataHandler->at(idx_cu)->data());
+                programPool.setInputBatch(batch);
+            }
 
             /*// ************************************** ORDER : NP QT BTH BTV TTH TTV ***************************************
             // -------------------------- Call NP TPG --------------------------
@@ -224,35 +147,34 @@ int main(int argc, char* argv[])
 
             // ************************************** ORDER : TTV NP QT BTH BTV TTH ***************************************
             // -------------------------- Call TTV TPG --------------------------
-            actionID = (int) ((const TPG::TPGAction *) teeTTV.executeFromRoot(*rootTTV).back())->getActionID();
+            actionID = (int) tpgTTV.executeLane(lane);
             //std::cout << "TTV Action : " << actionID << std::endl;
             if (actionID == 1)
-                chosenAction = leTTV->getSpecializedAction();
+                chosenAction = 5;
             else {
                 // -------------------------- Call NP TPG --------------------------
-                actionID = (int) ((const TPG::TPGAction *) teeNP.executeFromRoot(*rootNP).back())->getActionID();
+                actionID = (int) tpgNP.executeLane(lane);
                 //std::cout << "NP Action : " << actionID << std::endl;
                 if (actionID == 1)
-                    chosenAction = leNP->getSpecializedAction();
+                    chosenAction = 0;
                 else {
                     // -------------------------- Call QT TPG --------------------------
-                    actionID = (int) ((const TPG::TPGAction *) teeQT.executeFromRoot(*rootQT).back())->getActionID();
+                    actionID = (int) tpgQT.executeLane(lane);
                     //std::cout << "QT Action : " << actionID << std::endl;
                     if (actionID == 1)
-                        chosenAction = leQT->getSpecializedAction();
+                        chosenAction = 1;
                     else {
                         // -------------------------- Call BTH TPG --------------------------
-                        actionID = (int) ((const TPG::TPGAction *) teeBTH.executeFromRoot(*rootBTH).back())->getActionID();
+                        actionID = (int) tpgBTH.executeLane(lane);
                         //std::cout << "BTH Action : " << actionID << std::endl;
                         if (actionID == 1)
-                            chosenAction = leBTH->getSpecializedAction();
+                            chosenAction = 2;
                         else {
                             // -------------------------- Call BTV / TTH TPG --------------------------
-                            actionID = (int) ((const TPG::TPGAction *) teeBTV.executeFromRoot(
-                                    *rootBTV).back())->getActionID();
+                            actionID = (int) tpgBTV.executeLane(lane);
                             //std::cout << "BTV Action : " << actionID << std::endl;
                             if (actionID == 1)
-                                chosenAction = leBTV->getSpecializedAction(); //BTV
+                                chosenAction = 3; //BTV
                             else
                                 chosenAction = 4;   // TTH
                             /*else
@@ -280,40 +202,22 @@ int main(int argc, char* argv[])
         moyenne += (double) score;
 
         // ---------------- Clean ----------------
-        // instructions
-        for (unsigned int j = 0; j < set.getNbInstructions(); j++)
-            delete (&set.getInstruction(j));
-        // LearningEnvironment
-        delete leNP;
-        delete leQT;
-        delete leBTH;
-        delete leBTV;
-        //delete leTTH;
-        delete leTTV;
         // Data and solution handlers
         delete dataHandler;
         delete splitList;
     }
     moyenne /= nbEval;
     std::cout << "Score moyen : " << moyenne << "/1000" << std::endl;
-    return 0;
-}
+    std::cout << "Programs executed : " << programPool.getNbExecutions() << "/" << programPool.getNbBidRequests()
+              << " bids (" << programPool.getNbPrograms() << " distinct programs)" << std::endl;
 
-void importTPG(BinaryClassifEnv* le, Environment& env, TPG::TPGGraph& tpg)
-{
-    try{
-        char tpgPath[100] = ROOT_DIR"/TPG/";
-        std::string speActionName = le->getActionName(le->getSpecializedAction());
-        std::strcat(tpgPath, speActionName.c_str());
-        char dotExtension[10] = ".dot";
-        std::strcat(tpgPath, dotExtension);
-        File::TPGGraphDotImporter dotImporter(tpgPath, env, tpg);
-    }catch (std::runtime_error& e){
-        std::cout << e.what() << std::endl;
-    }
+    // ---------------- Clean ----------------
+    // LearningEnvironment
+    delete leNP;
+    return 0;
 }
 
-Data::PrimitiveTypeArray2D<uint8_t>* getRandomCU(const char datasetPath[100], BinaryClassifEnv* le, std::vector<uint8_t>* splitList, uint64_t index_targ)
+std::vector<uint8_t>* getRandomCU(const char datasetPath[100], BinaryClassifEnv* le, std::vector<uint8_t>* splitList, uint64_t index_targ)
 {
     // ------------------ Opening and Reading a random CU file ------------------
     // Generate the path for a random CU
@@ -347,10 +251,8 @@ Data::PrimitiveTypeArray2D<uint8_t>* getRandomCU(const char datasetPath[100], Bi
     // Important ...
     std::fclose(input);
 
-    // Creating a new PrimitiveTypeArray<uint8_t> and filling it
-    auto *randomCU = new Data::PrimitiveTypeArray2D<uint8_t>(32, 32);   // 2D Array
-    for (uint32_t pxlIndex = 0; pxlIndex < 32 * 32; pxlIndex++)
-        randomCU->setDataAt(typeid(uint8_t), pxlIndex, contents[pxlIndex]);
+    // Creating a new vector with the 32x32 pixels values (wrapped by the environments in setCurrentCu())
+    auto *randomCU = new std::vector<uint8_t>(&contents[0], &contents[32 * 32]);
 
     // Store the corresponding optimal split
     splitList->push_back(contents[1024]);
@@ -370,19 +272,16 @@ void runOneTPG(const TPG::TPGVertex* root, TPG::TPGExecutionEngine& tee, BinaryC
     // Initialize score to 0
     uint64_t score = 0;
 
-    // Load NB_VALIDATION_TARGETS CUs from the database
-    for(uint64_t idx_targ = 0; idx_targ < le->NB_VALIDATION_TARGETS; idx_targ++)
-    {
-        Data::PrimitiveTypeArray2D<uint8_t>* target = le->getRandomCU(Learn::LearningMode::VALIDATION, datasetPath);
-        BinaryClassifEnv::validationTargetsCU->push_back(target);
-        // Optimal split is stored in validationTargetsOptimalSplits inside getRandomCU()
-    }
+    // Load NB_VALIDATION_TARGETS CUs from the database and publish them in the environment
+    auto validationStore = std::make_shared<TargetStore<uint8_t>>(32 * 32);
+    le->loadTargets(ParallelTargetsLoader::VALIDATION_STREAM, le->NB_VALIDATION_TARGETS, *validationStore, datasetPath);
+    le->validationTargets = validationStore;
 
     // Update the LearningEnvironment mode in VALIDATION and load first CU
     le->reset(0, Learn::LearningMode::VALIDATION);
 
-    // Run NB_VALIDATION_TARGETS times the TPG, each time on a different CU
-    for(uint64_t idx_targ = 0; idx_targ < le->NB_VALIDATION_TARGETS; idx_targ++)
+    // Run the TPG on every loaded CU (the CUs which could not be read are not in the store)
+    for(uint64_t idx_targ = 0; idx_targ < le->validationTargets->size(); idx_targ++)
     {
         // Gets the action the TPG would decide with this CU (Either 0: OTHER actions or 1: SPECIFIED action)
         uint64_t actionID=((const TPG::TPGAction *) tee.executeFromRoot(* root).back())->getActionID();
@@ -396,5 +295,5 @@ void runOneTPG(const TPG::TPGVertex* root, TPG::TPGExecutionEngine& tee, BinaryC
         le->LoadNextCU();
     }
     // Print the results
-    std::cout << "Score : " << score << "/" << le->NB_VALIDATION_TARGETS << std::endl;
+    std::cout << "Score : " << score << "/" << le->validationTargets->size() << std::endl;
 }
@@ -1,4 +1,5 @@
 #include "../../include/classification/ClassEnv.h"
+#include <cstring>
 
 // ********************************************************************* //
 // ************************** GEGELATI FUNCTIONS *********************** //
@@ -18,7 +19,7 @@ void ClassEnv::doAction(uint64_t actionID)
 std::vector<std::reference_wrapper<const Data::DataHandler>> ClassEnv::getDataSources()
 {
     // Return a vector containing every element constituting the State of the environment
-    std::vector<std::reference_wrapper<const Data::DataHandler>> result{this->currentCU};
+    std::vector<std::reference_wrapper<const Data::DataHandler>> result{this->currentCU, this->currentCUSums};
 
     return result;
 }
@@ -67,17 +68,18 @@ bool ClassEnv::isTerminal() const
 // ********************************************************************* //
 
 // ****** TRAINING Arguments ******
-std::vector<Data::PrimitiveTypeArray2D<uint8_t> *> *ClassEnv::trainingTargetsCU = new std::vector<Data::PrimitiveTypeArray2D<uint8_t>*>; // Array2DWrapper
-std::vector<uint8_t> *ClassEnv::trainingTargetsOptimalSplits = new std::vector<uint8_t>;
-// ****** VALIDATION Arguments ******
-std::vector<Data::PrimitiveTypeArray2D<uint8_t>*> *ClassEnv::validationTargetsCU = new std::vector<Data::PrimitiveTypeArray2D<uint8_t>*>;  // Array2DWrapper
-std::vector<uint8_t> *ClassEnv::validationTargetsOptimalSplits = new std::vector<uint8_t>;
 
-void ClassEnv::getRandomCU(Learn::LearningMode mode, const std::string& databasePath)
+ClassEnv::~ClassEnv()
+{
+    // The prefetching thread uses this environment
+    this->nextTrainingTargets.prefetcher.stop(this);
+}
+
+bool ClassEnv::getRandomCU(Mutator::RNG& loaderRng, TargetStore<uint8_t>& targets, uint64_t idx, const std::string& databasePath)
 {
     // ------------------ Opening and Reading a random CU file ------------------
     char datasetPath[100] = "/home/cleonard/Data/CU/CU_32x32_balanced/";
-    uint32_t next_CU_number = this->rng.getInt32(0, NB_TRAINING_ELEMENTS - 1);
+    uint32_t next_CU_number = loaderRng.getInt32(0, NB_TRAINING_ELEMENTS - 1);
     char next_CU_number_string[100];
     std::sprintf(next_CU_number_string, "%d", next_CU_number);
     //char current_CU_path[100];
@@ -93,6 +95,7 @@ void ClassEnv::getRandomCU(Learn::LearningMode mode, const std::string& database
         char error_file_path[300] = "File opening failed: ";
         std::strcat(error_file_path, datasetPath);
         std::perror(error_file_path);
+        return false;
     }
 
     // Stocking content in a uint8_t tab, first 32x32 uint8_t are CU's pixels values and the 1025th value is the optimal split
@@ -105,23 +108,55 @@ void ClassEnv::getRandomCU(Learn::LearningMode mode, const std::string& database
     // Important ...
     std::fclose(input);
 
-    // Creating a new PrimitiveTypeArray<uint8_t> and filling it
-    auto *randomCU = new Data::PrimitiveTypeArray2D<uint8_t>(32, 32);   // 2D Array
-    for (uint32_t pxlIndex = 0; pxlIndex < 32 * 32; pxlIndex++)
-        randomCU->setDataAt(typeid(uint8_t), pxlIndex, contents[pxlIndex]);
+    // Storing the 32x32 pixels values and the optimal split in the given targets, the row will be wrapped by currentCU in LoadNextCU()
+    std::memcpy(targets.setTarget(idx, contents[1024]), &contents[0], 32 * 32);
+    return true;
+}
 
-    // Updating the corresponding optimal split depending of the current mode
-    if (mode == Learn::LearningMode::TRAINING)
-    {
-        ClassEnv::trainingTargetsCU->push_back(randomCU);
-        ClassEnv::trainingTargetsOptimalSplits->push_back(contents[1024]);
-    }
-    else if (mode == Learn::LearningMode::VALIDATION)
+bool ClassEnv::getRandomCUFromPackedDatabase(Mutator::RNG& loaderRng, const PackedCUDatabase& database, TargetStore<uint8_t>& targets, uint64_t idx)
+{
+    // Same random draw as with getRandomCU()
+    uint32_t next_CU_number = loaderRng.getInt32(0, NB_TRAINING_ELEMENTS - 1);
+
+    // Record in the mapping : 32x32 pixels values followed by the optimal split
+    const uint8_t* record = database.getCU(next_CU_number);
+
+    // Copying the pixels at once, the row will be wrapped by currentCU in LoadNextCU()
+    std::memcpy(targets.setTarget(idx, record[1024]), record, 32 * 32);
+    return true;
+}
+
+void ClassEnv::loadTargets(uint64_t stream, uint64_t nbTargets, TargetStore<uint8_t>& targets, const std::string& databasePath,
+                           const std::atomic<bool>* stopRequested)
+{
+    const PackedCUDatabase* database = nullptr;
+    if (PackedCUDatabase::isPackedDatabase(databasePath))
     {
-        ClassEnv::validationTargetsCU->push_back(randomCU);
-        ClassEnv::validationTargetsOptimalSplits->push_back(contents[1024]);
+        database = &PackedCUDatabase::getShared(databasePath);
+        if (database->getCuHeight() != 32 || database->getCuWidth() != 32)
+            throw std::runtime_error("Packed database " + database->getPath() + " does not contain 32x32 CUs");
     }
 
+    targets.resize(nbTargets);
+    std::vector<uint64_t> failed = ParallelTargetsLoader::run(nbTargets, this->nbLoadingThreads, [&](uint64_t idx) {
+        // Each target has its own RNG : same targets whatever the number of threads
+        Mutator::RNG loaderRng(ParallelTargetsLoader::getSubstreamSeed(this->seed, stream, idx));
+        if (database)
+            return this->getRandomCUFromPackedDatabase(loaderRng, *database, targets, idx);
+        return this->getRandomCU(loaderRng, targets, idx, databasePath);
+    }, stopRequested);
+    targets.removeTargets(failed);
+    PhaseTimers::countLoadedCUs(nbTargets - failed.size(), (nbTargets - failed.size()) * targets.getRowSize() * sizeof(uint8_t));
+    // The environments loop on the loaded targets only : an empty store can't be used
+    if (targets.size() == 0 && nbTargets != 0 && !(stopRequested && *stopRequested))
+        throw std::runtime_error("No target could be loaded from " + databasePath);
+}
+
+void ClassEnv::prefetchNextTrainingTargets(uint64_t nextGen, const std::string& databasePath)
+{
+    this->nextTrainingTargets.prefetcher.start(this, [this, nextGen, databasePath](const std::atomic<bool>& stopRequested) {
+        this->loadTargets(nextGen, NB_TRAINING_TARGETS, *this->nextTrainingTargets.store, databasePath, &stopRequested);
+    });
 }
 
 void ClassEnv::UpdateTargets(uint64_t currentGen, const std::string& databasePath)
@@ -129,93 +164,104 @@ void ClassEnv::UpdateTargets(uint64_t currentGen, const std::string& databasePat
     // Each ${nbGeneTargetChange} generation, generate new random training targets so that different targets are used
     if (currentGen % NB_GENERATION_BEFORE_TARGETS_CHANGE == 0)
     {
-        // ---  Deleting old targets ---
         if (currentGen != 0) // Don't clear trainingTargets before initializing them
         {
+            if (!this->nextTrainingTargets.store)
+                throw std::runtime_error("ClassEnv::UpdateTargets: the targets of generation 0 were not loaded");
+
+            // ---  Waiting for the next targets (loaded in background since the previous change) ---
+            this->nextTrainingTargets.prefetcher.wait();
+
+            // ---  Publishing the next targets, old targets rows are refilled by the next prefetch unless a clone still uses them ---
+            TargetSnapshot<uint8_t> retiredTargets = std::move(this->trainingTargets);
+            this->trainingTargets = std::move(this->nextTrainingTargets.store);
+            this->nextTrainingTargets.store = TargetStore<uint8_t>::recycle(std::move(retiredTargets), 32 * 32);
+
+            // Only now : reset() wraps the first new target in currentCU, no pointer on the recycled rows remains
+            this->actualTrainingCU = 0;
             this->reset(this->seed, Learn::LearningMode::TRAINING);
-            for (uint64_t idx_targ = 0; idx_targ < NB_TRAINING_TARGETS; idx_targ++)
-                delete ClassEnv::trainingTargetsCU->at(idx_targ);   // Targets are allocated in getRandomCUFeaturesFromCSVFile()
-            ClassEnv::trainingTargetsCU->clear();
-            ClassEnv::trainingTargetsOptimalSplits->clear();
             this->actualTrainingCU = 0;
         }
-        else        // Load VALIDATION Targets at the beginning of the training (i == 0)
+        else  // Load VALIDATION Targets and the first TRAINING Targets at the beginning of the training (i == 0)
         {
-            for (uint64_t idx_targ = 0; idx_targ < NB_VALIDATION_TARGETS; idx_targ++)
-                this->getRandomCU(Learn::LearningMode::VALIDATION, databasePath);
+            auto validationStore = std::make_shared<TargetStore<uint8_t>>(32 * 32);
+            this->loadTargets(ParallelTargetsLoader::VALIDATION_STREAM, NB_VALIDATION_TARGETS, *validationStore, databasePath);
+            this->validationTargets = validationStore;
+            this->confusionMatrixCache.clear();
+            auto trainingStore = std::make_shared<TargetStore<uint8_t>>(32 * 32);
+            this->loadTargets(currentGen, NB_TRAINING_TARGETS, *trainingStore, databasePath);
+            this->trainingTargets = trainingStore;
+
+            // A previous training of this environment may still be filling its next targets
+            this->nextTrainingTargets.prefetcher.stop(this);
+            this->nextTrainingTargets.store = std::make_shared<TargetStore<uint8_t>>(32 * 32);
         }
 
-        // ---  Loading next targets ---
-        for (uint64_t idx_targ = 0; idx_targ < NB_TRAINING_TARGETS; idx_targ++)
-            this->getRandomCU(Learn::LearningMode::TRAINING, databasePath);
+        // ---  Loading next targets in background while training ---
+        this->prefetchNextTrainingTargets(currentGen + NB_GENERATION_BEFORE_TARGETS_CHANGE, databasePath);
     }
 }
 
+void ClassEnv::setNbLoadingThreads(size_t nbThreads)
+{
+    this->nbLoadingThreads = nbThreads;
+}
+
 void ClassEnv::LoadNextCU()
 {
     if (this->currentMode == Learn::LearningMode::TRAINING)
     {
         // Load next CU
-        this->currentCU = *ClassEnv::trainingTargetsCU->at(this->actualTrainingCU);
+        std::vector<uint8_t>* target = this->trainingTargets->getTarget(this->actualTrainingCU);
+        this->currentCU.setPointer(target);
+        this->currentCUSums.setPixels(target->data());
         // Updating next split solution
-        this->currentClass = ClassEnv::trainingTargetsOptimalSplits->at(this->actualTrainingCU);
+        this->currentClass = this->trainingTargets->getLabel(this->actualTrainingCU);
         // Increment index
         this->actualTrainingCU++;
 
         // Looping on the beginning of training targets
-        if (this->actualTrainingCU >= NB_TRAINING_TARGETS)
+        if (this->actualTrainingCU >= this->trainingTargets->size())
             this->actualTrainingCU = 0;
     }
     else if (this->currentMode == Learn::LearningMode::VALIDATION)
     {
         // Load next CU
-        this->currentCU = *ClassEnv::validationTargetsCU->at(this->actualValidationCU);
+        std::vector<uint8_t>* target = this->validationTargets->getTarget(this->actualValidationCU);
+        this->currentCU.setPointer(target);
+        this->currentCUSums.setPixels(target->data());
         // Updating next split solution
-        this->currentClass = ClassEnv::validationTargetsOptimalSplits->at(this->actualValidationCU);
+        this->currentClass = this->validationTargets->getLabel(this->actualValidationCU);
         // Increment index
         this->actualValidationCU++;
 
         // Looping on the beginning of validation targets
-        if (this->actualValidationCU >= NB_VALIDATION_TARGETS)
+        if (this->actualValidationCU >= this->validationTargets->size())
             this->actualValidationCU = 0;
     }
 }
 
-void ClassEnv::printClassifStatsTable(const Environment& env, const TPG::TPGVertex* bestRoot, const uint64_t numGen, std::string const& outputFile, bool readable)
+const ConfusionMatrix& ClassEnv::getConfusionMatrix(const Environment& env, const TPG::TPGVertex* root)
 {
-    // Print table of classification of the best
-    TPG::TPGExecutionEngine tee(env, nullptr);
-
-    // Change the MODE
-    this->reset(0, Learn::LearningMode::VALIDATION);    // TESTING in MNIST, mais marche pas ici
+    // Unchanged root since the last call : same matrix
+    return this->confusionMatrixCache.get(root, [&]() {
+        // Fill the table : the validation targets are split between nbLoadingThreads clones of this environment
+        return ConfusionMatrix(ParallelValidation::run(*this, env, *root, this->validationTargets->size(), 6, this->nbLoadingThreads,
+                [](Learn::LearningEnvironment& le, uint64_t idx) {
+                    // Load the validation target idx in the clone and get answer
+                    auto& clone = (ClassEnv&) le;
+                    clone.actualValidationCU = idx;
+                    clone.LoadNextCU();
+                    return (uint64_t) clone.currentClass;
+                }));
+    });
+}
 
-    // Fill the table
+void ClassEnv::printClassifStatsTable(const ConfusionMatrix& matrix, const uint64_t numGen, std::string const& outputFile, bool readable)
+{
     const int nbClasses = 6;
-
-    uint64_t classifTable[nbClasses][nbClasses] = { {0} };
-    uint64_t nbPerClass[nbClasses] = { 0 };
-    uint8_t actionID;
-
-    for (uint64_t nbImage = 0; nbImage < this->NB_VALIDATION_TARGETS; nbImage++)
-    {
-        // Get answer
-        uint64_t optimalActionID = this->currentClass;
-        nbPerClass[optimalActionID]++;
-
-        // Execute
-        auto path = tee.executeFromRoot(*bestRoot);
-        const auto* action = (const TPG::TPGAction*)path.at(path.size() - 1);
-        actionID = (uint8_t) action->getActionID();
-
-        // Increment table
-        classifTable[optimalActionID][actionID]++;
-
-        // Do action (to trigger image update)
-        this->LoadNextCU();
-    }
-
-    // Reset the learning mode to TESTING
-    this->reset(0, Learn::LearningMode::TESTING);
+    const std::vector<std::vector<uint64_t>>& classifTable = matrix.getTable();
+    std::vector<uint64_t> nbPerClass = matrix.getNbPerClass();
 
 /*    // Computing Score :
     uint64_t score = 0;
@@ -327,7 +373,7 @@ void ClassEnv::printClassifStatsTable(const Environment& env, const TPG::TPGVert
                 file << std::setw(colWidth) << "Total";
                 for(unsigned long nb : nbPerClass)
                     file << std::setw(colWidth) << nb;
-                file << std::setw(colWidth) << this->NB_VALIDATION_TARGETS << std::endl << std::endl;
+                file << std::setw(colWidth) << this->validationTargets->size() << std::endl << std::endl;
 
                 file << std::setw(colWidth) << "Gen" << std::setw(colWidth) << "NS"
                      << std::setw(colWidth) << "QT"  << std::setw(colWidth) << "BTH"
@@ -0,0 +1,146 @@
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "../../include/database/FeaturesDatabase.h"
+
+// ********************************************************************* //
+// ************************** STATIC ARGUMENTS ************************* //
+// ********************************************************************* //
+
+const std::string FeaturesDatabase::FILE_EXTENSION = ".ftdb";
+const char FeaturesDatabase::MAGIC[8] = {'T', 'P', 'G', 'F', 'T', 'D', 'B', '\0'};
+
+std::map<std::string, std::unique_ptr<FeaturesDatabase>> FeaturesDatabase::sharedDatabases;
+std::mutex FeaturesDatabase::sharedDatabasesMutex;
+
+// ********************************************************************* //
+// **************************** CONSTRUCTORS *************************** //
+// ********************************************************************* //
+
+FeaturesDatabase::FeaturesDatabase(const std::string& path) : path(path), mapping(nullptr), mappingSize(0), header()
+{
+#ifdef _WIN32
+    // No mmap : the whole file is read once in memory, then shared as the mapping
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+        throw std::runtime_error("Features database opening failed : " + path);
+    this->mappingSize = (size_t) file.tellg();
+    if (this->mappingSize < sizeof(FeaturesDatabaseHeader))
+        throw std::runtime_error("Not a binary features database : " + path);
+    this->contents.resize(this->mappingSize);
+    if (!file.seekg(0).read((char*) this->contents.data(), (std::streamsize) this->mappingSize))
+        throw std::runtime_error("Features database reading failed : " + path);
+    this->mapping = this->contents.data();
+#else
+    // Opening the file and getting its size
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Features database opening failed : " + path);
+    struct stat fileStat{};
+    if (fstat(fd, &fileStat) != 0 || (size_t) fileStat.st_size < sizeof(FeaturesDatabaseHeader))
+    {
+        close(fd);
+        throw std::runtime_error("Not a binary features database : " + path);
+    }
+    this->mappingSize = (size_t) fileStat.st_size;
+
+    // Mapping the whole file, the descriptor is no longer needed once mapped
+    void* address = mmap(nullptr, this->mappingSize, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED)
+        throw std::runtime_error("Features database mapping failed : " + path);
+    this->mapping = (const uint8_t*) address;
+    // CUs are drawn randomly : no need for the kernel to read ahead
+    madvise(address, this->mappingSize, MADV_RANDOM);
+#endif
+
+    // Checking the header
+    std::memcpy(&this->header, this->mapping, sizeof(FeaturesDatabaseHeader));
+    if (std::memcmp(this->header.magic, FeaturesDatabase::MAGIC, sizeof(FeaturesDatabase::MAGIC)) != 0)
+    {
+        this->unmapFile();
+        throw std::runtime_error("Not a binary features database : " + path);
+    }
+    const uint64_t rowSize = ((uint64_t) this->header.nbFeatures + 1) * sizeof(double);
+    if (this->header.version != FeaturesDatabase::VERSION
+        || this->header.valuesOffset % sizeof(double) != 0
+        // Without any product or sum that could wrap on a corrupted header
+        || this->header.labelsOffset > this->mappingSize
+        || this->header.nbElements > this->mappingSize - this->header.labelsOffset
+        || this->header.valuesOffset > this->mappingSize
+        || this->header.nbElements > (this->mappingSize - this->header.valuesOffset) / rowSize)
+    {
+        this->unmapFile();
+        throw std::runtime_error("Unsupported binary features database version or layout : " + path);
+    }
+}
+
+FeaturesDatabase::~FeaturesDatabase()
+{
+    this->unmapFile();
+}
+
+void FeaturesDatabase::unmapFile()
+{
+#ifndef _WIN32
+    if (this->mapping)
+        munmap((void*) this->mapping, this->mappingSize);
+#endif
+    this->mapping = nullptr;
+}
+
+// ********************************************************************* //
+// ************************** SPECIAL FUNCTIONS ************************ //
+// ********************************************************************* //
+
+bool FeaturesDatabase::isFeaturesDatabase(const std::string& path)
+{
+    const std::string& ext = FeaturesDatabase::FILE_EXTENSION;
+    return path.size() > ext.size() && path.compare(path.size() - ext.size(), ext.size(), ext) == 0;
+}
+
+FeaturesDatabase& FeaturesDatabase::getShared(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(FeaturesDatabase::sharedDatabasesMutex);
+
+    auto it = FeaturesDatabase::sharedDatabases.find(path);
+    if (it == FeaturesDatabase::sharedDatabases.end())
+        it = FeaturesDatabase::sharedDatabases.emplace(path, std::make_unique<FeaturesDatabase>(path)).first;
+
+    return *it->second;
+}
+
+const double* FeaturesDatabase::getValues(uint64_t index) const
+{
+    if (index >= this->header.nbElements)
+        throw std::out_of_range("CU index " + std::to_string(index) + " out of features database " + this->path);
+
+    // valuesOffset is aligned on 8 bytes and mmap returns page-aligned addresses
+    return (const double*) (this->mapping + this->header.valuesOffset) + index * (this->header.nbFeatures + 1);
+}
+
+uint8_t FeaturesDatabase::getSplit(uint64_t index) const
+{
+    if (index >= this->header.nbElements)
+        throw std::out_of_range("CU index " + std::to_string(index) + " out of features database " + this->path);
+
+    return this->mapping[this->header.labelsOffset + index];
+}
+
+// ********************************************************************* //
+// ******************************* GETTERS ***************************** //
+// ********************************************************************* //
+
+const std::string& FeaturesDatabase::getPath() const { return path; }
+uint32_t FeaturesDatabase::getNbFeatures() const { return header.nbFeatures; }
+uint64_t FeaturesDatabase::getNbElements() const { return header.nbElements; }
+uint64_t FeaturesDatabase::getNbPerClass(uint8_t split) const { return split < 6 ? header.nbPerClass[split] : 0; }
@@ -0,0 +1,137 @@
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "../../include/database/PackedCUDatabase.h"
+
+// ********************************************************************* //
+// ************************** STATIC ARGUMENTS ************************* //
+// ********************************************************************* //
+
+const std::string PackedCUDatabase::FILE_EXTENSION = ".cudb";
+const char PackedCUDatabase::MAGIC[8] = {'T', 'P', 'G', 'C', 'U', 'D', 'B', '\0'};
+
+std::map<std::string, std::unique_ptr<PackedCUDatabase>> PackedCUDatabase::sharedDatabases;
+std::mutex PackedCUDatabase::sharedDatabasesMutex;
+
+// ********************************************************************* //
+// **************************** CONSTRUCTORS *************************** //
+// ********************************************************************* //
+
+PackedCUDatabase::PackedCUDatabase(const std::string& path) : path(path), mapping(nullptr), mappingSize(0), header()
+{
+#ifdef _WIN32
+    // No mmap : the whole file is read once in memory, then shared as the mapping
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+        throw std::runtime_error("Packed database opening failed : " + path);
+    this->mappingSize = (size_t) file.tellg();
+    if (this->mappingSize < sizeof(PackedCUDatabaseHeader))
+        throw std::runtime_error("Not a packed CU database : " + path);
+    this->contents.resize(this->mappingSize);
+    if (!file.seekg(0).read((char*) this->contents.data(), (std::streamsize) this->mappingSize))
+        throw std::runtime_error("Packed database reading failed : " + path);
+    this->mapping = this->contents.data();
+#else
+    // Opening the file and getting its size
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Packed database opening failed : " + path);
+    struct stat fileStat{};
+    if (fstat(fd, &fileStat) != 0 || (size_t) fileStat.st_size < sizeof(PackedCUDatabaseHeader))
+    {
+        close(fd);
+        throw std::runtime_error("Not a packed CU database : " + path);
+    }
+    this->mappingSize = (size_t) fileStat.st_size;
+
+    // Mapping the whole file, the descriptor is no longer needed once mapped
+    void* address = mmap(nullptr, this->mappingSize, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED)
+        throw std::runtime_error("Packed database mapping failed : " + path);
+    this->mapping = (const uint8_t*) address;
+    // CUs are drawn randomly : no need for the kernel to read ahead
+    madvise(address, this->mappingSize, MADV_RANDOM);
+#endif
+
+    // Checking the header
+    std::memcpy(&this->header, this->mapping, sizeof(PackedCUDatabaseHeader));
+    if (std::memcmp(this->header.magic, PackedCUDatabase::MAGIC, sizeof(PackedCUDatabase::MAGIC)) != 0)
+    {
+        this->unmapFile();
+        throw std::runtime_error("Not a packed CU database : " + path);
+    }
+    if (this->header.version != PackedCUDatabase::VERSION
+        || this->header.recordSize == 0
+        || this->header.recordSize != (uint64_t) this->header.cuHeight * this->header.cuWidth + 1
+        // Without any product or sum that could wrap on a corrupted header
+        || this->header.dataOffset > this->mappingSize
+        || this->header.nbElements > (this->mappingSize - this->header.dataOffset) / this->header.recordSize)
+    {
+        this->unmapFile();
+        throw std::runtime_error("Unsupported packed CU database version or layout : " + path);
+    }
+}
+
+PackedCUDatabase::~PackedCUDatabase()
+{
+    this->unmapFile();
+}
+
+void PackedCUDatabase::unmapFile()
+{
+#ifndef _WIN32
+    if (this->mapping)
+        munmap((void*) this->mapping, this->mappingSize);
+#endif
+    this->mapping = nullptr;
+}
+
+// ********************************************************************* //
+// ************************** SPECIAL FUNCTIONS ************************ //
+// ********************************************************************* //
+
+bool PackedCUDatabase::isPackedDatabase(const std::string& path)
+{
+    const std::string& ext = PackedCUDatabase::FILE_EXTENSION;
+    return path.size() > ext.size() && path.compare(path.size() - ext.size(), ext.size(), ext) == 0;
+}
+
+PackedCUDatabase& PackedCUDatabase::getShared(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(PackedCUDatabase::sharedDatabasesMutex);
+
+    auto it = PackedCUDatabase::sharedDatabases.find(path);
+    if (it == PackedCUDatabase::sharedDatabases.end())
+        it = PackedCUDatabase::sharedDatabases.emplace(path, std::make_unique<PackedCUDatabase>(path)).first;
+
+    return *it->second;
+}
+
+const uint8_t* PackedCUDatabase::getCU(uint64_t index) const
+{
+    if (index >= this->header.nbElements)
+        throw std::out_of_range("CU index " + std::to_string(index) + " out of packed database " + this->path);
+
+    return this->mapping + this->header.dataOffset + index * this->header.recordSize;
+}
+
+// ********************************************************************* //
+// ******************************* GETTERS ***************************** //
+// ********************************************************************* //
+
+const std::string& PackedCUDatabase::getPath() const { return path; }
+uint32_t PackedCUDatabase::getCuHeight() const { return header.cuHeight; }
+uint32_t PackedCUDatabase::getCuWidth() const { return header.cuWidth; }
+uint32_t PackedCUDatabase::getRecordSize() const { return header.recordSize; }
+uint64_t PackedCUDatabase::getNbElements() const { return header.nbElements; }
+uint64_t PackedCUDatabase::getNbPerClass(uint8_t split) const { return split < 6 ? header.nbPerClass[split] : 0; }
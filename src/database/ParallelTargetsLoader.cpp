@@ -0,0 +1,67 @@
+#include <algorithm>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "../../include/database/ParallelTargetsLoader.h"
+
+uint64_t ParallelTargetsLoader::getSubstreamSeed(uint64_t seed, uint64_t stream, uint64_t idx)
+{
+    uint64_t z = seed;
+    for (uint64_t value : {stream, idx})
+    {
+        z += 0x9E3779B97F4A7C15ULL + value;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        z = z ^ (z >> 31);
+    }
+    return z;
+}
+
+std::vector<uint64_t> ParallelTargetsLoader::run(uint64_t nbTargets, size_t nbThreads, const Loader& loader, const std::atomic<bool>* stopRequested)
+{
+    // Loading status of each target (char rather than bool : written concurrently)
+    std::vector<char> loaded(nbTargets, 0);
+    std::atomic<uint64_t> nextIdx(0);
+
+    std::exception_ptr firstException;
+    std::mutex exceptionMutex;
+
+    auto work = [&]() {
+        uint64_t idx;
+        while ((idx = nextIdx++) < nbTargets)
+        {
+            if (stopRequested && *stopRequested)
+                return;
+            try
+            {
+                loaded[idx] = loader(idx);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(exceptionMutex);
+                if (!firstException)
+                    firstException = std::current_exception();
+                nextIdx = nbTargets;   // Stop the other threads
+            }
+        }
+    };
+
+    // The calling thread is one of the workers
+    std::vector<std::thread> threads;
+    size_t nbHelpers = (nbThreads > 1 && nbTargets > 1) ? std::min<uint64_t>(nbThreads, nbTargets) - 1 : 0;
+    for (size_t idx_thread = 0; idx_thread < nbHelpers; idx_thread++)
+        threads.emplace_back(work);
+    work();
+    for (std::thread& thread : threads)
+        thread.join();
+
+    if (firstException)
+        std::rethrow_exception(firstException);
+
+    std::vector<uint64_t> failed;
+    for (uint64_t idx = 0; idx < nbTargets; idx++)
+        if (!loaded[idx])
+            failed.push_back(idx);
+    return failed;
+}
@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#include "../../include/database/SyntheticDatabase.h"
+#include "../../include/database/FeaturesDatabase.h"
+#include "../../include/database/PackedCUDatabase.h"
+#include "../../include/database/ParallelTargetsLoader.h"
+
+namespace {
+    // Streams of the RNGs (Cf. getGenerator())
+    const uint64_t SPLITS_STREAM = 0;
+    const uint64_t PIXELS_STREAM = 1;
+    const uint64_t FEATURES_STREAM = 2;
+
+    /// Uniform integer in [0, n[
+    uint64_t drawInt(std::mt19937_64& generator, uint64_t n) { return generator() % n; }
+
+    /// Uniform double in [0, 1[
+    double drawDouble(std::mt19937_64& generator) { return (double) (generator() >> 11) * 0x1.0p-53; }
+
+    std::FILE* openOutput(const std::string& path)
+    {
+        std::FILE* output = std::fopen(path.c_str(), "wb");
+        if (!output)
+            throw std::runtime_error("File opening failed : " + path);
+        return output;
+    }
+}
+
+const char* SyntheticDatabase::SPLIT_NAMES[6] = {"NS", "QT", "BTH", "BTV", "TTH", "TTV"};
+
+SyntheticDatabase::SyntheticDatabase(uint64_t nbElements, uint32_t cuHeight, uint32_t cuWidth, uint32_t nbFeatures,
+                                     const std::vector<double>& classWeights, uint64_t seed)
+        : nbElements(nbElements), cuHeight(cuHeight), cuWidth(cuWidth), nbFeatures(nbFeatures), seed(seed), nbPerClass(6, 0)
+{
+    if (cuHeight == 0 || cuWidth == 0)
+        throw std::invalid_argument("SyntheticDatabase: the CU dimensions must not be 0");
+    double totalWeight = 0.0;
+    for (double weight : classWeights)
+    {
+        if (weight < 0.0)
+            throw std::invalid_argument("SyntheticDatabase: negative class weight");
+        totalWeight += weight;
+    }
+    if (classWeights.size() != 6 || totalWeight <= 0.0)
+        throw std::invalid_argument("SyntheticDatabase: 6 class weights with a positive sum are needed");
+
+    // ------------------ Class counts : floor of the exact shares, then the largest remainders ------------------
+    uint64_t nbAssigned = 0;
+    std::vector<std::pair<double, uint8_t>> remainders;
+    for (uint8_t split = 0; split < 6; split++)
+    {
+        double share = (double) nbElements * classWeights[split] / totalWeight;
+        this->nbPerClass[split] = (uint64_t) share;
+        nbAssigned += this->nbPerClass[split];
+        remainders.emplace_back(share - (double) this->nbPerClass[split], split);
+    }
+    std::stable_sort(remainders.begin(), remainders.end(),
+                     [](const std::pair<double, uint8_t>& a, const std::pair<double, uint8_t>& b) { return a.first > b.first; });
+    for (size_t idx = 0; nbAssigned < nbElements; idx = (idx + 1) % 6)
+        if (classWeights[remainders[idx].second] > 0.0)
+        {
+            this->nbPerClass[remainders[idx].second]++;
+            nbAssigned++;
+        }
+
+    // ------------------ Splits of the CUs, shuffled (Fisher-Yates) ------------------
+    this->splits.reserve(nbElements);
+    for (uint8_t split = 0; split < 6; split++)
+        this->splits.insert(this->splits.end(), this->nbPerClass[split], split);
+    std::mt19937_64 generator = this->getGenerator(SPLITS_STREAM, 0);
+    for (uint64_t idx = nbElements; idx > 1; idx--)
+        std::swap(this->splits[idx - 1], this->splits[drawInt(generator, idx)]);
+}
+
+std::mt19937_64 SyntheticDatabase::getGenerator(uint64_t stream, uint64_t cuNumber) const
+{
+    return std::mt19937_64(ParallelTargetsLoader::getSubstreamSeed(this->seed, stream, cuNumber));
+}
+
+uint8_t SyntheticDatabase::getSplit(uint64_t cuNumber) const { return this->splits.at(cuNumber); }
+
+const std::vector<uint64_t>& SyntheticDatabase::getNbPerClass() const { return this->nbPerClass; }
+
+void SyntheticDatabase::getPixels(uint64_t cuNumber, uint8_t* pixels) const
+{
+    std::mt19937_64 generator = this->getGenerator(PIXELS_STREAM, cuNumber);
+    const uint8_t split = this->getSplit(cuNumber);
+    const int level = 16 + (int) drawInt(generator, 200);
+    const int edge = 8 + (int) drawInt(generator, 32);
+    const int noise = 1 + (int) drawInt(generator, 8);
+    const uint32_t h = this->cuHeight, w = this->cuWidth;
+
+    for (uint32_t y = 0; y < h; y++)
+        for (uint32_t x = 0; x < w; x++)
+        {
+            // Region of the pixel in the partition of its split (the edges of the split separate the regions)
+            int region = 0;
+            switch (split)
+            {
+                case 1: region = (y >= h / 2) ^ (x >= w / 2); break;          // QT : quadrants
+                case 2: region = y >= h / 2; break;                           // BTH
+                case 3: region = x >= w / 2; break;                           // BTV
+                case 4: region = y >= h / 4 && y < 3 * h / 4; break;          // TTH
+                case 5: region = x >= w / 4 && x < 3 * w / 4; break;          // TTV
+                default: break;                                               // NP : flat
+            }
+            int value = level + (region ? edge : 0) + (int) drawInt(generator, 2 * noise + 1) - noise;
+            pixels[y * w + x] = (uint8_t) std::min(255, std::max(0, value));
+        }
+}
+
+void SyntheticDatabase::getFeatures(uint64_t cuNumber, double* values) const
+{
+    static const double qps[4] = {22, 27, 32, 37};
+    std::mt19937_64 generator = this->getGenerator(FEATURES_STREAM, cuNumber);
+    const uint8_t split = this->getSplit(cuNumber);
+    values[0] = qps[drawInt(generator, 4)];
+    for (uint32_t idx_feat = 0; idx_feat < this->nbFeatures; idx_feat++)
+        values[idx_feat + 1] = 2.0 * drawDouble(generator) - 1.0 + ((idx_feat % 6 == split) ? 1.0 : 0.0);
+}
+
+// ------------------ Files read by the environments ------------------
+void SyntheticDatabase::writePixelFiles(const std::string& directory) const
+{
+    std::vector<uint8_t> contents(this->cuHeight * this->cuWidth + 1);
+    for (uint64_t cuNumber = 0; cuNumber < this->nbElements; cuNumber++)
+    {
+        this->getPixels(cuNumber, contents.data());
+        contents.back() = this->getSplit(cuNumber);
+        const std::string path = directory + std::to_string(cuNumber) + ".bin";
+        std::FILE* output = openOutput(path);
+        size_t nbWritten = std::fwrite(contents.data(), 1, contents.size(), output);
+        std::fclose(output);
+        if (nbWritten != contents.size())
+            throw std::runtime_error("File writing failed : " + path);
+    }
+}
+
+void SyntheticDatabase::writeFeaturesFiles(const std::string& directory) const
+{
+    std::vector<double> values(this->nbFeatures + 1);
+    for (uint64_t cuNumber = 0; cuNumber < this->nbElements; cuNumber++)
+    {
+        this->getFeatures(cuNumber, values.data());
+        const std::string path = directory + std::to_string(cuNumber) + ".csv";
+        std::ofstream csv(path, std::ios::out | std::ios::trunc);
+        if (!csv)
+            throw std::runtime_error("File opening failed : " + path);
+        // All the digits : the CSV files and the binary features database hold the same values
+        csv.precision(std::numeric_limits<double>::max_digits10);
+        csv << values[0] << "," << SPLIT_NAMES[this->getSplit(cuNumber)];
+        for (uint32_t idx_feat = 1; idx_feat <= this->nbFeatures; idx_feat++)
+            csv << "," << values[idx_feat];
+        csv << std::endl;
+        if (!csv)
+            throw std::runtime_error("File writing failed : " + path);
+    }
+}
+
+void SyntheticDatabase::writePackedDatabase(const std::string& file) const
+{
+    PackedCUDatabaseHeader header{};
+    std::memcpy(header.magic, PackedCUDatabase::MAGIC, sizeof(header.magic));
+    header.version = PackedCUDatabase::VERSION;
+    header.cuHeight = this->cuHeight;
+    header.cuWidth = this->cuWidth;
+    header.recordSize = this->cuHeight * this->cuWidth + 1;
+    header.nbElements = this->nbElements;
+    std::copy(this->nbPerClass.begin(), this->nbPerClass.end(), header.nbPerClass);
+    header.dataOffset = sizeof(PackedCUDatabaseHeader);
+
+    std::FILE* output = openOutput(file);
+    bool written = std::fwrite(&header, sizeof(PackedCUDatabaseHeader), 1, output) == 1;
+    std::vector<uint8_t> record(header.recordSize);
+    for (uint64_t cuNumber = 0; written && cuNumber < this->nbElements; cuNumber++)
+    {
+        // Same layout as a .bin file
+        this->getPixels(cuNumber, record.data());
+        record.back() = this->getSplit(cuNumber);
+        written = std::fwrite(record.data(), 1, record.size(), output) == record.size();
+    }
+    std::fclose(output);
+    if (!written)
+        throw std::runtime_error("File writing failed : " + file);
+}
+
+void SyntheticDatabase::writeFeaturesDatabase(const std::string& file) const
+{
+    FeaturesDatabaseHeader header{};
+    std::memcpy(header.magic, FeaturesDatabase::MAGIC, sizeof(header.magic));
+    header.version = FeaturesDatabase::VERSION;
+    header.nbFeatures = this->nbFeatures;
+    header.nbElements = this->nbElements;
+    std::copy(this->nbPerClass.begin(), this->nbPerClass.end(), header.nbPerClass);
+    header.valuesOffset = sizeof(FeaturesDatabaseHeader);
+    header.labelsOffset = header.valuesOffset + this->nbElements * (this->nbFeatures + 1) * sizeof(double);
+
+    std::FILE* output = openOutput(file);
+    bool written = std::fwrite(&header, sizeof(FeaturesDatabaseHeader), 1, output) == 1;
+    std::vector<double> values(this->nbFeatures + 1);
+    for (uint64_t cuNumber = 0; written && cuNumber < this->nbElements; cuNumber++)
+    {
+        this->getFeatures(cuNumber, values.data());
+        written = std::fwrite(values.data(), sizeof(double), values.size(), output) == values.size();
+    }
+    written = written && std::fwrite(this->splits.data(), 1, this->splits.size(), output) == this->splits.size();
+    std::fclose(output);
+    if (!written)
+        throw std::runtime_error("File writing failed : " + file);
+}
@@ -0,0 +1,45 @@
+#include "../../include/database/TargetsPrefetcher.h"
+
+TargetsPrefetcher::TargetsPrefetcher() : stopRequested(false), owner(nullptr) {}
+
+TargetsPrefetcher::~TargetsPrefetcher()
+{
+    this->stop(this->owner);
+}
+
+void TargetsPrefetcher::start(const void* loaderOwner, Loader loader)
+{
+    this->wait();
+
+    this->stopRequested = false;
+    this->owner = loaderOwner;
+    this->loading = std::async(std::launch::async, [this, loader]() { loader(this->stopRequested); });
+}
+
+void TargetsPrefetcher::wait()
+{
+    if (this->loading.valid())
+        this->loading.get();   // Rethrows exceptions from the loader
+}
+
+void TargetsPrefetcher::stop(const void* loaderOwner)
+{
+    if (!this->loading.valid() || loaderOwner != this->owner)
+        return;
+
+    this->stopRequested = true;
+    try
+    {
+        this->loading.get();
+    }
+    catch (...)
+    {
+        // Targets of a stopped loading are never used
+    }
+    this->owner = nullptr;
+}
+
+bool TargetsPrefetcher::isLoading() const
+{
+    return this->loading.valid();
+}
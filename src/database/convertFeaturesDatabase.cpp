@@ -0,0 +1,148 @@
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "../../include/database/FeaturesDatabase.h"
+
+/**
+ * \brief Return the number of a split from its name in the CSV files
+ * (0: NP or NS, 1: QT, 2: BTH, 3:BTV, 4: TTH, 5: TTV) else return 6 (error)
+ */
+uint8_t getSplitNumber(const std::string& split)
+{
+    const char* splitNames[6] = {"NS", "QT", "BTH", "BTV", "TTH", "TTV"};
+    for (uint8_t splitNumber = 0; splitNumber < 6; splitNumber++)
+        if (split == splitNames[splitNumber])
+            return splitNumber;
+    return 6;
+}
+
+/**
+ * Convert every "<n>.csv" file of a features database ("QP,split,feature_0,...,feature_{nbFeatures-1}")
+ * into a single binary file (Cf. FeaturesDatabaseHeader)
+ *
+ * Example : "./TPGVVCPartDatabase_convertFeaturesDatabase /home/cleonard/Data/features/balanced1/ 686088 112 /home/cleonard/Data/features/balanced1.ftdb"
+ * The binary file can then be given to the features environments in place of the database directory.
+ */
+int main(int argc, char* argv[])
+{
+    std::cout << "Start TPGVVCPartDatabase : converting a CSV features database into a binary file." << std::endl;
+
+    if (argc != 5)
+    {
+        std::cout << "Waiting 4 arguments : databasePath, nbElements, nbFeatures and outputFile." << std::endl;
+        std::cout << "Example : \"./TPGVVCPartDatabase_convertFeaturesDatabase /Path/To/Dataset/ 686088 112 /Path/To/Dataset.ftdb\"" << std::endl;
+        return 1;
+    }
+
+    std::string databasePath = argv[1];
+    uint64_t nbElements = std::strtoull(argv[2], nullptr, 10);
+    uint32_t nbFeatures = (uint32_t) atoi(argv[3]);
+    std::string outputFile = argv[4];
+
+    if (!FeaturesDatabase::isFeaturesDatabase(outputFile))
+        std::cout << "Warning: the output file should end with \"" << FeaturesDatabase::FILE_EXTENSION
+                  << "\" to be recognized as a binary features database by the environments." << std::endl;
+
+    // ------------------ Prepare the header ------------------
+    // Layout : header, then the rows of values (header size is a multiple of 8), then the splits column
+    FeaturesDatabaseHeader header{};
+    std::memcpy(header.magic, FeaturesDatabase::MAGIC, sizeof(header.magic));
+    header.version = FeaturesDatabase::VERSION;
+    header.nbFeatures = nbFeatures;
+    header.nbElements = nbElements;
+    header.valuesOffset = sizeof(FeaturesDatabaseHeader);
+    header.labelsOffset = header.valuesOffset + nbElements * (nbFeatures + 1) * sizeof(double);
+
+    std::FILE* output = std::fopen(outputFile.c_str(), "wb");
+    if (!output)
+    {
+        std::perror(("File opening failed : " + outputFile).c_str());
+        return 1;
+    }
+    // The header is written twice: once to reserve its place, then once the class counts are known
+    if (std::fwrite(&header, sizeof(FeaturesDatabaseHeader), 1, output) != 1)
+    {
+        std::perror(("File writing failed : " + outputFile).c_str());
+        std::fclose(output);
+        return 1;
+    }
+
+    // ------------------ Parse every CSV file ------------------
+    std::vector<uint8_t> splits(nbElements);
+    std::vector<double> values(nbFeatures + 1);
+    std::string line;
+    for (uint64_t cuNumber = 0; cuNumber < nbElements; cuNumber++)
+    {
+        std::string csvPath = databasePath + std::to_string(cuNumber) + ".csv";
+        std::ifstream file(csvPath, std::ios::in);
+        if (!file.good() || !std::getline(file, line))
+        {
+            std::cerr << "File opening failed : " << csvPath << std::endl;
+            std::fclose(output);
+            return 1;
+        }
+
+        // QP, then the split name, then every feature
+        const char* cursor = line.c_str();
+        char* end;
+        values[0] = std::strtod(cursor, &end);
+        const char* splitBegin = end + 1;
+        const char* splitEnd = std::strchr(splitBegin, ',');
+        if (*end != ',' || splitEnd == nullptr)
+        {
+            std::cerr << "Malformed CSV file : " << csvPath << std::endl;
+            std::fclose(output);
+            return 1;
+        }
+        splits[cuNumber] = getSplitNumber(std::string(splitBegin, splitEnd));
+        cursor = splitEnd;
+        for (uint32_t featureIdx = 1; featureIdx <= nbFeatures; featureIdx++)
+        {
+            if (*cursor != ',')
+            {
+                std::cerr << "Malformed CSV file : " << csvPath << " (" << featureIdx - 1 << " features instead of " << nbFeatures << ")" << std::endl;
+                std::fclose(output);
+                return 1;
+            }
+            values[featureIdx] = std::strtod(cursor + 1, &end);
+            cursor = end;
+        }
+
+        if (splits[cuNumber] < 6)
+            header.nbPerClass[splits[cuNumber]]++;
+        else
+            std::cout << "Warning: unknown split in " << csvPath << std::endl;
+
+        if (std::fwrite(values.data(), sizeof(double), values.size(), output) != values.size())
+        {
+            std::perror(("File writing failed : " + outputFile).c_str());
+            std::fclose(output);
+            return 1;
+        }
+
+        if ((cuNumber + 1) % 100000 == 0)
+            std::cout << "  " << cuNumber + 1 << "/" << nbElements << " CUs converted" << std::endl;
+    }
+
+    // ------------------ Write the splits column and the completed header ------------------
+    bool written = std::fwrite(splits.data(), 1, splits.size(), output) == splits.size()
+                   && std::fseek(output, 0, SEEK_SET) == 0
+                   && std::fwrite(&header, sizeof(FeaturesDatabaseHeader), 1, output) == 1;
+    // Closing flushes the last rows : a failure there is a writing failure too
+    bool closed = std::fclose(output) == 0;
+    if (!written || !closed)
+    {
+        std::perror(("File writing failed : " + outputFile).c_str());
+        return 1;
+    }
+
+    std::cout << nbElements << " CUs converted in " << outputFile << std::endl;
+    std::cout << "  NP: " << header.nbPerClass[0] << ", QT: " << header.nbPerClass[1]
+              << ", BTH: " << header.nbPerClass[2] << ", BTV: " << header.nbPerClass[3]
+              << ", TTH: " << header.nbPerClass[4] << ", TTV: " << header.nbPerClass[5] << std::endl;
+
+    return 0;
+}
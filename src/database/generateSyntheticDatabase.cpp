@@ -0,0 +1,72 @@
+#include <iostream>
+#include <cstdlib>
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../../include/database/SyntheticDatabase.h"
+#include "../../include/database/FeaturesDatabase.h"
+#include "../../include/database/PackedCUDatabase.h"
+
+/**
+ * Generate a synthetic CU database in every format read by the environments (Cf. SyntheticDatabase) :
+ *   - outputDirectory/pixels/<n>.bin and outputDirectory/pixels.cudb
+ *   - outputDirectory/features/<n>.csv and outputDirectory/features.ftdb
+ *
+ * Example : "./TPGVVCPartDatabase_generateSyntheticDatabase /tmp/synthetic/ 10000 32 32 112 1,1,1,1,1,1 0"
+ * Useful to run the trainings and the benchmarks without the real databases, or to test a new loader against the
+ * known splits of the CUs.
+ */
+int main(int argc, char* argv[])
+{
+    std::cout << "Start TPGVVCPartDatabase : generation of a synthetic CU database." << std::endl;
+
+    if (argc < 3 || argc > 8 || argc == 4)
+    {
+        std::cout << "Waiting 2 to 7 arguments : outputDirectory, nbElements and optionally cuHeight cuWidth (32 32), "
+                     "nbFeatures (112), classWeights (1,1,1,1,1,1) and seed (0)." << std::endl;
+        std::cout << "Example : \"./TPGVVCPartDatabase_generateSyntheticDatabase /Path/To/Output/ 10000 32 32 112 4,1,1,1,1,1 0\"" << std::endl;
+        return 1;
+    }
+
+    std::filesystem::path outputDirectory(argv[1]);
+    uint64_t nbElements = std::strtoull(argv[2], nullptr, 10);
+    uint32_t cuHeight = (argc > 4) ? (uint32_t) atoi(argv[3]) : 32;
+    uint32_t cuWidth = (argc > 4) ? (uint32_t) atoi(argv[4]) : 32;
+    uint32_t nbFeatures = (argc > 5) ? (uint32_t) atoi(argv[5]) : 112;
+    std::vector<double> classWeights(6, 1.0);
+    if (argc > 6)
+    {
+        classWeights.clear();
+        std::stringstream weights(argv[6]);
+        std::string weight;
+        while (std::getline(weights, weight, ','))
+            classWeights.push_back(std::atof(weight.c_str()));
+    }
+    uint64_t seed = (argc > 7) ? std::strtoull(argv[7], nullptr, 10) : 0;
+
+    try
+    {
+        SyntheticDatabase database(nbElements, cuHeight, cuWidth, nbFeatures, classWeights, seed);
+
+        // The environments concatenate the CU number to the database path : keep the final '/'
+        std::filesystem::create_directories(outputDirectory / "pixels");
+        std::filesystem::create_directories(outputDirectory / "features");
+        database.writePixelFiles((outputDirectory / "pixels").string() + "/");
+        database.writeFeaturesFiles((outputDirectory / "features").string() + "/");
+        database.writePackedDatabase((outputDirectory / ("pixels" + PackedCUDatabase::FILE_EXTENSION)).string());
+        database.writeFeaturesDatabase((outputDirectory / ("features" + FeaturesDatabase::FILE_EXTENSION)).string());
+
+        std::cout << nbElements << " CUs (" << cuHeight << "x" << cuWidth << ", " << nbFeatures << " features) written in "
+                  << outputDirectory.string() << std::endl;
+        for (uint8_t split = 0; split < 6; split++)
+            std::cout << "  " << SyntheticDatabase::SPLIT_NAMES[split] << " : " << database.getNbPerClass()[split] << std::endl;
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "../../include/database/PackedCUDatabase.h"
+
+/**
+ * Concatenate every "<n>.bin" file of a pixel CU database into a single packed file (Cf. PackedCUDatabaseHeader)
+ *
+ * Example : "./TPGVVCPartDatabase_packCUDatabase /home/cleonard/Data/CU/CU_32x32_balanced/ 420000 32 32 /home/cleonard/Data/CU/CU_32x32_balanced.cudb"
+ * The packed file can then be given to the pixel environments in place of the database directory.
+ */
+int main(int argc, char* argv[])
+{
+    std::cout << "Start TPGVVCPartDatabase : packing a CU database in a single file." << std::endl;
+
+    if (argc != 6)
+    {
+        std::cout << "Waiting 5 arguments : databasePath, nbElements, cuHeight, cuWidth and outputFile." << std::endl;
+        std::cout << "Example : \"./TPGVVCPartDatabase_packCUDatabase /Path/To/Dataset/ 420000 32 32 /Path/To/Dataset.cudb\"" << std::endl;
+        return 1;
+    }
+
+    std::string databasePath = argv[1];
+    uint64_t nbElements = std::strtoull(argv[2], nullptr, 10);
+    uint32_t cuHeight = (uint32_t) atoi(argv[3]);
+    uint32_t cuWidth = (uint32_t) atoi(argv[4]);
+    std::string outputFile = argv[5];
+
+    if (!PackedCUDatabase::isPackedDatabase(outputFile))
+        std::cout << "Warning: the output file should end with \"" << PackedCUDatabase::FILE_EXTENSION
+                  << "\" to be recognized as a packed database by the environments." << std::endl;
+
+    // ------------------ Prepare the header ------------------
+    PackedCUDatabaseHeader header{};
+    std::memcpy(header.magic, PackedCUDatabase::MAGIC, sizeof(header.magic));
+    header.version = PackedCUDatabase::VERSION;
+    header.cuHeight = cuHeight;
+    header.cuWidth = cuWidth;
+    header.recordSize = cuHeight * cuWidth + 1;
+    header.nbElements = nbElements;
+    header.dataOffset = sizeof(PackedCUDatabaseHeader);
+
+    std::FILE* output = std::fopen(outputFile.c_str(), "wb");
+    if (!output)
+    {
+        std::perror(("File opening failed : " + outputFile).c_str());
+        return 1;
+    }
+    // The header is written twice: once to reserve its place, then once the class counts are known
+    if (std::fwrite(&header, sizeof(PackedCUDatabaseHeader), 1, output) != 1)
+    {
+        std::perror(("File writing failed : " + outputFile).c_str());
+        std::fclose(output);
+        return 1;
+    }
+
+    // ------------------ Copy every CU file ------------------
+    std::vector<uint8_t> contents(header.recordSize);
+    for (uint64_t cuNumber = 0; cuNumber < nbElements; cuNumber++)
+    {
+        std::string cuPath = databasePath + std::to_string(cuNumber) + ".bin";
+        std::FILE* input = std::fopen(cuPath.c_str(), "rb");
+        if (!input)
+        {
+            std::perror(("File opening failed : " + cuPath).c_str());
+            std::fclose(output);
+            return 1;
+        }
+        size_t nbCharRead = std::fread(contents.data(), 1, header.recordSize, input);
+        std::fclose(input);
+        if (nbCharRead != header.recordSize)
+        {
+            std::cerr << "File Read failed : " << cuPath << " (" << nbCharRead << " bytes instead of " << header.recordSize << ")" << std::endl;
+            std::fclose(output);
+            return 1;
+        }
+
+        // Last byte of the record is the optimal split
+        uint8_t split = contents[header.recordSize - 1];
+        if (split < 6)
+            header.nbPerClass[split]++;
+        else
+            std::cout << "Warning: unknown split " << (int) split << " in " << cuPath << std::endl;
+
+        if (std::fwrite(contents.data(), 1, header.recordSize, output) != header.recordSize)
+        {
+            std::perror(("File writing failed : " + outputFile).c_str());
+            std::fclose(output);
+            return 1;
+        }
+
+        if ((cuNumber + 1) % 100000 == 0)
+            std::cout << "  " << cuNumber + 1 << "/" << nbElements << " CUs packed" << std::endl;
+    }
+
+    // ------------------ Rewrite the completed header ------------------
+    bool written = std::fseek(output, 0, SEEK_SET) == 0 && std::fwrite(&header, sizeof(PackedCUDatabaseHeader), 1, output) == 1;
+    // Closing flushes the last records : a failure there is a writing failure too
+    bool closed = std::fclose(output) == 0;
+    if (!written || !closed)
+    {
+        std::perror(("File writing failed : " + outputFile).c_str());
+        return 1;
+    }
+
+    std::cout << nbElements << " CUs packed in " << outputFile << std::endl;
+    std::cout << "  NP: " << header.nbPerClass[0] << ", QT: " << header.nbPerClass[1]
+              << ", BTH: " << header.nbPerClass[2] << ", BTV: " << header.nbPerClass[3]
+              << ", TTH: " << header.nbPerClass[4] << ", TTV: " << header.nbPerClass[5] << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+
+#include "../../include/evaluation/MemoryTracker.h"
+
+std::atomic<uint64_t> MemoryTracker::liveBytes(0);
+std::atomic<uint64_t> MemoryTracker::peakBytes(0);
+std::atomic<uint64_t> MemoryTracker::phasePeakBytes(0);
+std::atomic<uint64_t> MemoryTracker::nbAllocations(0);
+
+namespace {
+    /// Raise an atomic peak up to value
+    void updatePeak(std::atomic<uint64_t>& peak, uint64_t value)
+    {
+        uint64_t previous = peak;
+        while (previous < value && !peak.compare_exchange_weak(previous, value)) {}
+    }
+
+    /// Value of a "<key>: <value> kB" line of /proc/self/status, in bytes
+    uint64_t readProcStatus(const std::string& key)
+    {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line))
+            if (line.compare(0, key.size(), key) == 0)
+                return std::strtoull(line.c_str() + key.size(), nullptr, 10) * 1024;
+        return 0;
+    }
+}
+
+bool MemoryTracker::isCountingAllocations()
+{
+#ifdef MEMORY_TRACKING
+    return true;
+#else
+    return false;
+#endif
+}
+
+void MemoryTracker::countAllocation(uint64_t size)
+{
+    MemoryTracker::nbAllocations++;
+    uint64_t live = (MemoryTracker::liveBytes += size);
+    updatePeak(MemoryTracker::peakBytes, live);
+    updatePeak(MemoryTracker::phasePeakBytes, live);
+}
+
+void MemoryTracker::countDeallocation(uint64_t size) { MemoryTracker::liveBytes -= size; }
+
+uint64_t MemoryTracker::getLiveBytes() { return MemoryTracker::liveBytes; }
+
+uint64_t MemoryTracker::getPeakBytes() { return MemoryTracker::peakBytes; }
+
+uint64_t MemoryTracker::getPhasePeakBytes() { return MemoryTracker::phasePeakBytes; }
+
+void MemoryTracker::resetPhasePeakBytes() { MemoryTracker::phasePeakBytes = MemoryTracker::liveBytes.load(); }
+
+uint64_t MemoryTracker::getNbAllocations() { return MemoryTracker::nbAllocations; }
+
+uint64_t MemoryTracker::getResidentBytes() { return readProcStatus("VmRSS:"); }
+
+uint64_t MemoryTracker::getPeakResidentBytes() { return readProcStatus("VmHWM:"); }
+
+#ifdef MEMORY_TRACKING
+// ------------------ Counting global allocator ------------------
+// The size of each block is stored in front of it : operator delete gets it back without any allocator extension.
+// The header keeps the alignment of malloc (the over-aligned news of C++17 are left to the standard library).
+namespace {
+    const std::size_t HEADER_SIZE = alignof(std::max_align_t);
+}
+
+void* operator new(std::size_t size)
+{
+    if (void* block = std::malloc(size + HEADER_SIZE))
+    {
+        *static_cast<std::size_t*>(block) = size;
+        MemoryTracker::countAllocation(size);
+        return static_cast<char*>(block) + HEADER_SIZE;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) { return ::operator new(size); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    try { return ::operator new(size); }
+    catch (...) { return nullptr; }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return ::operator new(size, std::nothrow); }
+
+void operator delete(void* ptr) noexcept
+{
+    if (ptr == nullptr)
+        return;
+    void* block = static_cast<char*>(ptr) - HEADER_SIZE;
+    MemoryTracker::countDeallocation(*static_cast<std::size_t*>(block));
+    std::free(block);
+}
+
+void operator delete[](void* ptr) noexcept { ::operator delete(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { ::operator delete(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { ::operator delete(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { ::operator delete(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { ::operator delete(ptr); }
+#endif
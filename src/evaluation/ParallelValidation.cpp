@@ -0,0 +1,77 @@
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "../../include/evaluation/ParallelValidation.h"
+
+std::vector<std::vector<uint64_t>> ParallelValidation::run(const Learn::LearningEnvironment& le, const Environment& env, const TPG::TPGVertex& root,
+                                                           uint64_t nbTargets, uint64_t nbClasses, size_t nbThreads, const TargetLoader& loadTarget)
+{
+    if (nbTargets == 0)
+        return std::vector<std::vector<uint64_t>>(nbClasses, std::vector<uint64_t>(nbClasses, 0));
+
+    size_t nbRanges = (nbThreads > 1 && nbTargets > 1) ? (size_t) std::min<uint64_t>(nbThreads, nbTargets) : 1;
+    std::vector<std::vector<std::vector<uint64_t>>> tables(nbRanges, std::vector<std::vector<uint64_t>>(nbClasses, std::vector<uint64_t>(nbClasses, 0)));
+
+    std::exception_ptr firstException;
+    std::mutex exceptionMutex;
+
+    auto work = [&](size_t idx_range) {
+        try
+        {
+            // Private copy of the LearningEnvironment, and Environment on its data sources
+            std::unique_ptr<Learn::LearningEnvironment> clone(le.clone());
+            if (!clone)
+                throw std::runtime_error("ParallelValidation: the LearningEnvironment is not copyable");
+            clone->reset(0, Learn::LearningMode::VALIDATION);
+            Environment privateEnv(env.getInstructionSet(), clone->getDataSources(), env.getNbRegisters(), env.getNbConstant());
+            TPG::TPGExecutionEngine tee(privateEnv, nullptr);
+
+            std::vector<std::vector<uint64_t>>& classifTable = tables[idx_range];
+            uint64_t begin = nbTargets * idx_range / nbRanges;
+            uint64_t end = nbTargets * (idx_range + 1) / nbRanges;
+            for (uint64_t idx = begin; idx < end; idx++)
+            {
+                // Get answer
+                uint64_t optimalActionID = loadTarget(*clone, idx);
+
+                // Execute
+                auto path = tee.executeFromRoot(root);
+                uint64_t actionID = ((const TPG::TPGAction *) path.at(path.size() - 1))->getActionID();
+
+                if (optimalActionID >= nbClasses || actionID >= nbClasses)
+                    throw std::runtime_error("ParallelValidation: class or action out of the classification table");
+
+                // Increment table
+                classifTable[optimalActionID][actionID]++;
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(exceptionMutex);
+            if (!firstException)
+                firstException = std::current_exception();
+        }
+    };
+
+    // The calling thread evaluates the first range
+    std::vector<std::thread> threads;
+    for (size_t idx_range = 1; idx_range < nbRanges; idx_range++)
+        threads.emplace_back(work, idx_range);
+    work(0);
+    for (std::thread& thread : threads)
+        thread.join();
+
+    if (firstException)
+        std::rethrow_exception(firstException);
+
+    // Merge the tables
+    for (size_t idx_range = 1; idx_range < nbRanges; idx_range++)
+        for (uint64_t x = 0; x < nbClasses; x++)
+            for (uint64_t y = 0; y < nbClasses; y++)
+                tables[0][x][y] += tables[idx_range][x][y];
+    return tables[0];
+}
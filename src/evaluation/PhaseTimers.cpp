@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "../../include/evaluation/PhaseTimers.h"
+
+std::atomic<uint64_t> PhaseTimers::loadedCUs(0);
+std::atomic<uint64_t> PhaseTimers::loadedBytes(0);
+
+const char* PhaseTimers::getPhaseName(Phase phase)
+{
+    static const char* names[NB_PHASES] = {"targets", "mutation", "evaluation", "decimation", "validation", "files"};
+    return names[phase];
+}
+
+double PhaseTimers::getProcessCpuTime()
+{
+    // std::clock() is the wall time on Windows : the process times are read from the system
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+        return 0.0;
+    // 100 ns units
+    ULARGE_INTEGER kernelTime{}, userTime{};
+    kernelTime.LowPart = kernel.dwLowDateTime;
+    kernelTime.HighPart = kernel.dwHighDateTime;
+    userTime.LowPart = user.dwLowDateTime;
+    userTime.HighPart = user.dwHighDateTime;
+    return (double) (kernelTime.QuadPart + userTime.QuadPart) * 1e-7;
+#else
+    struct timespec time{};
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time) != 0)
+        return 0.0;
+    return (double) time.tv_sec + (double) time.tv_nsec * 1e-9;
+#endif
+}
+
+PhaseTimers::PhaseTimers(const std::string& filePath)
+        : file(filePath, std::ios::out | std::ios::trunc), memoryReport(false), records(), current(NB_PHASES), cpuStart(0.0),
+          cusStart(0), bytesStart(0), heapStart(0), allocationsStart(0)
+{
+    if (!this->file)
+        throw std::runtime_error("File opening failed : " + filePath);
+    this->file << "generation";
+    for (int phase = 0; phase < NB_PHASES; phase++)
+    {
+        const std::string name = PhaseTimers::getPhaseName((Phase) phase);
+        this->file << "," << name << "_wall_s," << name << "_cpu_s," << name << "_cus," << name << "_bytes";
+    }
+    this->file << std::endl;
+}
+
+void PhaseTimers::enableMemoryReport(const std::string& filePath)
+{
+    this->memoryFile.open(filePath, std::ios::out | std::ios::trunc);
+    if (!this->memoryFile)
+        throw std::runtime_error("File opening failed : " + filePath);
+    this->memoryReport = true;
+    if (!MemoryTracker::isCountingAllocations())
+        std::cout << "Warning: allocations not counted (MEMORY_TRACKING build needed), only the RSS is reported in "
+                  << filePath << std::endl;
+    this->memoryFile << "generation";
+    for (int phase = 0; phase < NB_PHASES; phase++)
+    {
+        const std::string name = PhaseTimers::getPhaseName((Phase) phase);
+        this->memoryFile << "," << name << "_heap_growth_bytes," << name << "_heap_peak_bytes," << name << "_allocations,"
+                         << name << "_rss_bytes";
+    }
+    this->memoryFile << ",heap_live_bytes,heap_peak_bytes,rss_bytes,peak_rss_bytes" << std::endl;
+}
+
+void PhaseTimers::start(Phase phase)
+{
+    this->stop();
+    this->current = phase;
+    this->cusStart = PhaseTimers::loadedCUs;
+    this->bytesStart = PhaseTimers::loadedBytes;
+    this->heapStart = MemoryTracker::getLiveBytes();
+    this->allocationsStart = MemoryTracker::getNbAllocations();
+    MemoryTracker::resetPhasePeakBytes();
+    this->cpuStart = PhaseTimers::getProcessCpuTime();
+    this->wallStart = std::chrono::steady_clock::now();
+}
+
+void PhaseTimers::stop()
+{
+    if (this->current == NB_PHASES)
+        return;
+    PhaseRecord& record = this->records[this->current];
+    record.wallTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - this->wallStart).count();
+    record.cpuTime += PhaseTimers::getProcessCpuTime() - this->cpuStart;
+    record.nbCUs += PhaseTimers::loadedCUs - this->cusStart;
+    record.nbBytes += PhaseTimers::loadedBytes - this->bytesStart;
+    record.heapGrowth += (int64_t) (MemoryTracker::getLiveBytes() - this->heapStart);
+    record.heapPeak = std::max(record.heapPeak, MemoryTracker::getPhasePeakBytes());
+    record.nbAllocations += MemoryTracker::getNbAllocations() - this->allocationsStart;
+    // Reading /proc costs a few microseconds : only done when reported
+    if (this->memoryReport)
+        record.residentBytes = MemoryTracker::getResidentBytes();
+    this->current = NB_PHASES;
+}
+
+void PhaseTimers::writeGeneration(uint64_t generation)
+{
+    this->stop();
+    this->file << generation;
+    for (const PhaseRecord& record : this->records)
+        this->file << "," << record.wallTime << "," << record.cpuTime << "," << record.nbCUs << "," << record.nbBytes;
+    this->file << std::endl;
+
+    if (this->memoryReport)
+    {
+        this->memoryFile << generation;
+        for (const PhaseRecord& record : this->records)
+            this->memoryFile << "," << record.heapGrowth << "," << record.heapPeak << "," << record.nbAllocations << ","
+                             << record.residentBytes;
+        this->memoryFile << "," << MemoryTracker::getLiveBytes() << "," << MemoryTracker::getPeakBytes() << ","
+                         << MemoryTracker::getResidentBytes() << "," << MemoryTracker::getPeakResidentBytes() << std::endl;
+    }
+
+    for (PhaseRecord& record : this->records)
+        record = PhaseRecord();
+}
+
+void PhaseTimers::countLoadedCUs(uint64_t nbCUs, uint64_t nbBytes)
+{
+    PhaseTimers::loadedCUs += nbCUs;
+    PhaseTimers::loadedBytes += nbBytes;
+}
+
+// ------------------ Scope ------------------
+PhaseTimers::Scope::Scope(PhaseTimers& timers, Phase phase) : timers(timers)
+{
+    this->timers.start(phase);
+}
+
+PhaseTimers::Scope::~Scope()
+{
+    this->timers.stop();
+}
+
+// ------------------ PhaseTimersLogger ------------------
+PhaseTimersLogger::PhaseTimersLogger(Learn::LearningAgent& la, PhaseTimers& timers)
+        : Log::LALogger(la), timers(timers)
+{
+}
+
+void PhaseTimersLogger::logHeader() {}
+
+void PhaseTimersLogger::logNewGeneration(uint64_t& generationNumber) { this->timers.start(PhaseTimers::MUTATION); }
+
+void PhaseTimersLogger::logAfterPopulateTPG() { this->timers.start(PhaseTimers::EVALUATION); }
+
+void PhaseTimersLogger::logAfterEvaluate(std::multimap<std::shared_ptr<Learn::EvaluationResult>, const TPG::TPGVertex*>& results)
+{
+    this->timers.start(PhaseTimers::DECIMATION);
+}
+
+void PhaseTimersLogger::logAfterDecimate() { this->timers.start(PhaseTimers::VALIDATION); }
+
+void PhaseTimersLogger::logAfterValidate(std::multimap<std::shared_ptr<Learn::EvaluationResult>, const TPG::TPGVertex*>& results)
+{
+    this->timers.stop();
+}
+
+void PhaseTimersLogger::logEndOfTraining() { this->timers.stop(); }
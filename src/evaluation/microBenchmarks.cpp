@@ -0,0 +1,215 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gegelati.h>
+
+#include "../../include/binary/DefaultBinaryEnv.h"
+#include "../../include/database/SyntheticDatabase.h"
+#include "../../include/evaluation/MemoryTracker.h"
+#include "../../include/features/BinaryFeaturesEnv.h"
+#include "../../include/instructions/InstructionSetFactory.h"
+
+namespace {
+    // Size of the synthetic dataset (files drawn by the environments in [0, NB_SYNTHETIC_CUS[)
+    const uint64_t NB_SYNTHETIC_CUS = 1000;
+    const uint64_t NB_FEATURES = 112;
+    const uint64_t NB_TARGETS = 1000;
+
+    struct BenchmarkResult {
+        std::string name;
+        uint64_t nbOperations;
+        double nsPerOperation;
+        double allocationsPerOperation;
+        double operationsPerSecond;
+        /// Bytes of CU data processed per second (0 if not relevant)
+        double bytesPerSecond;
+    };
+
+    /**
+    * \brief Run an operation until minTime seconds are spent (after a warm-up call), by batches of doubling size
+    * \param[in] bytesPerOperation the bytes of CU data processed by one operation (0 if not relevant)
+    */
+    template <class Operation>
+    BenchmarkResult runBenchmark(const std::string& name, double minTime, uint64_t bytesPerOperation, Operation operation)
+    {
+        operation();
+
+        uint64_t nbOperations = 0;
+        uint64_t allocations = 0;
+        double elapsed = 0.0;
+        for (uint64_t batch = 1; elapsed < minTime; batch *= 2)
+        {
+            uint64_t allocationsStart = MemoryTracker::getNbAllocations();
+            auto start = std::chrono::steady_clock::now();
+            for (uint64_t idx_op = 0; idx_op < batch; idx_op++)
+                operation();
+            elapsed += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            allocations += MemoryTracker::getNbAllocations() - allocationsStart;
+            nbOperations += batch;
+        }
+
+        BenchmarkResult result{name, nbOperations, elapsed * 1e9 / (double) nbOperations,
+                               (double) allocations / (double) nbOperations, (double) nbOperations / elapsed,
+                               (double) (bytesPerOperation * nbOperations) / elapsed};
+        std::cout << std::left << std::setw(36) << name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(14) << result.nsPerOperation << " ns/op" << std::setw(10) << result.allocationsPerOperation
+                  << " allocs/op" << std::setw(14) << std::setprecision(0) << result.operationsPerSecond << " op/s";
+        if (bytesPerOperation != 0)
+            std::cout << std::setw(10) << std::setprecision(1) << result.bytesPerSecond / 1e6 << " MB/s";
+        std::cout << std::endl;
+        return result;
+    }
+
+    void writeJson(const std::vector<BenchmarkResult>& results, const std::string& outputFile)
+    {
+        std::ofstream json(outputFile, std::ios::out | std::ios::trunc);
+        if (!json)
+            throw std::runtime_error("File opening failed : " + outputFile);
+        json << "{\n  \"benchmarks\": [\n";
+        for (size_t idx_res = 0; idx_res < results.size(); idx_res++)
+        {
+            const BenchmarkResult& result = results[idx_res];
+            json << "    {\"name\": \"" << result.name << "\", \"iterations\": " << result.nbOperations
+                 << ", \"ns_per_op\": " << result.nsPerOperation << ", \"allocs_per_op\": " << result.allocationsPerOperation
+                 << ", \"ops_per_s\": " << result.operationsPerSecond << ", \"bytes_per_s\": " << result.bytesPerSecond << "}"
+                 << ((idx_res + 1 < results.size()) ? "," : "") << "\n";
+        }
+        json << "  ]\n}\n";
+    }
+
+    /**
+    * \brief Create a new directory with a random name in the temporary directory of the system (portable mkdtemp())
+    * \throw std::filesystem::filesystem_error if the directory can't be created
+    */
+    std::filesystem::path createTemporaryDirectory()
+    {
+        std::mt19937_64 generator(std::random_device{}());
+        for (int attempt = 0; attempt < 100; attempt++)
+        {
+            std::ostringstream name;
+            name << "TPGVVCPartDatabase_bench_" << std::hex << generator();
+            const std::filesystem::path directory = std::filesystem::temp_directory_path() / name.str();
+            // False if the directory already exists : draw another name
+            if (std::filesystem::create_directory(directory))
+                return directory;
+        }
+        throw std::filesystem::filesystem_error("No unused temporary directory name", std::filesystem::temp_directory_path(),
+                                                std::make_error_code(std::errc::file_exists));
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::cout << "Start TPGVVCPartDatabase : micro-benchmarks of the data and execution hot paths." << std::endl;
+    // Optional arguments : JSON output file and minimum time of each benchmark (seconds)
+    std::string jsonFile = (argc > 1) ? argv[1] : "";
+    double minTime = (argc > 2) ? std::atof(argv[2]) : 0.5;
+
+    // ---------------- Synthetic dataset in a temporary directory ----------------
+    std::filesystem::path tempDirectory;
+    try
+    {
+        tempDirectory = createTemporaryDirectory();
+    }
+    catch (std::filesystem::filesystem_error& e)
+    {
+        std::cerr << "Temporary directory creation failed : " << e.what() << std::endl;
+        return 1;
+    }
+    const std::string tempPath = tempDirectory.string();
+    std::filesystem::create_directory(tempDirectory / "pixels");
+    std::filesystem::create_directory(tempDirectory / "features");
+    // The environments build the file paths in char[100] buffers
+    char pixelsPath[100];
+    std::snprintf(pixelsPath, sizeof(pixelsPath), "%s/pixels/", tempPath.c_str());
+    const std::string featuresPath = tempPath + "/features/";
+    if (featuresPath.size() > 80)
+    {
+        std::cerr << "Temporary directory path too long : " << tempPath << std::endl;
+        std::filesystem::remove_all(tempDirectory);
+        return 1;
+    }
+
+    std::vector<BenchmarkResult> results;
+    int status = 0;
+    try
+    {
+        // Balanced 32x32 CUs with their features (Cf. SyntheticDatabase)
+        SyntheticDatabase database(NB_SYNTHETIC_CUS, 32, 32, NB_FEATURES, std::vector<double>(6, 1.0), 0);
+        database.writePixelFiles(pixelsPath);
+        database.writeFeaturesFiles(featuresPath);
+        std::cout << NB_SYNTHETIC_CUS << " synthetic CUs generated in " << tempPath << std::endl << std::endl;
+
+        // ---------------- Environments, targets loaded from the synthetic dataset ----------------
+        Learn::LearningParameters params;
+        File::ParametersParser::loadParametersFromJson(ROOT_DIR "/params.json", params);
+        params.mutation.tpg.nbRoots = 100;
+
+        auto *pixelsEnv = new BinaryDefaultEnv({0, 1}, 0, NB_SYNTHETIC_CUS, NB_TARGETS, 1000, NB_TARGETS, 0);
+        pixelsEnv->setNbLoadingThreads(1);
+        pixelsEnv->UpdatingTargets(0, pixelsPath);
+        auto *featuresEnv = new BinaryFeaturesEnv({0}, {1, 2, 3, 4, 5}, 0, 32, 32, NB_FEATURES, NB_SYNTHETIC_CUS, NB_TARGETS, 1000, NB_TARGETS);
+        featuresEnv->setNbLoadingThreads(1);
+        featuresEnv->UpdateTargets(0, featuresPath);
+        // The next training targets are loaded in background : no loading thread during the measures
+        featuresEnv->waitForPrefetch();
+
+        // Reference TPG : initial random TPG of a fixed seed on the pixels environment
+        InstructionSetFactory instructions(InstructionSetFactory::getPixelsNames());
+        Learn::LearningAgent la(*pixelsEnv, instructions.getSet(), params);
+        la.init(0);
+        const TPG::TPGVertex* root = la.getTPGGraph().getRootVertices().front();
+        TPG::TPGExecutionEngine tee(la.getTPGGraph().getEnvironment());
+        const ConfusionMatrix& matrix = pixelsEnv->getConfusionMatrix(la.getTPGGraph().getEnvironment(), root);
+        const std::string statsFile = tempPath + "/classificationTable.txt";
+
+        // ---------------- Benchmarks ----------------
+        TargetStore<uint8_t> pixelsStore(32 * 32, 1);
+        TargetStore<FeatureType> featuresStore(NB_FEATURES + 1, 1);
+        Mutator::RNG loaderRng(0);
+        results.push_back(runBenchmark("getRandomCU (.bin)", minTime, 32 * 32 + 1, [&]() {
+            pixelsEnv->getRandomCU(loaderRng, pixelsStore, 0, pixelsPath);
+        }));
+        results.push_back(runBenchmark("getRandomCUFeaturesFromCSVFile", minTime, 0, [&]() {
+            featuresEnv->getRandomCUFeaturesFromCSVFile(loaderRng, featuresStore, 0, featuresPath);
+        }));
+        results.push_back(runBenchmark("LoadNextCU", minTime, 32 * 32, [&]() { pixelsEnv->LoadNextCU(); }));
+        results.push_back(runBenchmark("LoadNextCUFeatures", minTime, (NB_FEATURES + 1) * sizeof(FeatureType),
+                                       [&]() { featuresEnv->LoadNextCUFeatures(); }));
+        results.push_back(runBenchmark("clone (BinaryDefaultEnv)", minTime, 0, [&]() { delete pixelsEnv->clone(); }));
+        results.push_back(runBenchmark("clone (BinaryFeaturesEnv)", minTime, 0, [&]() { delete featuresEnv->clone(); }));
+        results.push_back(runBenchmark("executeFromRoot (pixels)", minTime, 32 * 32, [&]() {
+            pixelsEnv->LoadNextCU();
+            tee.executeFromRoot(*root);
+        }));
+        results.push_back(runBenchmark("printClassifStatsTable", minTime, 0, [&]() {
+            pixelsEnv->printClassifStatsTable(matrix, 0, statsFile, true);
+        }));
+
+        delete featuresEnv;
+        delete pixelsEnv;
+        if (!jsonFile.empty())
+        {
+            writeJson(results, jsonFile);
+            std::cout << std::endl << "Results written in " << jsonFile << std::endl;
+        }
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        status = 1;
+    }
+
+    std::filesystem::remove_all(tempDirectory);
+    return status;
+}
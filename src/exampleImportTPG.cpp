@@ -1,25 +1,8 @@
 
 // ----- La gestion des instructions du TPG -----
-// On crée le set d'instructions
-Instructions::Set set;
-// On crée les instructions, j'ai quasi toujours utilisé les mêmes, ça devrait pas changer
-auto minus_double = [](double a, double b) -> double { return a - b; };
-auto add_double = [](double a, double b) -> double { return a + b; };
-auto mult_double = [](double a, double b) -> double { return a * b; };
-auto div_double = [](double a, double b) -> double { return a / b; };
-auto max_double = [](double a, double b) -> double { return std::max(a, b); };
-auto ln_double = [](double a) -> double { return std::log(a); };
-auto exp_double = [](double a) -> double { return std::exp(a); };
-auto multByConst_double = [](double a, Data::Constant c) -> double { return a * (double) c; };
-// On ajoute les instructions au set
-set.add(*(new Instructions::LambdaInstruction<double, double>(minus_double)));
-set.add(*(new Instructions::LambdaInstruction<double, double>(add_double)));
-set.add(*(new Instructions::LambdaInstruction<double, double>(mult_double)));
-set.add(*(new Instructions::LambdaInstruction<double, double>(div_double)));
-set.add(*(new Instructions::LambdaInstruction<double, double>(max_double)));
-set.add(*(new Instructions::LambdaInstruction<double>(exp_double)));
-set.add(*(new Instructions::LambdaInstruction<double>(ln_double)));
-set.add(*(new Instructions::LambdaInstruction<double, Data::Constant>(multByConst_double)));
+// On crée le set d'instructions, le même que celui de l'entraînement (Cf. InstructionSetFactory)
+InstructionSetFactory instructions(InstructionSetFactory::getFeaturesNames());
+const Instructions::Set& set = instructions.getSet();
 
 // ----- On vient charger les paramètres du TPG depuis le params.json file -----
 // On crée l'objet qui va contenir les paramètres
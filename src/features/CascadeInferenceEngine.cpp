@@ -0,0 +1,141 @@
+#include <stdexcept>
+#include <utility>
+
+#include "../../include/features/CascadeInferenceEngine.h"
+
+// ********************************************************************* //
+// ************************** CASCADE TOPOLOGIES *********************** //
+// ********************************************************************* //
+
+CascadeTopology CascadeTopology::allBinaryParallel(const std::vector<bool>& availableSplits)
+{
+    const char* tpgNames[6] = {"NP", "QT", "BTH", "BTV", "TTH", "TTV"};
+
+    CascadeTopology topology;
+    for (uint64_t split = 0; split < 6; split++)
+    {
+        if (split != 0 && !availableSplits[split])
+            continue;
+        topology.entries.push_back(topology.nodes.size());
+        topology.nodes.push_back({tpgNames[split], {Branch::split(split), Branch::none()}});
+    }
+    return topology;
+}
+
+CascadeTopology CascadeTopology::directionWaterfall()
+{
+    // The TPG files are named after the first action 0 of their environment :
+    // the HORI TPG ({2}, {4}) is read from BTH.dot and the VERTI TPG ({3}, {5}) from BTV.dot
+    CascadeTopology topology;
+    topology.nodes = {
+            {"NP",  {Branch::split(0), Branch::node(1)}},   // 0: NP
+            {"QT",  {Branch::split(1), Branch::node(2)}},   // 1: QT
+            {"BTH", {Branch::node(3),  Branch::node(4)}},   // 2: DIREC ({2,4}, {3,5})
+            {"BTH", {Branch::split(2), Branch::split(4)}},  // 3: HORI
+            {"BTV", {Branch::split(3), Branch::split(5)}}   // 4: VERTI
+    };
+    topology.entries = {0};
+    return topology;
+}
+
+CascadeTopology CascadeTopology::linearWaterfall()
+{
+    CascadeTopology topology;
+    topology.nodes = {
+            {"NP",  {Branch::split(0), Branch::node(1)}},
+            {"QT",  {Branch::split(1), Branch::node(2)}},
+            {"BTH", {Branch::split(2), Branch::node(3)}},
+            {"BTV", {Branch::split(3), Branch::node(4)}},
+            {"TTH", {Branch::split(4), Branch::split(5)}}
+    };
+    topology.entries = {0};
+    return topology;
+}
+
+// ********************************************************************* //
+// ************************* INFERENCE ENGINE ************************** //
+// ********************************************************************* //
+
+CascadeInferenceEngine::CascadeInferenceEngine(TPGModelRegistry& registry, const Data::ArrayWrapper<FeatureType>& input,
+                                               const std::vector<FlatOpcode>& opcodes, CascadeTopology topology)
+        : topology(std::move(topology)),
+          registry(registry)
+{
+    // ---------------- Check the topology ----------------
+    if (this->topology.nodes.empty() || this->topology.entries.empty())
+        throw std::runtime_error("CascadeInferenceEngine: empty cascade");
+    for (uint64_t idx_node = 0; idx_node < this->topology.nodes.size(); idx_node++)
+        for (const CascadeTopology::Branch& branch : this->topology.nodes[idx_node].branches)
+            if ((branch.type == CascadeTopology::Branch::NODE && (branch.value <= idx_node || branch.value >= this->topology.nodes.size()))
+                || (branch.type == CascadeTopology::Branch::SPLIT && branch.value >= 6))
+                throw std::runtime_error("CascadeInferenceEngine: invalid branch in node " + std::to_string(idx_node));
+    for (uint64_t entry : this->topology.entries)
+        if (entry >= this->topology.nodes.size())
+            throw std::runtime_error("CascadeInferenceEngine: invalid entry node " + std::to_string(entry));
+
+    // ---------------- Get the TPGs (each one is imported and flattened once by the registry) ----------------
+    TPGInputLayout layout{(typeid(FeatureType) == typeid(float)) ? "float" : "double", typeid(FeatureType),
+                          input.getAddressSpace(typeid(FeatureType)), 1};
+    for (const CascadeTopology::Node& node : this->topology.nodes)
+        this->engines.push_back(&this->registry.getFlatEngine(node.tpgName, opcodes, layout));
+    this->programPool = &this->engines.front()->getProgramPool();
+}
+
+template <class ExecuteNode> uint8_t CascadeInferenceEngine::followCascade(ExecuteNode executeNode)
+{
+    uint8_t chosenSplits = 0;
+    for (uint64_t entry : this->topology.entries)
+    {
+        // Follow the branches until a split (or nothing) is reached
+        uint64_t idx_node = entry;
+        while (true)
+        {
+            uint64_t actionID = executeNode(*this->engines[idx_node]);
+            if (actionID > 1)
+                throw std::runtime_error("CascadeInferenceEngine: TPG " + this->topology.nodes[idx_node].tpgName + " is not binary");
+            const CascadeTopology::Branch& branch = this->topology.nodes[idx_node].branches[actionID];
+            if (branch.type == CascadeTopology::Branch::NODE)
+                idx_node = branch.value;
+            else
+            {
+                if (branch.type == CascadeTopology::Branch::SPLIT)
+                    chosenSplits |= (uint8_t) (1 << branch.value);
+                break;
+            }
+        }
+    }
+    return chosenSplits;
+}
+
+uint8_t CascadeInferenceEngine::evaluate(const std::vector<double>& cu)
+{
+    // New input epoch : every bid of the previous CU is outdated, the bids of this CU are shared by every TPG
+    this->programPool->setInput(cu.data());
+    return this->followCascade([](FlatTPGEngine& engine) { return engine.execute(); });
+}
+
+void CascadeInferenceEngine::evaluate(const std::vector<std::vector<double>*>& cus, std::vector<uint8_t>& chosenSplits)
+{
+    // Every program of the cascade is executed on batches of CUs (Cf. FlatProgramPool::setInputBatch()),
+    // then each CU of the batch follows its own path in the cascade
+    chosenSplits.resize(cus.size());
+    std::vector<const double*> batch;
+    for (size_t first = 0; first < cus.size(); first += FlatProgramPool::BATCH_SIZE)
+    {
+        batch.clear();
+        for (size_t idx_cu = first; idx_cu < cus.size() && batch.size() < FlatProgramPool::BATCH_SIZE; idx_cu++)
+            batch.push_back(cus[idx_cu]->data());
+        this->programPool->setInputBatch(batch);
+        for (size_t lane = 0; lane < batch.size(); lane++)
+            chosenSplits[first + lane] = this->followCascade([lane](FlatTPGEngine& engine) { return engine.executeLane(lane); });
+    }
+}
+
+void CascadeInferenceEngine::setDoublePrecision(bool enable)
+{
+    this->programPool->setDoublePrecision(enable);
+}
+
+const CascadeTopology& CascadeInferenceEngine::getTopology() const { return this->topology; }
+
+const FlatProgramPool& CascadeInferenceEngine::getProgramPool() const { return *this->programPool; }
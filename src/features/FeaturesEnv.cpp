@@ -61,13 +61,14 @@ bool FeaturesEnv::isTerminal() const
 // ********************************************************************* //
 
 // ****** TRAINING Arguments ******
-std::vector<Data::PrimitiveTypeArray<double> *> *FeaturesEnv::trainingTargetsCUFeatures = new std::vector<Data::PrimitiveTypeArray<double>*>;
-std::vector<uint8_t> *FeaturesEnv::trainingTargetsOptimalSplits = new std::vector<uint8_t>;
-// ****** VALIDATION Arguments ******
-std::vector<Data::PrimitiveTypeArray<double>*> *FeaturesEnv::validationTargetsCUFeatures = new std::vector<Data::PrimitiveTypeArray<double>*>;
-std::vector<uint8_t> *FeaturesEnv::validationTargetsOptimalSplits = new std::vector<uint8_t>;
 
-void FeaturesEnv::getRandomCUFeaturesFromOriginalCSVFile(Learn::LearningMode mode, const char current_CU_path[100])
+FeaturesEnv::~FeaturesEnv()
+{
+    // The prefetching thread uses this environment
+    this->nextTrainingTargets.prefetcher.stop(this);
+}
+
+void FeaturesEnv::getRandomCUFeaturesFromOriginalCSVFile(TargetStore<FeatureType>& targets, const char current_CU_path[100])
 {
     // ------------------ Opening and Reading a random CSV file ------------------
     // Generate the path for a random CSV file
@@ -110,44 +111,32 @@ void FeaturesEnv::getRandomCUFeaturesFromOriginalCSVFile(Learn::LearningMode mod
                 std::cout << " " << j;
             std::cout << std::endl;*/
 
-            // -------- Create and fill the container --------
-            // Create a new PrimitiveTypeArray<uint8_t> which will contain 1 CU features
-            auto *randomCU = new Data::PrimitiveTypeArray<double>(FeaturesEnv::CSV_FILE_WIDTH+1); // +1 for QP
-            // Fill it with QP Value and then every features
-            randomCU->setDataAt(typeid(double), 0, std::stod(row.at(1)));
-            for (uint32_t featuresIdx = 3; featuresIdx < FeaturesEnv::CSV_FILE_WIDTH+3; featuresIdx++)
-                randomCU->setDataAt(typeid(double), featuresIdx-2, std::stod(row.at(featuresIdx)));
-
-            // -------- Store the features array (currentState) and its split --------
+            // -------- Add a target (its split) in the given store --------
             // Deduce the optimal split from string
             //std::cout << "Nom du split  : \"" << row.at(2) << "\"" << std::endl;
             uint8_t optSplit = getSplitNumber(row.at(2));
-            // Store the CU features and the corresponding optimal split depending of the current mode
-            if (mode == Learn::LearningMode::TRAINING)
-            {
-                FeaturesEnv::trainingTargetsCUFeatures->push_back(randomCU);
-                FeaturesEnv::trainingTargetsOptimalSplits->push_back(optSplit);
-            }
-            else if (mode == Learn::LearningMode::VALIDATION)
-            {
-                FeaturesEnv::validationTargetsCUFeatures->push_back(randomCU);
-                FeaturesEnv::validationTargetsOptimalSplits->push_back(optSplit);
-            }
+            FeatureType* randomCU = targets.addTarget(optSplit);
+
+            // -------- Fill the row of the target --------
+            // Fill it with QP Value and then every features
+            randomCU[0] = (FeatureType) std::stod(row.at(1));
+            for (uint32_t featuresIdx = 3; featuresIdx < FeaturesEnv::CSV_FILE_WIDTH+3; featuresIdx++)
+                randomCU[featuresIdx-2] = (FeatureType) std::stod(row.at(featuresIdx));
         }
         i++;
     }
     file.close();
 }
 
-void FeaturesEnv::getRandomCUFeaturesFromSimpleCSVFile(Learn::LearningMode mode, const char current_CU_path[100])
+bool FeaturesEnv::getRandomCUFeaturesFromSimpleCSVFile(Mutator::RNG& loaderRng, TargetStore<FeatureType>& targets, uint64_t idx, const std::string& databasePath)
 {
     // ------------------ Opening and Reading a random CSV file ------------------
     // Generate the path for a random CSV file
-    uint32_t next_CU_number = this->rng.getInt32(0, NB_TRAINING_ELEMENTS - 1);
+    uint32_t next_CU_number = loaderRng.getInt32(0, NB_TRAINING_ELEMENTS - 1);
     char next_CU_number_string[100];
     std::sprintf(next_CU_number_string, "%d", next_CU_number);
     char CSV_path[100];
-    std::strcpy(CSV_path, current_CU_path);
+    std::strcpy(CSV_path, databasePath.c_str());
     char file_extension[10] = ".csv";
     std::strcat(CSV_path, next_CU_number_string);
     std::strcat(CSV_path, file_extension);
@@ -179,32 +168,73 @@ void FeaturesEnv::getRandomCUFeaturesFromSimpleCSVFile(Learn::LearningMode mode,
             std::cout << " " << j;
         std::cout << std::endl;*/
 
-        // -------- Create and fill the container --------
-        // Create a new PrimitiveTypeArray<uint8_t> which will contain 1 CU features
-        auto *randomCU = new Data::PrimitiveTypeArray<double>(FeaturesEnv::CSV_FILE_WIDTH+1); // +1 for QP
-        // Fill it with QP Value and then every features
-        randomCU->setDataAt(typeid(double), 0, std::stod(row.at(0)));
-        for (uint32_t featuresIdx = 2; featuresIdx < FeaturesEnv::CSV_FILE_WIDTH+2; featuresIdx++)
-            randomCU->setDataAt(typeid(double), featuresIdx-2, std::stod(row.at(featuresIdx)));
-
-        // -------- Store the features array (currentState) and its split --------
+        // -------- Add a target (its split) in the given store --------
         // Deduce the optimal split from string
         //std::cout << "Nom du split  : \"" << row.at(1) << "\"" << std::endl;
         uint8_t optSplit = getSplitNumber(row.at(1));
-        // Store the CU features and the corresponding optimal split depending of the current mode
-        if (mode == Learn::LearningMode::TRAINING)
-        {
-            FeaturesEnv::trainingTargetsCUFeatures->push_back(randomCU);
-            FeaturesEnv::trainingTargetsOptimalSplits->push_back(optSplit);
-        }
-        else if (mode == Learn::LearningMode::VALIDATION)
-        {
-            FeaturesEnv::validationTargetsCUFeatures->push_back(randomCU);
-            FeaturesEnv::validationTargetsOptimalSplits->push_back(optSplit);
-        }
+        FeatureType* randomCU = targets.setTarget(idx, optSplit);
+
+        // -------- Fill the row of the target --------
+        // Fill it with QP Value and then every features
+        randomCU[0] = (FeatureType) std::stod(row.at(0));
+        for (uint32_t featuresIdx = 2; featuresIdx < FeaturesEnv::CSV_FILE_WIDTH+2; featuresIdx++)
+            randomCU[featuresIdx-2] = (FeatureType) std::stod(row.at(featuresIdx));
+        // Last value is never written by the features (rows are reused : reset it as in a new array)
+        randomCU[FeaturesEnv::CSV_FILE_WIDTH] = 0.0;
 
     }
     file.close();
+    return !row.empty();
+}
+
+bool FeaturesEnv::getRandomCUFeaturesFromBinaryDatabase(Mutator::RNG& loaderRng, const FeaturesDatabase& database, TargetStore<FeatureType>& targets, uint64_t idx)
+{
+    // Same random draw as with getRandomCUFeaturesFromSimpleCSVFile()
+    uint32_t next_CU_number = loaderRng.getInt32(0, NB_TRAINING_ELEMENTS - 1);
+    // QP followed by every features
+    const double* values = database.getValues(next_CU_number);
+
+    // -------- Add a target (its split) in the given store and fill its row --------
+    // Same filling as getRandomCUFeaturesFromSimpleCSVFile() so that both database formats give the same targets
+    FeatureType* randomCU = targets.setTarget(idx, database.getSplit(next_CU_number));
+    randomCU[0] = (FeatureType) values[0];
+    for (uint32_t featuresIdx = 0; featuresIdx < FeaturesEnv::CSV_FILE_WIDTH; featuresIdx++)
+        randomCU[featuresIdx] = (FeatureType) values[featuresIdx+1];
+    randomCU[FeaturesEnv::CSV_FILE_WIDTH] = 0.0;
+    return true;
+}
+
+void FeaturesEnv::loadTargets(uint64_t stream, uint64_t nbTargets, TargetStore<FeatureType>& targets, const std::string& databasePath,
+                              const std::atomic<bool>* stopRequested)
+{
+    const FeaturesDatabase* database = nullptr;
+    if (FeaturesDatabase::isFeaturesDatabase(databasePath))
+    {
+        database = &FeaturesDatabase::getShared(databasePath);
+        if (database->getNbFeatures() != FeaturesEnv::CSV_FILE_WIDTH)
+            throw std::runtime_error("Features database " + database->getPath() + " does not contain " + std::to_string(FeaturesEnv::CSV_FILE_WIDTH) + " features per CU");
+    }
+
+    targets.resize(nbTargets);
+    std::vector<uint64_t> failed = ParallelTargetsLoader::run(nbTargets, this->nbLoadingThreads, [&](uint64_t idx) {
+        // Each target has its own RNG : same targets whatever the number of threads
+        Mutator::RNG loaderRng(ParallelTargetsLoader::getSubstreamSeed(this->seed, stream, idx));
+        if (database)
+            return this->getRandomCUFeaturesFromBinaryDatabase(loaderRng, *database, targets, idx);
+        return this->getRandomCUFeaturesFromSimpleCSVFile(loaderRng, targets, idx, databasePath);
+    }, stopRequested);
+    targets.removeTargets(failed);
+    PhaseTimers::countLoadedCUs(nbTargets - failed.size(), (nbTargets - failed.size()) * targets.getRowSize() * sizeof(FeatureType));
+    // The environments loop on the loaded targets only : an empty store can't be used
+    if (targets.size() == 0 && nbTargets != 0 && !(stopRequested && *stopRequested))
+        throw std::runtime_error("No target could be loaded from " + databasePath);
+}
+
+void FeaturesEnv::prefetchNextTrainingTargets(uint64_t nextGen, const std::string& databasePath)
+{
+    this->nextTrainingTargets.prefetcher.start(this, [this, nextGen, databasePath](const std::atomic<bool>& stopRequested) {
+        this->loadTargets(nextGen, NB_TRAINING_TARGETS, *this->nextTrainingTargets.store, databasePath, &stopRequested);
+    });
 }
 
 void FeaturesEnv::UpdatingTargets(uint64_t currentGen, const char current_CU_path[100])
@@ -212,89 +242,94 @@ void FeaturesEnv::UpdatingTargets(uint64_t currentGen, const char current_CU_pat
     // Each ${nbGeneTargetChange} generation, generate new random training targets so that different targets are used
     if (currentGen % NB_GENERATION_BEFORE_TARGETS_CHANGE == 0)
     {
-        // ---  Deleting old targets ---
         if (currentGen != 0) // Don't clear trainingTargets before initializing them
         {
+            if (!this->nextTrainingTargets.store)
+                throw std::runtime_error("FeaturesEnv::UpdateTargets: the targets of generation 0 were not loaded");
+
+            // ---  Waiting for the next targets (loaded in background since the previous change) ---
+            this->nextTrainingTargets.prefetcher.wait();
+
+            // ---  Publishing the next targets, old targets rows are refilled by the next prefetch unless a clone still uses them ---
+            TargetSnapshot<FeatureType> retiredTargets = std::move(this->trainingTargets);
+            this->trainingTargets = std::move(this->nextTrainingTargets.store);
+            this->nextTrainingTargets.store = TargetStore<FeatureType>::recycle(std::move(retiredTargets), CSV_FILE_WIDTH + 1);
+
+            // Only now : reset() wraps the first new target in currentCU, no pointer on the recycled rows remains
+            this->actualTrainingCU = 0;
             this->reset(0, Learn::LearningMode::TRAINING);
-            for (uint64_t idx_targ = 0; idx_targ < NB_TRAINING_TARGETS; idx_targ++)
-                delete FeaturesEnv::trainingTargetsCUFeatures->at(idx_targ);   // targets are allocated in getRandomCUFeaturesFromSimpleCSVFile()
-            FeaturesEnv::trainingTargetsCUFeatures->clear();
-            FeaturesEnv::trainingTargetsOptimalSplits->clear();
             this->actualTrainingCU = 0;
         }
-        else        // Load VALIDATION Targets at the beginning of the training (i == 0)
+        else        // Load VALIDATION Targets and the first TRAINING Targets at the beginning of the training (i == 0)
         {
-            for (uint64_t idx_targ = 0; idx_targ < NB_VALIDATION_TARGETS; idx_targ++)
-                this->getRandomCUFeaturesFromSimpleCSVFile(Learn::LearningMode::VALIDATION, current_CU_path);
+            auto validationStore = std::make_shared<TargetStore<FeatureType>>(CSV_FILE_WIDTH + 1);
+            this->loadTargets(ParallelTargetsLoader::VALIDATION_STREAM, NB_VALIDATION_TARGETS, *validationStore, current_CU_path);
+            this->validationTargets = validationStore;
+            this->confusionMatrixCache.clear();
+            auto trainingStore = std::make_shared<TargetStore<FeatureType>>(CSV_FILE_WIDTH + 1);
+            this->loadTargets(currentGen, NB_TRAINING_TARGETS, *trainingStore, current_CU_path);
+            this->trainingTargets = trainingStore;
+
+            // A previous training of this environment may still be filling its next targets
+            this->nextTrainingTargets.prefetcher.stop(this);
+            this->nextTrainingTargets.store = std::make_shared<TargetStore<FeatureType>>(CSV_FILE_WIDTH + 1);
         }
 
-        // ---  Loading next targets ---
-        for (uint64_t idx_targ = 0; idx_targ < NB_TRAINING_TARGETS; idx_targ++)
-            this->getRandomCUFeaturesFromSimpleCSVFile(Learn::LearningMode::TRAINING, current_CU_path);
+        // ---  Loading next targets in background while training ---
+        this->prefetchNextTrainingTargets(currentGen + NB_GENERATION_BEFORE_TARGETS_CHANGE, current_CU_path);
     }
 }
 
+void FeaturesEnv::setNbLoadingThreads(size_t nbThreads)
+{
+    this->nbLoadingThreads = nbThreads;
+}
+
 void FeaturesEnv::LoadNextCUFeatures()
 {
     if (this->currentMode == Learn::LearningMode::TRAINING)
     {
-        this->currentState = *FeaturesEnv::trainingTargetsCUFeatures->at(this->actualTrainingCU);
-        this->currentClass = FeaturesEnv::trainingTargetsOptimalSplits->at(this->actualTrainingCU);
+        this->currentState.setPointer(this->trainingTargets->getTarget(this->actualTrainingCU));
+        this->currentClass = this->trainingTargets->getLabel(this->actualTrainingCU);
         this->actualTrainingCU++;
 
         // Looping on the beginning of training targets
-        if (this->actualTrainingCU >= NB_TRAINING_TARGETS)
+        if (this->actualTrainingCU >= this->trainingTargets->size())
             this->actualTrainingCU = 0;
     }
     else if (this->currentMode == Learn::LearningMode::VALIDATION)
     {
-        this->currentState = *FeaturesEnv::validationTargetsCUFeatures->at(this->actualValidationCU);
-        this->currentClass = FeaturesEnv::validationTargetsOptimalSplits->at(this->actualValidationCU);
+        this->currentState.setPointer(this->validationTargets->getTarget(this->actualValidationCU));
+        this->currentClass = this->validationTargets->getLabel(this->actualValidationCU);
         this->actualValidationCU++;
 
         // Looping on the beginning of validation targets
-        if (this->actualValidationCU >= NB_VALIDATION_TARGETS)
+        if (this->actualValidationCU >= this->validationTargets->size())
             this->actualValidationCU = 0;
     }
 }
 
-void FeaturesEnv::printClassifStatsTable(const Environment& env, const TPG::TPGVertex* bestRoot, const int numGen, std::string const& outputFile, bool readable)
+const ConfusionMatrix& FeaturesEnv::getConfusionMatrix(const Environment& env, const TPG::TPGVertex* root)
 {
-    // Create a new TPGExecutionEngine from the environment
-    TPG::TPGExecutionEngine tee(env, nullptr);
-
-    // Change the LearningMode in VALIDATION
-    this->reset(0, Learn::LearningMode::VALIDATION);
+    // Unchanged root since the last call : same matrix
+    return this->confusionMatrixCache.get(root, [&]() {
+        // Fill the table : the validation targets are split between nbLoadingThreads clones of this environment
+        return ConfusionMatrix(ParallelValidation::run(*this, env, *root, this->validationTargets->size(), 6, this->nbLoadingThreads,
+                [](Learn::LearningEnvironment& le, uint64_t idx) {
+                    // Load the validation target idx in the clone and get answer
+                    auto& clone = (FeaturesEnv&) le;
+                    clone.actualValidationCU = idx;
+                    clone.LoadNextCUFeatures();
+                    return (uint64_t) clone.currentClass;
+                }));
+    });
+}
 
-    // Fill the table
+void FeaturesEnv::printClassifStatsTable(const ConfusionMatrix& matrix, const int numGen, std::string const& outputFile, bool readable)
+{
     const int nbClasses = 6;
-
-    uint64_t classifTable[nbClasses][nbClasses] = {{0}};
-    uint64_t nbPerClass[nbClasses] = {0};
-    uint8_t actionID;
-
-    for (uint64_t nbImage = 0; nbImage < this->NB_VALIDATION_TARGETS; nbImage++)
-    {
-        // Get answer
-        uint64_t optimalActionID = this->currentClass;
-        nbPerClass[optimalActionID]++;
-
-        // std::cout << optimalActionID << " : " << nbPerClass[optimalActionID] << std::endl;
-
-        // Execute
-        auto path = tee.executeFromRoot(*bestRoot);
-        const auto *action = (const TPG::TPGAction *) path.at(path.size() - 1);
-        actionID = (uint8_t) action->getActionID();
-
-        // Increment table
-        classifTable[optimalActionID][actionID]++;
-
-        // Do action in order to trigger image update and load the next CU
-        this->LoadNextCUFeatures();
-    }
-
-    // Reset the learning mode to TESTING
-    this->reset(0, Learn::LearningMode::TESTING);
+    const std::vector<std::vector<uint64_t>>& classifTable = matrix.getTable();
+    std::vector<uint64_t> nbPerClass = matrix.getNbPerClass();
 
     // Computing Score and ScoreMax
     double validationScore = 0.0;
@@ -369,7 +404,7 @@ void FeaturesEnv::printClassifStatsTable(const Environment& env, const TPG::TPGV
                 file << std::setw(colWidth) << "Total";
                 for(unsigned long nb : nbPerClass)
                     file << std::setw(colWidth) << nb;
-                file << std::setw(colWidth) << this->NB_VALIDATION_TARGETS << std::endl << std::endl;
+                file << std::setw(colWidth) << this->validationTargets->size() << std::endl << std::endl;
 
                 file << std::setw(colWidth) << "Gen" << std::setw(colWidth) << "NS"
                      << std::setw(colWidth) << "QT"  << std::setw(colWidth) << "BTH"
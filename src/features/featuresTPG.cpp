@@ -6,6 +6,8 @@
 #include <gegelati.h>
 
 #include "../../include/features/FeaturesEnv.h"
+#include "../../include/inference/TPGBinaryExporter.h"
+#include "../../include/instructions/InstructionSetFactory.h"
 
 int main(int argc, char* argv[])
 {
@@ -13,39 +15,9 @@ int main(int argc, char* argv[])
 
     // ************************************************** INSTRUCTIONS *************************************************
 
-    // Create the instruction set for programs
-    Instructions::Set set;
-
-    // double instructions (for TPG programs)
-    auto minus_double = [](double a, double b)->double {return a - b; };
-    auto add_double   = [](double a, double b)->double {return a + b; };
-    auto mult_double  = [](double a, double b)->double {return a * b; };
-    auto div_double   = [](double a, double b)->double {return a / b; };
-    auto max_double   = [](double a, double b)->double {return std::max(a, b); };
-    auto ln_double    = [](double a)->double {return std::log(a); };
-    auto exp_double   = [](double a)->double {return std::exp(a); };
-    auto multByConst_double = [](double a, Data::Constant c)->double {return a * (double)c; };
-    auto conv2D_double = [](const Data::Constant coeff[9], const double data[3][3])->double {
-        double res = 0.0;
-        for (int i = 0; i < 3; i++) {
-            for (int j = 0; j < 3; j++) {
-                res += (double)coeff[i * 3 + j] * data[i][j];
-            }
-        }
-        return res;
-    };
-
-    // Add those instructions to instruction set
-    set.add(*(new Instructions::LambdaInstruction<double, double>(minus_double)));
-    set.add(*(new Instructions::LambdaInstruction<double, double>(add_double)));
-    set.add(*(new Instructions::LambdaInstruction<double, double>(mult_double)));
-    set.add(*(new Instructions::LambdaInstruction<double, double>(div_double)));
-    set.add(*(new Instructions::LambdaInstruction<double, double>(max_double)));
-    set.add(*(new Instructions::LambdaInstruction<double>(exp_double)));
-    set.add(*(new Instructions::LambdaInstruction<double>(ln_double)));
-    set.add(*(new Instructions::LambdaInstruction<double, Data::Constant>(multByConst_double)));
-    set.add(*(new Instructions::LambdaInstruction<const Data::Constant[9], const double[3][3]>(conv2D_double)));
-
+    // Create the instruction set for programs (Cf. InstructionSetFactory)
+    // Double instructions and conv2D (float instructions for the features in a FEATURES_FLOAT build)
+    InstructionSetFactory instructions(InstructionSetFactory::getClassificationFeaturesNames());
 
     // ******************************************* PARAMETERS AND ENVIRONMENT ******************************************
 
@@ -79,11 +51,12 @@ int main(int argc, char* argv[])
     // ---------------- Instantiate Environment and Agent ----------------
     // LearningEnvironment
     auto *LE = new FeaturesEnv({0, 1, 2, 3, 4, 5}, nbTrainingElements, nbTrainingTargets, nbGeneTargetChange, nbValidationTarget, (size_t) seed);
+    LE->setNbLoadingThreads(params.nbThreads);
     // Creating a second environment used to compute the classification table
-    Environment env(set, LE->getDataSources(), params.nbRegisters, params.nbProgramConstant);
+    Environment env(instructions.getSet(), LE->getDataSources(), params.nbRegisters, params.nbProgramConstant);
 
     // Instantiate and Init the Learning Agent (non-parallel : LearningAgent / parallel ParallelLearningAgent)
-    Learn::ParallelLearningAgent la(*LE, set, params);
+    Learn::ParallelLearningAgent la(*LE, instructions.getSet(), params);
     la.init();
 
     // ---------------- Initialising paths ----------------
@@ -91,6 +64,7 @@ int main(int argc, char* argv[])
     //const char parametersPrintPath[100] = "/home/cleonard/dev/TpgVvcPartDatabase/build/jsonParams.json";
     std::string const fileClassificationTableName("/home/cleonard/dev/TpgVvcPartDatabase/fileClassificationTable.txt");
     std::string const fullConfusionMatrixName("/home/cleonard/dev/TpgVvcPartDatabase/fullClassifTable.txt");
+    std::string const memoryUsageName("/home/cleonard/dev/TpgVvcPartDatabase/memoryUsage.csv");
 
     // ---------------- Printing training overview  ----------------
     std::cout << "This TPG uses CU features and has 6 actions" << std::endl << std::endl;
@@ -117,6 +91,14 @@ int main(int argc, char* argv[])
     stats.open("bestPolicyStats.md");
     Log::LAPolicyStatsLogger policyStatsLogger(la, stats);
 
+    // Time spent in each phase of the generations, one line per generation (Cf. PhaseTimers)
+    PhaseTimers phaseTimers("phaseTimings.csv");
+    PhaseTimersLogger phaseTimersLogger(la, phaseTimers);
+#ifdef MEMORY_TRACKING
+    // Memory of each phase, next to the classification tables (Cf. MemoryTracker)
+    phaseTimers.enableMemoryReport(memoryUsageName);
+#endif
+
 
     // *********************************************** MAIN TRAINING LOOP **********************************************
 
@@ -126,21 +108,31 @@ int main(int argc, char* argv[])
     for (uint64_t i = 0; i < params.nbGenerations; i++)
     {
         // Update Training and Validation targets depending on the generation
-        LE->UpdatingTargets(i, datasetPath);
+        {
+            PhaseTimers::Scope scope(phaseTimers, PhaseTimers::TARGETS);
+            LE->UpdatingTargets(i, datasetPath);
+        }
 
         // Save best generation policy
-        char buff[20];
-        sprintf(buff, "out_%" PRIu64 ".dot", i);
-        dotExporter.setNewFilePath(buff);
-        dotExporter.print();
+        {
+            PhaseTimers::Scope scope(phaseTimers, PhaseTimers::FILES);
+            char buff[20];
+            sprintf(buff, "out_%" PRIu64 ".dot", i);
+            dotExporter.setNewFilePath(buff);
+            dotExporter.print();
+        }
 
         // Train
         la.trainOneGeneration(i);
 
         // Print Classification Table
         const TPG::TPGVertex* bestRoot = la.getBestRoot().first;
-        LE->printClassifStatsTable(env, bestRoot, (int) i, fileClassificationTableName, false);
-        LE->printClassifStatsTable(env, bestRoot, (int) i, fullConfusionMatrixName, true);
+        phaseTimers.start(PhaseTimers::VALIDATION);
+        const ConfusionMatrix& bestRootMatrix = LE->getConfusionMatrix(env, bestRoot);   // Both reports are written from one evaluation
+        phaseTimers.start(PhaseTimers::FILES);
+        LE->printClassifStatsTable(bestRootMatrix, (int) i, fileClassificationTableName, false);
+        LE->printClassifStatsTable(bestRootMatrix, (int) i, fullConfusionMatrixName, true);
+        phaseTimers.writeGeneration(i);
     }
 
     // ************************************************** TRAINING END *************************************************
@@ -148,6 +140,11 @@ int main(int argc, char* argv[])
     la.keepBestPolicy();
     dotExporter.setNewFilePath("out_best.dot");
     dotExporter.print();
+    // Compact binary export of the best policy, loaded by the inference programs (Cf. TPGModelRegistry)
+    TPGBinaryExporter binaryExporter("out_best.tpgb", la.getTPGGraph());
+    binaryExporter.print(la.getBestRoot().first);
+    // Names of the instructions, checked when the TPGs are imported
+    instructions.writeSignature("");
     // Store stats
     TPG::PolicyStats ps;
     ps.setEnvironment(la.getTPGGraph().getEnvironment());
@@ -161,8 +158,6 @@ int main(int argc, char* argv[])
     stats.close();
 
     // cleanup
-    for (unsigned int i = 0; i < set.getNbInstructions(); i++)
-        delete (&set.getInstruction(i));
     delete LE;
 
     return 0;
@@ -6,26 +6,30 @@
 #include <gegelati.h>
 
 #include "../../include/features/BinaryFeaturesEnv.h"
+#include "../../include/features/CascadeInferenceEngine.h"
+#include "../../include/instructions/InstructionSetFactory.h"
 
-void importTPG(BinaryFeaturesEnv* le, Environment& env, TPG::TPGGraph& tpg);
-Data::PrimitiveTypeArray<double>* getRandomCUFeatures(std::string& datasetPath, BinaryFeaturesEnv* le, std::vector<uint8_t>* splitList);
+std::vector<double>* getRandomCUFeatures(std::string& datasetPath, BinaryFeaturesEnv* le, std::vector<uint8_t>* splitList);
+
+uint64_t countChangedDecisions(CascadeInferenceEngine& cascade, const std::vector<std::vector<double>*>& cus,
+                               const std::vector<uint8_t>& cascadeSplits);
 
 void ParseAvailableSplitsInVector(std::vector<bool>& actions, std::string str);
 
 void EvaluateAllBinaryParallelFull(size_t seed, uint64_t cuHeight, uint64_t cuWidth, uint64_t nbFeatures,
                                     uint64_t nbDatabaseElements, uint64_t nbTrainingTargets,
                                     uint64_t nbGeneTargetChange, uint64_t nbValidationTarget,
-                                    const Instructions::Set& set, Learn::LearningParameters params, std::string datasetPath,
+                                    const InstructionSetFactory& instructions, Learn::LearningParameters params, std::string datasetPath,
                                     int nbEval, bool debug, std::vector<bool> availableSplits);
 void EvaluateDirectionWaterfallSink(size_t seed, uint64_t cuHeight, uint64_t cuWidth, uint64_t nbFeatures,
                                   uint64_t nbDatabaseElements, uint64_t nbTrainingTargets,
                                   uint64_t nbGeneTargetChange, uint64_t nbValidationTarget,
-                                  const Instructions::Set& set, Learn::LearningParameters params, std::string datasetPath,
+                                  const InstructionSetFactory& instructions, Learn::LearningParameters params, std::string datasetPath,
                                   int nbEval, bool debug, std::vector<bool> availableSplits);
 void EvaluateLinearWaterfallSink(size_t seed, uint64_t cuHeight, uint64_t cuWidth, uint64_t nbFeatures,
                                   uint64_t nbDatabaseElements, uint64_t nbTrainingTargets,
                                   uint64_t nbGeneTargetChange, uint64_t nbValidationTarget,
-                                  const Instructions::Set& set, Learn::LearningParameters params, std::string datasetPath,
+                                  const InstructionSetFactory& instructions, Learn::LearningParameters params, std::string datasetPath,
                                   int nbEval, bool debug, std::vector<bool> availableSplits);
 
 int main(int argc, char* argv[])
@@ -93,28 +97,9 @@ int main(int argc, char* argv[])
     std::cout << datasetPath << std::endl;
 
     // ************************************************** INSTRUCTIONS *************************************************
-    // Create the instruction set for programs
-    Instructions::Set set;
-
-    // double instructions
-    auto minus_double = [](double a, double b) -> double { return a - b; };
-    auto add_double = [](double a, double b) -> double { return a + b; };
-    auto mult_double = [](double a, double b) -> double { return a * b; };
-    auto div_double = [](double a, double b) -> double { return a / b; };
-    auto max_double = [](double a, double b) -> double { return std::max(a, b); };
-    auto ln_double = [](double a) -> double { return std::log(a); };
-    auto exp_double = [](double a) -> double { return std::exp(a); };
-    auto multByConst_double = [](double a, Data::Constant c) -> double { return a * (double) c; };
-
-    // Add those instructions to instruction set
-    set.add(*(new Instructions::LambdaInstruction<double, double>(minus_double)));
-    set.add(*(new Instructions::LambdaInstruction<double, double>(add_double)));
-    set.add(*(new Instructions::LambdaInstruction<double, double>(mult_double)));
-    set.add(*(new Instructions::LambdaInstruction<double, double>(div_double)));
-    set.add(*(new Instructions::LambdaInstruction<double, double>(max_double)));
-    set.add(*(new Instructions::LambdaInstruction<double>(exp_double)));
-    set.add(*(new Instructions::LambdaInstruction<double>(ln_double)));
-    set.add(*(new Instructions::LambdaInstruction<double, Data::Constant>(multByConst_double)));
+    // Create the instruction set for programs : the set of the training, in the same order (Cf. InstructionSetFactory)
+    InstructionSetFactory instructions(InstructionSetFactory::getFeaturesNames());
+    instructions.checkSignature(ROOT_DIR "/TPG/");
 
     // ******************************************* PARAMETERS AND ENVIRONMENT ******************************************
     // ---------------- Load and initialize parameters from .json file ----------------
@@ -126,14 +111,14 @@ int main(int argc, char* argv[])
     EvaluateAllBinaryParallelFull(seed, cuHeight, cuWidth, nbFeatures,
                                                 nbDatabaseElements, nbTrainingTargets,
                                                 nbGeneTargetChange, nbValidationTarget,
-                                                set, params, datasetPath, nbEval, debug, availableSplits);
+                                                instructions, params, datasetPath, nbEval, debug, availableSplits);
     return 0;
 }
 
 void EvaluateAllBinaryParallelFull(size_t seed, uint64_t cuHeight, uint64_t cuWidth, uint64_t nbFeatures,
                                     uint64_t nbDatabaseElements, uint64_t nbTrainingTargets,
                                     uint64_t nbGeneTargetChange, uint64_t nbValidationTarget,
-                                    const Instructions::Set& set, Learn::LearningParameters params, std::string datasetPath,
+                                    const InstructionSetFactory& instructions, Learn::LearningParameters params, std::string datasetPath,
                                     int nbEval, bool debug, std::vector<bool> availableSplits)
 {
     // ********************* ONLY FOR INDEPENDANT BINARIES (CASCADE-FULL) *********************
@@ -145,71 +130,21 @@ void EvaluateAllBinaryParallelFull(size_t seed, uint64_t cuHeight, uint64_t cuWi
     double moyenneScore = 0.0;
     double moyenneNbSplit = 0.0;
 
+    // ************************************************** INSTANCES *************************************************
+    // ---------------- Import the cascade of binary TPGs once for every evaluation (flattened policies read the CU features directly) ----------------
+    Data::ArrayWrapper<FeatureType> input(nbFeatures + 1, nullptr); // +1 for QP
+    TPGModelRegistry registry(instructions.getSet(), {input}, params.nbRegisters, params.nbProgramConstant, ROOT_DIR "/TPG/");
+    CascadeInferenceEngine cascade(registry, input, instructions.getOpcodes(),
+                                   CascadeTopology::allBinaryParallel(availableSplits));
+
+    // LearningEnvironment used to draw the CUs (Cf. getRandomCUFeatures())
+    auto *leNP = new BinaryFeaturesEnv({0}, {1,2,3,4,5}, seed, cuHeight, cuWidth, nbFeatures,
+                                       nbDatabaseElements, nbTrainingTargets, nbGeneTargetChange, nbValidationTarget);
+
     for(int i = 0; i < nbEval; i++)
     {
-        // ************************************************** INSTANCES *************************************************
-
-        // ---------------- Instantiate 6 LearningEnvironments, 6 Environments, 6 TPGGraphs and 6 TPGExecutionEngines ----------------
-        auto *leNP  = new BinaryFeaturesEnv({0}, {1,2,3,4,5}, seed, cuHeight, cuWidth, nbFeatures,
-                                                nbDatabaseElements, nbTrainingTargets, nbGeneTargetChange, nbValidationTarget);
-        auto *leQT  = new BinaryFeaturesEnv({1}, {0,2,3,4,5}, seed, cuHeight, cuWidth, nbFeatures,
-                                                nbDatabaseElements, nbTrainingTargets, nbGeneTargetChange, nbValidationTarget);
-        auto *leBTH = new BinaryFeaturesEnv({2}, {0,1,3,4,5}, seed, cuHeight, cuWidth, nbFeatures,
-                                                nbDatabaseElements, nbTrainingTargets, nbGeneTargetChange, nbValidationTarget);
-        auto *leBTV = new BinaryFeaturesEnv({3}, {0,1,2,4,5}, seed, cuHeight, cuWidth, nbFeatures,
-                                            nbDatabaseElements, nbTrainingTargets, nbGeneTargetChange, nbValidationTarget);
-        auto *leTTH = new BinaryFeaturesEnv({4}, {0,1,2,3,5}, seed, cuHeight, cuWidth, nbFeatures,
-                                            nbDatabaseElements, nbTrainingTargets, nbGeneTargetChange, nbValidationTarget);
-        auto *leTTV = new BinaryFeaturesEnv({5}, {0,1,2,3,4}, seed, cuHeight, cuWidth, nbFeatures,
-                                            nbDatabaseElements, nbTrainingTargets, nbGeneTargetChange, nbValidationTarget);
-
-        // Instantiate the environment that will embed the LearningEnvironment
-        Environment envNP (set, leNP->getDataSources(), params.nbRegisters, params.nbProgramConstant);
-        Environment envQT (set, leQT->getDataSources(), params.nbRegisters, params.nbProgramConstant);
-        Environment envBTH(set, leBTH->getDataSources(), params.nbRegisters, params.nbProgramConstant);
-        Environment envBTV(set, leBTV->getDataSources(), params.nbRegisters, params.nbProgramConstant);
-        Environment envTTH(set, leTTH->getDataSources(), params.nbRegisters, params.nbProgramConstant);
-        Environment envTTV(set, leTTV->getDataSources(), params.nbRegisters, params.nbProgramConstant);
-
-        // Instantiate the TPGGraph that we will load
-        auto tpgNP  = TPG::TPGGraph(envNP);
-        auto tpgQT  = TPG::TPGGraph(envQT);
-        auto tpgBTH = TPG::TPGGraph(envBTH);
-        auto tpgBTV = TPG::TPGGraph(envBTV);
-        auto tpgTTH = TPG::TPGGraph(envTTH);
-        auto tpgTTV = TPG::TPGGraph(envTTV);
-
-        // Instantiate the tee that will handle the decisions taken by the TPG
-        TPG::TPGExecutionEngine teeNP(envNP);
-        TPG::TPGExecutionEngine teeQT(envQT);
-        TPG::TPGExecutionEngine teeBTH(envBTH);
-        TPG::TPGExecutionEngine teeBTV(envBTV);
-        TPG::TPGExecutionEngine teeTTH(envTTH);
-        TPG::TPGExecutionEngine teeTTV(envTTV);
-
-        // ---------------- Import TPG graph from .dot file ----------------
-        importTPG(leNP,  envNP, tpgNP);
-        if(availableSplits[1])
-            importTPG(leQT,  envQT, tpgQT);
-        if(availableSplits[2])
-            importTPG(leBTH, envBTH, tpgBTH);
-        if(availableSplits[3])
-            importTPG(leBTV, envBTV, tpgBTV);
-        if(availableSplits[4])
-            importTPG(leTTH, envTTH, tpgTTH);
-        if(availableSplits[5])
-            importTPG(leTTV, envTTV, tpgTTV);
-
-        // ---------------- Get root from TPG ----------------
-        auto rootNP = tpgNP.getRootVertices().front();
-        auto rootQT  = availableSplits[1] ? tpgQT.getRootVertices().front()  : nullptr;
-        auto rootBTH = availableSplits[2] ? tpgBTH.getRootVertices().front() : nullptr;
-        auto rootBTV = availableSplits[3] ? tpgBTV.getRootVertices().front() : nullptr;
-        auto rootTTH = availableSplits[4] ? tpgTTH.getRootVertices().front() : nullptr;
-        auto rootTTV = availableSplits[5] ? tpgTTV.getRootVertices().front() : nullptr;
-
         // ************************************************* LOAD DATA *************************************************
-        auto *dataHandler = new std::vector<Data::PrimitiveTypeArray<double> *>;
+        auto *dataHandler = new std::vector<std::vector<double> *>;   // Read by the flattened TPGs of the cascade
         auto *splitList   = new std::vector<uint8_t>;
         auto *CUchosen    = new std::vector<int>{0,0,0,0,0,0};
         auto *CUset       = new std::vector<int>{0,0,0,0,0,0};
@@ -218,71 +153,31 @@ void EvaluateAllBinaryParallelFull(size_t seed, uint64_t cuHeight, uint64_t cuWi
         // -------------------------- Load a global vector of 1.000 CUs --------------------------
         for (uint64_t idx_targ = 0; idx_targ < nbValidationTarget; idx_targ++)
         {
-            Data::PrimitiveTypeArray<double> *target = getRandomCUFeatures(datasetPath, leNP, splitList);
+            std::vector<double> *target = getRandomCUFeatures(datasetPath, leNP, splitList);
             dataHandler->push_back(target);
             // Optimal split is stored in splitList inside getRandomCU()
         }
 
         // ************************************************** MAIN RUN *************************************************
         uint64_t score = 0;
-        int actionID;
         auto *chosenSplits = new std::vector<int>;
         auto *howManySplitsChosen = new std::vector<int>{0,0,0,0,0,0,0};
 
+        // Every TPG is executed on every CU in a single call
+        std::vector<uint8_t> cascadeSplits;
+        cascade.evaluate(*dataHandler, cascadeSplits);
+#ifdef FEATURES_FLOAT
+        uint64_t nbChangedDecisions = countChangedDecisions(cascade, *dataHandler, cascadeSplits);
+#endif
+
         for (uint64_t nbCU = 0; nbCU < nbValidationTarget; nbCU++)
         {
-            // Reset chosen splits vector
+            // Chosen splits of this CU
             chosenSplits->clear();
+            for (int split = 0; split < 6; split++)
+                if (cascadeSplits[nbCU] & (1 << split))
+                    chosenSplits->push_back(split);
 
-            // Load next CU for all TPGs
-            leNP->setCurrentState(*dataHandler->at(nbCU));
-            leQT->setCurrentState(*dataHandler->at(nbCU));
-            leBTH->setCurrentState(*dataHandler->at(nbCU));
-            leBTV->setCurrentState(*dataHandler->at(nbCU));
-            leTTH->setCurrentState(*dataHandler->at(nbCU));
-            leTTV->setCurrentState(*dataHandler->at(nbCU));
-
-            // Call NP
-            actionID = (int) ((const TPG::TPGAction *) teeNP.executeFromRoot(* rootNP).back())->getActionID();
-            if(actionID == 0)
-                chosenSplits->push_back(0); //leNP->getActions0().at(0);
-
-            // Call QT
-            if(availableSplits[1])
-            {
-                actionID = (int) ((const TPG::TPGAction *) teeQT.executeFromRoot(* rootQT).back())->getActionID();
-                if(actionID == 0)
-                    chosenSplits->push_back(1); //leQT->getActions0().at(0);
-            }
-
-            // Call BTH
-            if(availableSplits[2])
-            {
-                actionID = (int) ((const TPG::TPGAction *) teeBTH.executeFromRoot(*rootBTH).back())->getActionID();
-                if (actionID == 0)
-                    chosenSplits->push_back(2); //leBTH->getActions0().at(0);
-            }
-            // Call BTV
-            if(availableSplits[3])
-            {
-                actionID = (int) ((const TPG::TPGAction *) teeBTV.executeFromRoot(*rootBTV).back())->getActionID();
-                if (actionID == 0)
-                    chosenSplits->push_back(3); //leBTV->getActions0().at(0);
-            }
-            // Call TTH
-            if(availableSplits[4])
-            {
-                actionID = (int) ((const TPG::TPGAction *) teeTTH.executeFromRoot(* rootTTH).back())->getActionID();
-                if(actionID == 0)
-                    chosenSplits->push_back(4); //leTTH->getActions0().at(0);
-            }
-            // Call TTV
-            if(availableSplits[5])
-            {
-                actionID = (int) ((const TPG::TPGAction *) teeTTV.executeFromRoot(*rootTTV).back())->getActionID();
-                if (actionID == 0)
-                    chosenSplits->push_back(5); //leTTV->getActions0().at(0);
-            }
             // Debug printing
             if(debug)
                 std::cout << "          chosen Splits : {";
@@ -317,6 +212,9 @@ void EvaluateAllBinaryParallelFull(size_t seed, uint64_t cuHeight, uint64_t cuWi
 
         // ---------------- Print Result ----------------
         std::cout << "Score : " << score << "/" << nbValidationTarget << std::endl;
+#ifdef FEATURES_FLOAT
+        std::cout << "    Decisions changed by float : " << nbChangedDecisions << "/" << nbValidationTarget << std::endl;
+#endif
         std::cout << "    CU set : ["
                   << CUset->at(0) << ", "
                   << CUset->at(1) << ", "
@@ -341,16 +239,19 @@ void EvaluateAllBinaryParallelFull(size_t seed, uint64_t cuHeight, uint64_t cuWi
                   << " en moyenne : " << moyNbSplit << std::endl;
 
         // ---------------- Clean ----------------
-        // LearningEnvironments
-        delete leNP; delete leQT; delete leBTH; delete leBTV; delete leTTH; delete leTTV;
         // Data, solution handlers and stats stores
         delete dataHandler; delete splitList; delete CUchosen; delete CUset;
     } // End nbEval Loop
 
+    // LearningEnvironment
+    delete leNP;
+
     // ---------------- Compute and Print global result ----------------
     moyenneScore /= nbEval;
     moyenneNbSplit /= nbEval;
     std::cout << "Score moyen : " << moyenneScore << "/1000" << std::endl;
+    std::cout << "Programs executed : " << cascade.getProgramPool().getNbExecutions() << "/"
+              << cascade.getProgramPool().getNbBidRequests() << " bids" << std::endl;
     std::cout << "Nombre de splits sélectionnés moyen : " << moyenneNbSplit << std::endl;
 
     // Store result in file
@@ -364,64 +265,26 @@ void EvaluateAllBinaryParallelFull(size_t seed, uint64_t cuHeight, uint64_t cuWi
 void EvaluateDirectionWaterfallSink(size_t seed, uint64_t cuHeight, uint64_t cuWidth, uint64_t nbFeatures,
                                   uint64_t nbDatabaseElements, uint64_t nbTrainingTargets,
                                   uint64_t nbGeneTargetChange, uint64_t nbValidationTarget,
-                                  const Instructions::Set& set, Learn::LearningParameters params, std::string datasetPath,
+                                  const InstructionSetFactory& instructions, Learn::LearningParameters params, std::string datasetPath,
                                   int nbEval, bool debug, std::vector<bool> availableSplits)
 {
     double moyenneScore = 0.0;
 
+    // ************************************************** INSTANCES *************************************************
+    // ---------------- Import the cascade of binary TPGs once for every evaluation (flattened policies read the CU features directly) ----------------
+    Data::ArrayWrapper<FeatureType> input(nbFeatures + 1, nullptr); // +1 for QP
+    TPGModelRegistry registry(instructions.getSet(), {input}, params.nbRegisters, params.nbProgramConstant, ROOT_DIR "/TPG/");
+    CascadeInferenceEngine cascade(registry, input, instructions.getOpcodes(),
+                                   CascadeTopology::directionWaterfall());
+
+    // LearningEnvironment used to draw the CUs (Cf. getRandomCUFeatures())
+    auto *leNP = new BinaryFeaturesEnv({0}, {1,2,3,4,5}, seed, cuHeight, cuWidth, nbFeatures,
+                                       nbDatabaseElements, nbTrainingTargets, nbGeneTargetChange, nbValidationTarget);
+
     for(int i = 0; i < nbEval; i++)
     {
-        // ************************************************** INSTANCES *************************************************
-
-        // ---------------- Instantiate 6 LearningEnvironments, 6 Environments, 6 TPGGraphs and 6 TPGExecutionEngines ----------------
-        auto *leNP  = new BinaryFeaturesEnv({0}, {1,2,3,4,5}, seed, cuHeight, cuWidth, nbFeatures,
-                                           nbDatabaseElements, nbTrainingTargets, nbGeneTargetChange, nbValidationTarget);
-        auto *leQT  = new BinaryFeaturesEnv({1}, {2,3,4,5}, seed, cuHeight, cuWidth, nbFeatures,
-                                           nbDatabaseElements, nbTrainingTargets, nbGeneTargetChange, nbValidationTarget);
-        auto *leBTH = new BinaryFeaturesEnv({2,4}, {3,5}, seed, cuHeight, cuWidth, nbFeatures,
-                                            nbDatabaseElements, nbTrainingTargets, nbGeneTargetChange, nbValidationTarget);
-        auto *leBTV = new BinaryFeaturesEnv({2}, {4}, seed, cuHeight, cuWidth, nbFeatures,
-                                            nbDatabaseElements, nbTrainingTargets, nbGeneTargetChange, nbValidationTarget);
-        auto *leTTH = new BinaryFeaturesEnv({3}, {5}, seed, cuHeight, cuWidth, nbFeatures,
-                                            nbDatabaseElements, nbTrainingTargets, nbGeneTargetChange, nbValidationTarget);
-
-        // Instantiate the environment that will embed the LearningEnvironment
-        Environment envNP(set,  leNP->getDataSources(), params.nbRegisters, params.nbProgramConstant);
-        Environment envQT(set,  leQT->getDataSources(), params.nbRegisters, params.nbProgramConstant);
-        Environment envBTH(set, leBTH->getDataSources(), params.nbRegisters, params.nbProgramConstant);
-        Environment envBTV(set, leBTV->getDataSources(), params.nbRegisters, params.nbProgramConstant);
-        Environment envTTH(set, leTTH->getDataSources(), params.nbRegisters, params.nbProgramConstant);
-
-        // Instantiate the TPGGraph that we will load
-        auto tpgNP  = TPG::TPGGraph(envNP);
-        auto tpgQT  = TPG::TPGGraph(envQT);
-        auto tpgBTH = TPG::TPGGraph(envBTH);
-        auto tpgBTV = TPG::TPGGraph(envBTV);
-        auto tpgTTH = TPG::TPGGraph(envTTH);
-
-        // Instantiate the tee that will handle the decisions taken by the TPG
-        TPG::TPGExecutionEngine teeNP(envNP);
-        TPG::TPGExecutionEngine teeQT(envQT);
-        TPG::TPGExecutionEngine teeBTH(envBTH);
-        TPG::TPGExecutionEngine teeBTV(envBTV);
-        TPG::TPGExecutionEngine teeTTH(envTTH);
-
-        // ---------------- Import TPG graph from .dot file ----------------
-        importTPG(leNP,  envNP, tpgNP);
-        importTPG(leQT,  envQT, tpgQT);
-        importTPG(leBTH, envBTH, tpgBTH);
-        importTPG(leBTV, envBTV, tpgBTV);
-        importTPG(leTTH, envTTH, tpgTTH);
-
-        // ---------------- Execute TPG from root on the environment ----------------
-        auto rootNP  = tpgNP.getRootVertices().front();
-        auto rootQT  = tpgQT.getRootVertices().front();
-        auto rootBTH = tpgBTH.getRootVertices().front();
-        auto rootBTV = tpgBTV.getRootVertices().front();
-        auto rootTTH = tpgTTH.getRootVertices().front();
-
         // ************************************************* LOAD DATA *************************************************
-        auto *dataHandler = new std::vector<Data::PrimitiveTypeArray<double> *>;
+        auto *dataHandler = new std::vector<std::vector<double> *>;   // Read by the flattened TPGs of the cascade
         auto *splitList   = new std::vector<uint8_t>;
         auto *CUchosen    = new std::vector<int>{0,0,0,0,0,0};
         auto *CUset       = new std::vector<int>{0,0,0,0,0,0};
@@ -430,55 +293,29 @@ void EvaluateDirectionWaterfallSink(size_t seed, uint64_t cuHeight, uint64_t cuW
         // -------------------------- Load a global vector of 1.000 CUs --------------------------
         for (uint64_t idx_targ = 0; idx_targ < nbValidationTarget; idx_targ++)
         {
-            Data::PrimitiveTypeArray<double> *target = getRandomCUFeatures(datasetPath, leNP, splitList);
+            std::vector<double> *target = getRandomCUFeatures(datasetPath, leNP, splitList);
             dataHandler->push_back(target);
             // Optimal split is stored in splitList inside getRandomCU()
         }
 
         // ************************************************** MAIN RUN *************************************************
         uint64_t score = 0;
-        int actionID;
-        int chosenAction = -1;
+
+        // The cascade (NP QT DIREC HORI VERTI) is executed on every CU in a single call
+        std::vector<uint8_t> cascadeSplits;
+        cascade.evaluate(*dataHandler, cascadeSplits);
+#ifdef FEATURES_FLOAT
+        uint64_t nbChangedDecisions = countChangedDecisions(cascade, *dataHandler, cascadeSplits);
+#endif
 
         for (uint64_t nbCU = 0; nbCU < nbValidationTarget; nbCU++)
-        {   // -------------------------- Load next CU for all TPGs --------------------------
-            leNP->setCurrentState(*dataHandler->at(nbCU));
-            leQT->setCurrentState(*dataHandler->at(nbCU));
-            leBTH->setCurrentState(*dataHandler->at(nbCU));
-            leBTV->setCurrentState(*dataHandler->at(nbCU));
-            leTTH->setCurrentState(*dataHandler->at(nbCU));
-
-            // ************************************ ORDER : NP QT DIREC HORI VERTI *************************************
-            // -------------------------- Call NP TPG --------------------------
-            actionID = (int) ((const TPG::TPGAction *) teeNP.executeFromRoot(* rootNP).back())->getActionID();
-            if(actionID == 0)
-                chosenAction = 0; //leNP->getActions0().at(0);
-            else
-            {  // -------------------------- Call QT TPG --------------------------
-                actionID = (int) ((const TPG::TPGAction *) teeQT.executeFromRoot(* rootQT).back())->getActionID();
-                if(actionID == 0)
-                    chosenAction = 1; //leQT->getActions0().at(0);
-                else
-                {  // -------------------------- Call DIREC TPG --------------------------
-                    actionID = (int) ((const TPG::TPGAction *) teeBTH.executeFromRoot(* rootBTH).back())->getActionID();
-                    if(actionID == 0)
-                    {  // -------------------------- Call HORI TPG --------------------------
-                        actionID = (int) ((const TPG::TPGAction *) teeBTV.executeFromRoot(* rootBTV).back())->getActionID();
-                        if(actionID == 0)
-                            chosenAction = 2; //leBTV->getActions0().at(0);
-                        else
-                            chosenAction = 4; //leBTV->getActions1().at(0);
-                    }
-                    else
-                    {  // -------------------------- Call VERTI TPG --------------------------
-                        actionID = (int) ((const TPG::TPGAction *) teeTTH.executeFromRoot(* rootTTH).back())->getActionID();
-                        if(actionID == 0)
-                            chosenAction = 3; //leTTH->getActions0().at(0);
-                        else
-                            chosenAction = 5; //leTTH->getActions1().at(0);
-                    } // DIREC
-                } // QT
-            } // NP
+        {
+            // A waterfall always ends on a single split
+            int chosenAction = -1;
+            for (int split = 0; split < 6; split++)
+                if (cascadeSplits[nbCU] & (1 << split))
+                    chosenAction = split;
+
             // **** Debug Printing ****
             if(debug)
                 std::cout << "Action : " << chosenAction << ", real Split : " << (int) splitList->at(nbCU) << std::endl;
@@ -490,6 +327,9 @@ void EvaluateDirectionWaterfallSink(size_t seed, uint64_t cuHeight, uint64_t cuW
 
         // ---------------- Print Result ----------------
         std::cout << "Score : " << score << "/" << nbValidationTarget << std::endl;
+#ifdef FEATURES_FLOAT
+        std::cout << "    Decisions changed by float : " << nbChangedDecisions << "/" << nbValidationTarget << std::endl;
+#endif
         std::cout << "    CU set : ["
                   << CUset->at(0) << ", "
                   << CUset->at(1) << ", "
@@ -507,77 +347,43 @@ void EvaluateDirectionWaterfallSink(size_t seed, uint64_t cuHeight, uint64_t cuW
         moyenneScore += (double) score;
 
         // ---------------- Clean ----------------
-        // LearningEnvironments
-        delete leNP; delete leQT; delete leBTH; delete leBTV; delete leTTH;
         // Data, solution handlers and stats stores
         delete dataHandler; delete splitList; delete CUchosen; delete CUset;
     } // End nbEval Loop
 
+    // LearningEnvironment
+    delete leNP;
+
     // ---------------- Compute and Print global result ----------------
     moyenneScore /= nbEval;
     std::cout << "Score moyen : " << moyenneScore << "/1000" << std::endl;
+    std::cout << "Programs executed : " << cascade.getProgramPool().getNbExecutions() << "/"
+              << cascade.getProgramPool().getNbBidRequests() << " bids" << std::endl;
 }
 
 void EvaluateLinearWaterfallSink(size_t seed, uint64_t cuHeight, uint64_t cuWidth, uint64_t nbFeatures,
                                   uint64_t nbDatabaseElements, uint64_t nbTrainingTargets,
                                   uint64_t nbGeneTargetChange, uint64_t nbValidationTarget,
-                                  const Instructions::Set& set, Learn::LearningParameters params, std::string datasetPath,
+                                  const InstructionSetFactory& instructions, Learn::LearningParameters params, std::string datasetPath,
                                   int nbEval, bool debug, std::vector<bool> availableSplits)
 {
     double moyenneScore = 0.0;
 
+    // ************************************************** INSTANCES *************************************************
+    // ---------------- Import the cascade of binary TPGs once for every evaluation (flattened policies read the CU features directly) ----------------
+    Data::ArrayWrapper<FeatureType> input(nbFeatures + 1, nullptr); // +1 for QP
+    TPGModelRegistry registry(instructions.getSet(), {input}, params.nbRegisters, params.nbProgramConstant, ROOT_DIR "/TPG/");
+    CascadeInferenceEngine cascade(registry, input, instructions.getOpcodes(),
+                                   CascadeTopology::linearWaterfall());
+
+    // LearningEnvironment used to draw the CUs (Cf. getRandomCUFeatures())
+    auto *leNP = new BinaryFeaturesEnv({0}, {1,2,3,4,5}, seed, cuHeight, cuWidth, nbFeatures,
+                                       nbDatabaseElements, nbTrainingTargets, nbGeneTargetChange, nbValidationTarget);
+
     for(int i = 0; i < nbEval; i++)
     {
-        // ************************************************** INSTANCES *************************************************
-        // ---------------- Instantiate 6 LearningEnvironments, 6 Environments, 6 TPGGraphs and 6 TPGExecutionEngines ----------------
-        auto *leNP  = new BinaryFeaturesEnv({0}, {1,2,3,4,5}, seed, cuHeight, cuWidth, nbFeatures,
-                                            nbDatabaseElements, nbTrainingTargets, nbGeneTargetChange, nbValidationTarget);
-        auto *leQT  = new BinaryFeaturesEnv({1}, {2,3,4,5}, seed, cuHeight, cuWidth, nbFeatures,
-                                            nbDatabaseElements, nbTrainingTargets, nbGeneTargetChange, nbValidationTarget);
-        auto *leBTH = new BinaryFeaturesEnv({2}, {3,4,5}, seed, cuHeight, cuWidth, nbFeatures,
-                                            nbDatabaseElements, nbTrainingTargets, nbGeneTargetChange, nbValidationTarget);
-        auto *leBTV = new BinaryFeaturesEnv({3}, {4,5}, seed, cuHeight, cuWidth, nbFeatures,
-                                            nbDatabaseElements, nbTrainingTargets, nbGeneTargetChange, nbValidationTarget);
-        auto *leTTH = new BinaryFeaturesEnv({4}, {5}, seed, cuHeight, cuWidth, nbFeatures,
-                                            nbDatabaseElements, nbTrainingTargets, nbGeneTargetChange, nbValidationTarget);
-
-        // Instantiate the environment that will embed the LearningEnvironment
-        Environment envNP(set,  leNP->getDataSources(), params.nbRegisters, params.nbProgramConstant);
-        Environment envQT(set,  leQT->getDataSources(), params.nbRegisters, params.nbProgramConstant);
-        Environment envBTH(set, leBTH->getDataSources(), params.nbRegisters, params.nbProgramConstant);
-        Environment envBTV(set, leBTV->getDataSources(), params.nbRegisters, params.nbProgramConstant);
-        Environment envTTH(set, leTTH->getDataSources(), params.nbRegisters, params.nbProgramConstant);
-
-        // Instantiate the TPGGraph that we will load
-        auto tpgNP  = TPG::TPGGraph(envNP);
-        auto tpgQT  = TPG::TPGGraph(envQT);
-        auto tpgBTH = TPG::TPGGraph(envBTH);
-        auto tpgBTV = TPG::TPGGraph(envBTV);
-        auto tpgTTH = TPG::TPGGraph(envTTH);
-
-        // Instantiate the tee that will handle the decisions taken by the TPG
-        TPG::TPGExecutionEngine teeNP(envNP);
-        TPG::TPGExecutionEngine teeQT(envQT);
-        TPG::TPGExecutionEngine teeBTH(envBTH);
-        TPG::TPGExecutionEngine teeBTV(envBTV);
-        TPG::TPGExecutionEngine teeTTH(envTTH);
-
-        // ---------------- Import TPG graph from .dot file ----------------
-        importTPG(leNP,  envNP, tpgNP);
-        importTPG(leQT,  envQT, tpgQT);
-        importTPG(leBTH, envBTH, tpgBTH);
-        importTPG(leBTV, envBTV, tpgBTV);
-        importTPG(leTTH, envTTH, tpgTTH);
-
-        // ---------------- Execute TPG from root on the environment ----------------
-        auto rootNP  = tpgNP.getRootVertices().front();
-        auto rootQT  = tpgQT.getRootVertices().front();
-        auto rootBTH = tpgBTH.getRootVertices().front();
-        auto rootBTV = tpgBTV.getRootVertices().front();
-        auto rootTTH = tpgTTH.getRootVertices().front();
-
         // ************************************************* LOAD DATA *************************************************
-        auto *dataHandler = new std::vector<Data::PrimitiveTypeArray<double> *>;
+        auto *dataHandler = new std::vector<std::vector<double> *>;   // Read by the flattened TPGs of the cascade
         auto *splitList   = new std::vector<uint8_t>;
         auto *CUchosen    = new std::vector<int>{0,0,0,0,0,0};
         auto *CUset       = new std::vector<int>{0,0,0,0,0,0};
@@ -586,66 +392,28 @@ void EvaluateLinearWaterfallSink(size_t seed, uint64_t cuHeight, uint64_t cuWidt
         // -------------------------- Load a global vector of 1.000 CUs --------------------------
         for (uint64_t idx_targ = 0; idx_targ < nbValidationTarget; idx_targ++)
         {
-            Data::PrimitiveTypeArray<double> *target = getRandomCUFeatures(datasetPath, leNP, splitList);
+            std::vector<double> *target = getRandomCUFeatures(datasetPath, leNP, splitList);
             dataHandler->push_back(target);
             // Optimal split is stored in splitList inside getRandomCU()
         }
 
         // ************************************************** MAIN RUN *************************************************
         uint64_t score = 0;
-        int actionID;
-        int chosenAction = -1;
+
+        // The cascade (NP QT BTH BTV TTH) is executed on every CU in a single call
+        std::vector<uint8_t> cascadeSplits;
+        cascade.evaluate(*dataHandler, cascadeSplits);
+#ifdef FEATURES_FLOAT
+        uint64_t nbChangedDecisions = countChangedDecisions(cascade, *dataHandler, cascadeSplits);
+#endif
 
         for (uint64_t nbCU = 0; nbCU < nbValidationTarget; nbCU++)
-        {   // -------------------------- Load next CU for all TPGs --------------------------
-            leNP->setCurrentState(*dataHandler->at(nbCU));
-            leQT->setCurrentState(*dataHandler->at(nbCU));
-            leBTH->setCurrentState(*dataHandler->at(nbCU));
-            leBTV->setCurrentState(*dataHandler->at(nbCU));
-            leTTH->setCurrentState(*dataHandler->at(nbCU));
-
-            // ************************************** ORDER : NP QT BTH BTV TTH ***************************************
-            // -------------------------- Call NP TPG --------------------------
-            actionID = (int) ((const TPG::TPGAction *) teeNP.executeFromRoot(* rootNP).back())->getActionID();
-            //std::cout << "NP Action : " << actionID << std::endl;
-            if(actionID == 0)
-                chosenAction = 0; //leNP->getActions0().at(0);
-            else
-            {
-                // -------------------------- Call QT TPG --------------------------
-                actionID = (int) ((const TPG::TPGAction *) teeQT.executeFromRoot(* rootQT).back())->getActionID();
-                //std::cout << "QT Action : " << actionID << std::endl;
-                if(actionID == 0)
-                    chosenAction = 1; //leQT->getActions0().at(0);
-                else
-                {
-                    // -------------------------- Call BTH TPG --------------------------
-                    actionID = (int) ((const TPG::TPGAction *) teeBTH.executeFromRoot(* rootBTH).back())->getActionID();
-                    //std::cout << "BTH Action : " << actionID << std::endl;
-                    if(actionID == 0)
-                        chosenAction = 2; //leBTH->getActions0().at(0);
-                    else
-                    {
-                        // -------------------------- Call BTV TPG --------------------------
-                        actionID = (int) ((const TPG::TPGAction *) teeBTV.executeFromRoot(* rootBTV).back())->getActionID();
-                        //std::cout << "BTV Action : " << actionID << std::endl;
-                        if(actionID == 0)
-                            chosenAction = 3; //leBTV->getActions0().at(0);
-                        else
-                        {
-                            // -------------------------- Call TTH TPG --------------------------
-                            actionID = (int) ((const TPG::TPGAction *) teeTTH.executeFromRoot(* rootTTH).back())->getActionID();
-                            //std::cout << "TTH Action : " << actionID << std::endl;
-                            if(actionID == 0)
-                                chosenAction = 4; //leTTH->getActions0().at(0);
-                                // TTH
-                            else
-                                chosenAction = 5;
-                                // TTV
-                        } // BTV
-                    } // BTH
-                } // QT
-            } // NP
+        {
+            // A waterfall always ends on a single split
+            int chosenAction = -1;
+            for (int split = 0; split < 6; split++)
+                if (cascadeSplits[nbCU] & (1 << split))
+                    chosenAction = split;
 
             // **** Debug Printing ****
             if(debug)
@@ -658,6 +426,9 @@ void EvaluateLinearWaterfallSink(size_t seed, uint64_t cuHeight, uint64_t cuWidt
 
         // ---------------- Print Result ----------------
         std::cout << "Score : " << score << "/" << nbValidationTarget << std::endl;
+#ifdef FEATURES_FLOAT
+        std::cout << "    Decisions changed by float : " << nbChangedDecisions << "/" << nbValidationTarget << std::endl;
+#endif
         std::cout << "    CU set : ["
                   << CUset->at(0) << ", "
                   << CUset->at(1) << ", "
@@ -675,38 +446,43 @@ void EvaluateLinearWaterfallSink(size_t seed, uint64_t cuHeight, uint64_t cuWidt
         moyenneScore += (double) score;
 
         // ---------------- Clean ----------------
-        // LearningEnvironments
-        delete leNP; delete leQT; delete leBTH; delete leBTV; delete leTTH;
         // Data, solution handlers and stats stores
         delete dataHandler; delete splitList; delete CUchosen; delete CUset;
     } // End nbEval Loop
 
+    // LearningEnvironment
+    delete leNP;
+
     // ---------------- Compute and Print global result ----------------
     moyenneScore /= nbEval;
     std::cout << "Score moyen : " << moyenneScore << "/1000" << std::endl;
+    std::cout << "Programs executed : " << cascade.getProgramPool().getNbExecutions() << "/"
+              << cascade.getProgramPool().getNbBidRequests() << " bids" << std::endl;
 }
 
-void importTPG(BinaryFeaturesEnv* le, Environment& env, TPG::TPGGraph& tpg)
+std::vector<double>* getRandomCUFeatures(std::string& datasetPath, BinaryFeaturesEnv* le, std::vector<uint8_t>* splitList)
 {
-    try{
-        char tpgPath[100] = ROOT_DIR"/TPG/";
-        std::string speActionName = le->getActionName(le->getActions0().at(0));
-        std::strcat(tpgPath, speActionName.c_str());
-        char dotExtension[10] = ".dot";
-        std::strcat(tpgPath, dotExtension);
-        //std::cout << "Import TPG from : \"" << tpgPath << "\"" << std::endl;
-        File::TPGGraphDotImporter dotImporter(tpgPath, env, tpg);
-    }catch (std::runtime_error& e){
-        std::cout << e.what() << std::endl;
-    }
-}
+    uint32_t next_CU_number = rand() % (int) le->NB_DATABASE_ELEMENTS;
 
-Data::PrimitiveTypeArray<double>* getRandomCUFeatures(std::string& datasetPath, BinaryFeaturesEnv* le, std::vector<uint8_t>* splitList)
-{
+    // ------------------ Reading a random CU in a binary features database ------------------
+    if (FeaturesDatabase::isFeaturesDatabase(datasetPath))
+    {
+        FeaturesDatabase& database = FeaturesDatabase::getShared(datasetPath);
+        // QP followed by every features
+        const double* values = database.getValues(next_CU_number);
+
+        // Same filling as from a CSV file (below)
+        auto *randomCU = new std::vector<double>(le->getNbFeatures()+1); // +1 for QP
+        (*randomCU)[0] = values[0];
+        for (uint32_t featuresIdx = 0; featuresIdx < le->getNbFeatures(); featuresIdx++)
+            (*randomCU)[featuresIdx] = values[featuresIdx+1];
+
+        splitList->push_back(database.getSplit(next_CU_number));
+        return randomCU;
+    }
 
     // ------------------ Opening and Reading a random CSV file ------------------
     // Generate the path for a random CSV file
-    uint32_t next_CU_number = rand() % (int) le->NB_DATABASE_ELEMENTS;
     char next_CU_number_string[100];
     std::sprintf(next_CU_number_string, "%d", next_CU_number);
     char CSV_path[100];
@@ -743,12 +519,12 @@ Data::PrimitiveTypeArray<double>* getRandomCUFeatures(std::string& datasetPath,
         std::cout << std::endl;*/
 
         // -------- Create and fill the container --------
-        // Create a new PrimitiveTypeArray<uint8_t> which will contain 1 CU features
-        auto *randomCU = new Data::PrimitiveTypeArray<double>(le->getNbFeatures()+1); // +1 for QP
+        // Create a new vector which will contain 1 CU features (read by the flattened TPGs of the cascade)
+        auto *randomCU = new std::vector<double>(le->getNbFeatures()+1); // +1 for QP
         // Fill it with QP Value and then every features
-        randomCU->setDataAt(typeid(double), 0, std::stod(row.at(0)));
+        (*randomCU)[0] = std::stod(row.at(0));
         for (uint32_t featuresIdx = 2; featuresIdx < le->getNbFeatures()+2; featuresIdx++)
-            randomCU->setDataAt(typeid(double), featuresIdx-2, std::stod(row.at(featuresIdx)));
+            (*randomCU)[featuresIdx-2] = std::stod(row.at(featuresIdx));
 
         // -------- Store the features array (currentState) and its split --------
         // Deduce the optimal split from string
@@ -809,3 +585,24 @@ void ParseAvailableSplitsInVector(std::vector<bool>& actions, std::string str)
     }
     std::cout << std::endl;
 }
+
+/**
+ * \brief Validation of the float pipeline (FEATURES_FLOAT build) : evaluate the cascade again in double precision
+ * \param[in] cus the CUs already evaluated by the cascade
+ * \param[in] cascadeSplits the chosen splits of each CU in single precision
+ * \return the number of CUs whose chosen splits differ in double precision
+ */
+uint64_t countChangedDecisions(CascadeInferenceEngine& cascade, const std::vector<std::vector<double>*>& cus,
+                               const std::vector<uint8_t>& cascadeSplits)
+{
+    std::vector<uint8_t> doubleSplits;
+    cascade.setDoublePrecision(true);
+    cascade.evaluate(cus, doubleSplits);
+    cascade.setDoublePrecision(false);
+
+    uint64_t nbChanged = 0;
+    for (size_t idx_cu = 0; idx_cu < cus.size(); idx_cu++)
+        if (doubleSplits[idx_cu] != cascadeSplits[idx_cu])
+            nbChanged++;
+    return nbChanged;
+}
@@ -0,0 +1,471 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include "../../include/inference/FlatProgramPool.h"
+
+FlatProgramPool::FlatProgramPool(const Environment& env, std::vector<FlatOpcode> opcodes, TPGInputLayout input)
+        : env(env),
+          opcodes(std::move(opcodes)),
+          input(std::move(input)),
+          inputSize(this->input.width * this->input.height),
+          pixelsInput(this->input.type == typeid(uint8_t)),
+          floatInput(this->input.type == typeid(float)),
+          doublePrecision(false),
+          pixels(nullptr),
+          epoch(0),
+          nbLanes(0),
+          nbBidRequests(0),
+          nbExecutions(0)
+{
+    if (env.getDataSources().size() != 1)
+        throw std::runtime_error("FlatProgramPool: the Environment must have a single data source");
+    if (this->opcodes.size() != env.getInstructionSet().getNbInstructions())
+        throw std::runtime_error("FlatProgramPool: one opcode is needed for each instruction");
+    for (size_t idx_instr = 0; idx_instr < this->opcodes.size(); idx_instr++)
+        if (this->opcodes[idx_instr] == FlatOpcode::UNSUPPORTED)
+            throw std::runtime_error("FlatProgramPool: instruction " + std::to_string(idx_instr) + " can't be flattened");
+    if (!this->pixelsInput && !this->floatInput && this->input.type != typeid(double))
+        throw std::runtime_error("FlatProgramPool: the input must be double, float or uint8_t");
+
+    this->values.resize(env.getNbRegisters() + (this->pixelsInput ? 0 : this->inputSize));
+    this->batchValues.resize(this->values.size() * BATCH_SIZE);
+    if (this->pixelsInput)
+        this->batchPixels.resize(this->inputSize * BATCH_SIZE);
+}
+
+bool FlatProgramPool::isConstantOperand(FlatOpcode opcode, size_t idx_op)
+{
+    return (idx_op == 1 && (opcode == FlatOpcode::MULT_BY_CONST || opcode == FlatOpcode::MULT_BY_CONST_U8
+                            || opcode == FlatOpcode::MULT_BY_CONST_F32))
+           || (idx_op == 0 && opcode == FlatOpcode::CONV2D_U8);
+}
+
+uint32_t FlatProgramPool::addProgram(const Program::Program& program)
+{
+    const Instructions::Set& set = this->env.getInstructionSet();
+    const uint32_t nbRegisters = (uint32_t) this->env.getNbRegisters();
+
+    // ------------------ Resolve the lines, constants indexed in the program ------------------
+    // The key of the program is its content, with the values of the constants read (not their index)
+    std::vector<FlatLine> programLines;
+    std::vector<int64_t> key;
+    for (uint64_t idx_line = 0; idx_line < program.getNbLines(); idx_line++)
+    {
+        if (program.isIntron(idx_line))
+            continue;
+        const Program::Line& line = program.getLine(idx_line);
+        const Instructions::Instruction& instruction = set.getInstruction(line.getInstructionIndex());
+        const FlatOpcode opcode = this->opcodes[line.getInstructionIndex()];
+        const bool doubleOpcode = opcode <= FlatOpcode::MULT_BY_CONST;
+        const bool floatOpcode = opcode >= FlatOpcode::MINUS_F32;
+        key.push_back((int64_t) opcode);
+        key.push_back((int64_t) line.getDestinationIndex());
+
+        // Resolve the operands and check they are read where the opcode reads them
+        uint32_t operands[2] = {0, 0};
+        bool valid = instruction.getOperandTypes().size() <= 2;
+        for (size_t idx_op = 0; valid && idx_op < instruction.getOperandTypes().size(); idx_op++)
+        {
+            TPGOperand operand = TPGOperand::resolve(this->env, this->input, instruction.getOperandTypes()[idx_op], line.getOperand(idx_op));
+            uint64_t expectedSize = (opcode == FlatOpcode::CONV2D_U8) ? 9 : 1;
+            if (FlatProgramPool::isConstantOperand(opcode, idx_op))
+            {
+                valid &= operand.source == TPGOperand::CONSTANT && operand.size == expectedSize;
+                for (uint64_t idx_const = 0; valid && idx_const < operand.size; idx_const++)
+                    key.push_back(program.getConstantAt(operand.offset + idx_const).value);
+            }
+            else if (doubleOpcode)
+                valid &= operand.source != TPGOperand::CONSTANT;
+            else if (floatOpcode)
+                valid &= operand.source == TPGOperand::INPUT && operand.size == 1;
+            else
+                valid &= operand.source == TPGOperand::INPUT && operand.size == expectedSize
+                         && (operand.size == 1 || operand.stride == this->input.width);
+
+            // Registers then features in values for the double and float opcodes
+            operands[idx_op] = (uint32_t) (((doubleOpcode || floatOpcode) && operand.source == TPGOperand::INPUT)
+                                           ? nbRegisters + operand.offset : operand.offset);
+            if (!FlatProgramPool::isConstantOperand(opcode, idx_op))
+                key.push_back(operands[idx_op]);
+        }
+        if (!valid)
+            throw std::runtime_error("FlatProgramPool: the operands of instruction " + std::to_string(line.getInstructionIndex())
+                                     + " don't match its opcode");
+        programLines.push_back({opcode, (uint32_t) line.getDestinationIndex(), operands[0], operands[1]});
+    }
+
+    // ------------------ Reuse the slot of an identical program ------------------
+    auto known = this->programSlots.find(key);
+    if (known != this->programSlots.end())
+        return known->second;
+
+    // ------------------ New slot : constants in the pool, lines in the lines array ------------------
+    const uint32_t firstConstant = (uint32_t) this->constantPool.size();
+    for (uint64_t idx_const = 0; idx_const < this->env.getNbConstant(); idx_const++)
+        this->constantPool.push_back(program.getConstantAt(idx_const).value);
+    for (FlatLine& line : programLines)
+    {
+        if (FlatProgramPool::isConstantOperand(line.opcode, 0))
+            line.a += firstConstant;
+        if (FlatProgramPool::isConstantOperand(line.opcode, 1))
+            line.b += firstConstant;
+    }
+
+    const uint32_t slot = (uint32_t) this->programs.size();
+    this->programs.push_back({(uint32_t) this->lines.size(), (uint32_t) programLines.size()});
+    this->lines.insert(this->lines.end(), programLines.begin(), programLines.end());
+    this->bids.push_back(0.0);
+    this->bidEpochs.push_back(0);  // Epoch 0 is before the first input
+    this->programSlots.emplace(std::move(key), slot);
+    return slot;
+}
+
+double FlatProgramPool::executeProgram(const FlatProgram& program)
+{
+    double* r = this->values.data();
+    const uint8_t* p = this->pixels;
+    const bool single = !this->doublePrecision;
+    std::fill(r, r + this->env.getNbRegisters(), 0.0);
+
+    // Same operations, in the same order, as the lambdas of the instruction sets (Cf. TypedInstructions)
+    const FlatLine* end = this->lines.data() + program.firstLine + program.nbLines;
+    for (const FlatLine* line = this->lines.data() + program.firstLine; line != end; line++)
+    {
+        double result;
+        switch (line->opcode)
+        {
+            case FlatOpcode::MINUS:            result = r[line->a] - r[line->b]; break;
+            case FlatOpcode::ADD:              result = r[line->a] + r[line->b]; break;
+            case FlatOpcode::MULT:             result = r[line->a] * r[line->b]; break;
+            case FlatOpcode::DIV:              result = r[line->a] / r[line->b]; break;
+            case FlatOpcode::MAX:              result = std::max(r[line->a], r[line->b]); break;
+            case FlatOpcode::EXP:              result = std::exp(r[line->a]); break;
+            case FlatOpcode::LN:               result = std::log(r[line->a]); break;
+            case FlatOpcode::MULT_BY_CONST:    result = r[line->a] * (double) this->constantPool[line->b]; break;
+            case FlatOpcode::MINUS_U8:         result = p[line->a] - p[line->b]; break;
+            case FlatOpcode::ADD_U8:           result = p[line->a] + p[line->b]; break;
+            case FlatOpcode::MULT_U8:          result = p[line->a] * p[line->b]; break;
+            case FlatOpcode::DIV_U8:           result = p[line->a] / (double) p[line->b]; break;
+            case FlatOpcode::MAX_U8:           result = std::max(p[line->a], p[line->b]); break;
+            case FlatOpcode::MULT_BY_CONST_U8: result = p[line->a] * (double) this->constantPool[line->b]; break;
+            case FlatOpcode::CONV2D_U8:
+            {
+                // Integer products and sum : exact, as the double ones of the instruction (Cf. TypedInstructions::Conv2D)
+                const int32_t* coeff = this->constantPool.data() + line->a;
+                const uint8_t* data = p + line->b;
+                int64_t sum = 0;
+                for (int i = 0; i < 3; i++)
+                    for (int j = 0; j < 3; j++)
+                        sum += (int64_t) coeff[i * 3 + j] * data[i * this->input.width + j];
+                result = (double) sum;
+                break;
+            }
+            // The features are exact floats in values, unless in double precision (Cf. setDoublePrecision())
+            case FlatOpcode::MINUS_F32: result = single ? (double) ((float) r[line->a] - (float) r[line->b]) : r[line->a] - r[line->b]; break;
+            case FlatOpcode::ADD_F32:   result = single ? (double) ((float) r[line->a] + (float) r[line->b]) : r[line->a] + r[line->b]; break;
+            case FlatOpcode::MULT_F32:  result = single ? (double) ((float) r[line->a] * (float) r[line->b]) : r[line->a] * r[line->b]; break;
+            case FlatOpcode::DIV_F32:   result = single ? (double) ((float) r[line->a] / (float) r[line->b]) : r[line->a] / r[line->b]; break;
+            case FlatOpcode::MAX_F32:   result = std::max(r[line->a], r[line->b]); break;
+            case FlatOpcode::EXP_F32:   result = single ? (double) std::exp((float) r[line->a]) : std::exp(r[line->a]); break;
+            case FlatOpcode::LN_F32:    result = single ? (double) std::log((float) r[line->a]) : std::log(r[line->a]); break;
+            case FlatOpcode::MULT_BY_CONST_F32:
+                result = single ? (double) ((float) r[line->a] * (float) this->constantPool[line->b])
+                                : r[line->a] * (double) this->constantPool[line->b];
+                break;
+            case FlatOpcode::UNSUPPORTED:   // Rejected by the constructor
+                throw std::runtime_error("FlatProgramPool: unsupported opcode");
+        }
+        r[line->destination] = result;
+    }
+    return r[0];
+}
+
+template <typename Accumulator>
+void FlatProgramPool::conv2DLanes(const int32_t* coeff, const uint8_t* window, size_t width, size_t nbLanes, double* result)
+{
+    Accumulator sums[BATCH_SIZE] = {};
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+        {
+            const Accumulator c = (Accumulator) coeff[i * 3 + j];
+            if (c == 0)
+                continue;
+            const uint8_t* data = window + (i * width + j) * BATCH_SIZE;
+            for (size_t l = 0; l < BATCH_SIZE; l++) sums[l] += c * (Accumulator) data[l];
+        }
+    for (size_t l = 0; l < nbLanes; l++) result[l] = (double) sums[l];
+}
+
+void FlatProgramPool::executeProgramBatch(const FlatProgram& program, double* laneBids)
+{
+    // Same operations as executeProgram(), each one over every lane : a value v of lane l is at v * BATCH_SIZE + l
+    const size_t n = this->nbLanes;
+    const bool single = !this->doublePrecision;
+    double* values = this->batchValues.data();
+    const uint8_t* pixelLanes = this->batchPixels.data();
+    std::fill(values, values + this->env.getNbRegisters() * BATCH_SIZE, 0.0);
+
+    // Lanes of the value (register or input) or of the pixel v. Only the operands of the opcode are addressed : the
+    // other fields may be out of the values, and there are no pixels in features mode
+    const auto valueLanes = [values](uint32_t v) { return values + (size_t) v * BATCH_SIZE; };
+    const auto pixelLanesAt = [pixelLanes](uint32_t v) { return pixelLanes + (size_t) v * BATCH_SIZE; };
+
+    const FlatLine* end = this->lines.data() + program.firstLine + program.nbLines;
+    for (const FlatLine* line = this->lines.data() + program.firstLine; line != end; line++)
+    {
+        double* d = valueLanes(line->destination);
+        switch (line->opcode)
+        {
+            case FlatOpcode::MINUS:
+            {
+                const double* a = valueLanes(line->a), * b = valueLanes(line->b);
+                for (size_t l = 0; l < n; l++) d[l] = a[l] - b[l];
+                break;
+            }
+            case FlatOpcode::ADD:
+            {
+                const double* a = valueLanes(line->a), * b = valueLanes(line->b);
+                for (size_t l = 0; l < n; l++) d[l] = a[l] + b[l];
+                break;
+            }
+            case FlatOpcode::MULT:
+            {
+                const double* a = valueLanes(line->a), * b = valueLanes(line->b);
+                for (size_t l = 0; l < n; l++) d[l] = a[l] * b[l];
+                break;
+            }
+            case FlatOpcode::DIV:
+            {
+                const double* a = valueLanes(line->a), * b = valueLanes(line->b);
+                for (size_t l = 0; l < n; l++) d[l] = a[l] / b[l];
+                break;
+            }
+            case FlatOpcode::MAX:
+            {
+                const double* a = valueLanes(line->a), * b = valueLanes(line->b);
+                for (size_t l = 0; l < n; l++) d[l] = std::max(a[l], b[l]);
+                break;
+            }
+            case FlatOpcode::EXP:
+            {
+                const double* a = valueLanes(line->a);
+                for (size_t l = 0; l < n; l++) d[l] = std::exp(a[l]);
+                break;
+            }
+            case FlatOpcode::LN:
+            {
+                const double* a = valueLanes(line->a);
+                for (size_t l = 0; l < n; l++) d[l] = std::log(a[l]);
+                break;
+            }
+            case FlatOpcode::MULT_BY_CONST:
+            {
+                const double* a = valueLanes(line->a);
+                const double c = (double) this->constantPool[line->b];
+                for (size_t l = 0; l < n; l++) d[l] = a[l] * c;
+                break;
+            }
+            case FlatOpcode::MINUS_U8:
+            {
+                const uint8_t* pa = pixelLanesAt(line->a), * pb = pixelLanesAt(line->b);
+                for (size_t l = 0; l < n; l++) d[l] = pa[l] - pb[l];
+                break;
+            }
+            case FlatOpcode::ADD_U8:
+            {
+                const uint8_t* pa = pixelLanesAt(line->a), * pb = pixelLanesAt(line->b);
+                for (size_t l = 0; l < n; l++) d[l] = pa[l] + pb[l];
+                break;
+            }
+            case FlatOpcode::MULT_U8:
+            {
+                const uint8_t* pa = pixelLanesAt(line->a), * pb = pixelLanesAt(line->b);
+                for (size_t l = 0; l < n; l++) d[l] = pa[l] * pb[l];
+                break;
+            }
+            case FlatOpcode::DIV_U8:
+            {
+                const uint8_t* pa = pixelLanesAt(line->a), * pb = pixelLanesAt(line->b);
+                for (size_t l = 0; l < n; l++) d[l] = pa[l] / (double) pb[l];
+                break;
+            }
+            case FlatOpcode::MAX_U8:
+            {
+                const uint8_t* pa = pixelLanesAt(line->a), * pb = pixelLanesAt(line->b);
+                for (size_t l = 0; l < n; l++) d[l] = std::max(pa[l], pb[l]);
+                break;
+            }
+            case FlatOpcode::MULT_BY_CONST_U8:
+            {
+                const uint8_t* pa = pixelLanesAt(line->a);
+                const double c = (double) this->constantPool[line->b];
+                for (size_t l = 0; l < n; l++) d[l] = pa[l] * c;
+                break;
+            }
+            case FlatOpcode::CONV2D_U8:
+            {
+                // Integer accumulation over the lanes (int32_t when the coefficients can't overflow it, the usual
+                // [minConstValue, maxConstValue] range) : exact, as the double accumulation of the instruction
+                const int32_t* coeff = this->constantPool.data() + line->a;
+                int64_t maxSum = 0;
+                for (int k = 0; k < 9; k++)
+                    maxSum += std::abs((int64_t) coeff[k]) * UINT8_MAX;
+                if (maxSum <= INT32_MAX)
+                    FlatProgramPool::conv2DLanes<int32_t>(coeff, pixelLanesAt(line->b), this->input.width, n, d);
+                else
+                    FlatProgramPool::conv2DLanes<int64_t>(coeff, pixelLanesAt(line->b), this->input.width, n, d);
+                break;
+            }
+            case FlatOpcode::MINUS_F32:
+            {
+                const double* a = valueLanes(line->a), * b = valueLanes(line->b);
+                if (single) for (size_t l = 0; l < n; l++) d[l] = (double) ((float) a[l] - (float) b[l]);
+                else        for (size_t l = 0; l < n; l++) d[l] = a[l] - b[l];
+                break;
+            }
+            case FlatOpcode::ADD_F32:
+            {
+                const double* a = valueLanes(line->a), * b = valueLanes(line->b);
+                if (single) for (size_t l = 0; l < n; l++) d[l] = (double) ((float) a[l] + (float) b[l]);
+                else        for (size_t l = 0; l < n; l++) d[l] = a[l] + b[l];
+                break;
+            }
+            case FlatOpcode::MULT_F32:
+            {
+                const double* a = valueLanes(line->a), * b = valueLanes(line->b);
+                if (single) for (size_t l = 0; l < n; l++) d[l] = (double) ((float) a[l] * (float) b[l]);
+                else        for (size_t l = 0; l < n; l++) d[l] = a[l] * b[l];
+                break;
+            }
+            case FlatOpcode::DIV_F32:
+            {
+                const double* a = valueLanes(line->a), * b = valueLanes(line->b);
+                if (single) for (size_t l = 0; l < n; l++) d[l] = (double) ((float) a[l] / (float) b[l]);
+                else        for (size_t l = 0; l < n; l++) d[l] = a[l] / b[l];
+                break;
+            }
+            case FlatOpcode::MAX_F32:
+            {
+                const double* a = valueLanes(line->a), * b = valueLanes(line->b);
+                for (size_t l = 0; l < n; l++) d[l] = std::max(a[l], b[l]);
+                break;
+            }
+            case FlatOpcode::EXP_F32:
+            {
+                const double* a = valueLanes(line->a);
+                if (single) for (size_t l = 0; l < n; l++) d[l] = (double) std::exp((float) a[l]);
+                else        for (size_t l = 0; l < n; l++) d[l] = std::exp(a[l]);
+                break;
+            }
+            case FlatOpcode::LN_F32:
+            {
+                const double* a = valueLanes(line->a);
+                if (single) for (size_t l = 0; l < n; l++) d[l] = (double) std::log((float) a[l]);
+                else        for (size_t l = 0; l < n; l++) d[l] = std::log(a[l]);
+                break;
+            }
+            case FlatOpcode::MULT_BY_CONST_F32:
+            {
+                const double* a = valueLanes(line->a);
+                const float cf = (float) this->constantPool[line->b];
+                const double c = (double) this->constantPool[line->b];
+                if (single) for (size_t l = 0; l < n; l++) d[l] = (double) ((float) a[l] * cf);
+                else        for (size_t l = 0; l < n; l++) d[l] = a[l] * c;
+                break;
+            }
+            case FlatOpcode::UNSUPPORTED:   // Rejected by the constructor
+                throw std::runtime_error("FlatProgramPool: unsupported opcode");
+        }
+    }
+    std::copy(values, values + n, laneBids);
+}
+
+void FlatProgramPool::executeBatch()
+{
+    this->epoch++;
+    this->batchBids.resize(this->programs.size() * BATCH_SIZE);
+    for (size_t slot = 0; slot < this->programs.size(); slot++)
+        this->executeProgramBatch(this->programs[slot], this->batchBids.data() + slot * BATCH_SIZE);
+    this->nbExecutions += this->programs.size() * this->nbLanes;
+}
+
+void FlatProgramPool::setInputBatch(const std::vector<const double*>& features)
+{
+    if (this->pixelsInput)
+        throw std::runtime_error("FlatProgramPool: the input of the TPGs is uint8_t");
+    if (features.size() > BATCH_SIZE)
+        throw std::runtime_error("FlatProgramPool: batches are limited to " + std::to_string(BATCH_SIZE) + " CUs");
+
+    // Transpose the features after the registers (rounded to float for a float input)
+    this->nbLanes = features.size();
+    const bool single = this->floatInput && !this->doublePrecision;
+    double* inputLanes = this->batchValues.data() + this->env.getNbRegisters() * BATCH_SIZE;
+    for (size_t lane = 0; lane < this->nbLanes; lane++)
+        for (uint64_t idx = 0; idx < this->inputSize; idx++)
+            inputLanes[idx * BATCH_SIZE + lane] = single ? (double) (float) features[lane][idx] : features[lane][idx];
+    this->executeBatch();
+}
+
+void FlatProgramPool::setInputBatch(const std::vector<const uint8_t*>& cuPixels)
+{
+    if (!this->pixelsInput)
+        throw std::runtime_error("FlatProgramPool: the input of the TPGs is double");
+    if (cuPixels.size() > BATCH_SIZE)
+        throw std::runtime_error("FlatProgramPool: batches are limited to " + std::to_string(BATCH_SIZE) + " CUs");
+
+    this->nbLanes = cuPixels.size();
+    for (size_t lane = 0; lane < this->nbLanes; lane++)
+        for (uint64_t idx = 0; idx < this->inputSize; idx++)
+            this->batchPixels[idx * BATCH_SIZE + lane] = cuPixels[lane][idx];
+    this->executeBatch();
+}
+
+void FlatProgramPool::setInput(const double* features)
+{
+    if (this->pixelsInput)
+        throw std::runtime_error("FlatProgramPool: the input of the TPGs is uint8_t");
+    double* inputValues = this->values.data() + this->env.getNbRegisters();
+    if (this->floatInput && !this->doublePrecision)
+        for (uint64_t idx = 0; idx < this->inputSize; idx++)
+            inputValues[idx] = (double) (float) features[idx];
+    else
+        std::memcpy(inputValues, features, this->inputSize * sizeof(double));
+    this->epoch++;
+}
+
+void FlatProgramPool::setInput(const uint8_t* cuPixels)
+{
+    if (!this->pixelsInput)
+        throw std::runtime_error("FlatProgramPool: the input of the TPGs is double");
+    this->pixels = cuPixels;
+    this->epoch++;
+}
+
+void FlatProgramPool::setDoublePrecision(bool enable)
+{
+    this->doublePrecision = enable;
+    this->epoch++;  // The memoised bids were computed in the other precision
+}
+
+bool FlatProgramPool::isDoublePrecision() const { return this->doublePrecision; }
+
+bool FlatProgramPool::matches(const std::vector<FlatOpcode>& otherOpcodes, const TPGInputLayout& otherInput) const
+{
+    return otherOpcodes == this->opcodes && otherInput.type == this->input.type
+           && otherInput.width == this->input.width && otherInput.height == this->input.height;
+}
+
+size_t FlatProgramPool::getNbLanes() const { return this->nbLanes; }
+
+size_t FlatProgramPool::getNbPrograms() const { return this->programs.size(); }
+
+size_t FlatProgramPool::getNbLines() const { return this->lines.size(); }
+
+uint64_t FlatProgramPool::getNbBidRequests() const { return this->nbBidRequests; }
+
+uint64_t FlatProgramPool::getNbExecutions() const { return this->nbExecutions; }
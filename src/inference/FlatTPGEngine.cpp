@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+
+#include "../../include/inference/FlatTPGEngine.h"
+
+FlatTPGEngine::FlatTPGEngine(const TPG::TPGVertex* root, FlatProgramPool& pool)
+        : pool(pool)
+{
+    // ------------------ Number the reachable vertices (breadth-first from the root) ------------------
+    std::vector<const TPG::TPGVertex*> tpgVertices = {root};
+    std::map<const TPG::TPGVertex*, uint32_t> vertexIndices = {{root, 0}};
+    for (size_t idx_vertex = 0; idx_vertex < tpgVertices.size(); idx_vertex++)
+        for (const TPG::TPGEdge* edge : tpgVertices[idx_vertex]->getOutgoingEdges())
+            if (vertexIndices.emplace(edge->getDestination(), (uint32_t) tpgVertices.size()).second)
+                tpgVertices.push_back(edge->getDestination());
+
+    // ------------------ Vertices and edges (contiguous for each team, in the order of its outgoing edges) ------------------
+    // Each program is flattened once in the pool, and shared with the identical programs of the other TPGs
+    std::map<const Program::Program*, uint32_t> programSlots;
+    for (const TPG::TPGVertex* vertex : tpgVertices)
+    {
+        const auto* action = dynamic_cast<const TPG::TPGAction*>(vertex);
+        this->vertices.push_back({(action != nullptr) ? action->getActionID() : TEAM, (uint32_t) this->edges.size(),
+                                  (uint32_t) vertex->getOutgoingEdges().size()});
+        for (const TPG::TPGEdge* edge : vertex->getOutgoingEdges())
+        {
+            auto slot = programSlots.find(&edge->getProgram());
+            if (slot == programSlots.end())
+                slot = programSlots.emplace(&edge->getProgram(), this->pool.addProgram(edge->getProgram())).first;
+            this->edges.push_back({slot->second, vertexIndices.at(edge->getDestination())});
+        }
+    }
+
+    this->visited.resize(this->vertices.size());
+}
+
+template <class BidFunction> uint64_t FlatTPGEngine::followPolicy(BidFunction getBid)
+{
+    std::fill(this->visited.begin(), this->visited.end(), 0);
+    uint32_t vertex = 0;
+    while (this->vertices[vertex].actionID == TEAM)
+    {
+        this->visited[vertex] = 1;
+        const FlatVertex& team = this->vertices[vertex];
+
+        // Highest bid among the edges leading to a vertex not visited yet (the last one on a tie)
+        double bestBid = -std::numeric_limits<double>::infinity();
+        uint32_t next = vertex;
+        for (const FlatEdge* edge = this->edges.data() + team.firstEdge; edge != this->edges.data() + team.firstEdge + team.nbEdges; edge++)
+        {
+            if (this->visited[edge->destination])
+                continue;
+            double bid = getBid(edge->program);
+            if (std::isnan(bid))
+                bid = -std::numeric_limits<double>::infinity();
+            if (bid >= bestBid)
+            {
+                bestBid = bid;
+                next = edge->destination;
+            }
+        }
+        if (next == vertex)
+            return UINT64_MAX; // Every edge leads to a visited vertex
+        vertex = next;
+    }
+    return this->vertices[vertex].actionID;
+}
+
+uint64_t FlatTPGEngine::execute()
+{
+    return this->followPolicy([this](uint32_t slot) { return this->pool.getBid(slot); });
+}
+
+uint64_t FlatTPGEngine::executeLane(size_t lane)
+{
+    return this->followPolicy([this, lane](uint32_t slot) { return this->pool.getBatchBid(slot, lane); });
+}
+
+uint64_t FlatTPGEngine::execute(const double* features)
+{
+    this->pool.setInput(features);
+    return this->execute();
+}
+
+uint64_t FlatTPGEngine::execute(const uint8_t* cuPixels)
+{
+    this->pool.setInput(cuPixels);
+    return this->execute();
+}
+
+void FlatTPGEngine::executeBatch(const std::vector<const double*>& features, std::vector<uint64_t>& actionIDs)
+{
+    actionIDs.resize(features.size());
+    std::vector<const double*> batch;
+    for (size_t first = 0; first < features.size(); first += FlatProgramPool::BATCH_SIZE)
+    {
+        size_t last = std::min(first + FlatProgramPool::BATCH_SIZE, features.size());
+        batch.assign(features.begin() + (long) first, features.begin() + (long) last);
+        this->pool.setInputBatch(batch);
+        for (size_t lane = 0; lane < batch.size(); lane++)
+            actionIDs[first + lane] = this->executeLane(lane);
+    }
+}
+
+FlatProgramPool& FlatTPGEngine::getProgramPool() const { return this->pool; }
+
+size_t FlatTPGEngine::getNbVertices() const { return this->vertices.size(); }
@@ -0,0 +1,108 @@
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+#include "../../include/inference/TPGBinaryExporter.h"
+
+const std::string TPGBinaryExporter::FILE_EXTENSION = ".tpgb";
+const char TPGBinaryExporter::MAGIC[8] = {'T', 'P', 'G', 'B', 'I', 'N', '\0', '\0'};
+
+TPGBinaryExporter::TPGBinaryExporter(const char* filePath, const TPG::TPGGraph& tpg)
+        : filePath(filePath),
+          tpg(tpg)
+{
+}
+
+void TPGBinaryExporter::setNewFilePath(const char* newFilePath)
+{
+    this->filePath = newFilePath;
+}
+
+void TPGBinaryExporter::print(const TPG::TPGVertex* root) const
+{
+    const Environment& env = this->tpg.getEnvironment();
+    const uint64_t maxNbOperands = env.getMaxNbOperands();
+
+    // ------------------ Number the reachable vertices and programs (breadth-first from the root) ------------------
+    std::vector<const TPG::TPGVertex*> vertices = {root};
+    std::map<const TPG::TPGVertex*, uint32_t> vertexIndices = {{root, 0}};
+    std::vector<const Program::Program*> programs;
+    std::map<const Program::Program*, uint32_t> programIndices;
+
+    std::vector<uint64_t> vertexValues;
+    std::vector<uint32_t> edges;
+    for (size_t idx_vertex = 0; idx_vertex < vertices.size(); idx_vertex++)
+    {
+        const auto* action = dynamic_cast<const TPG::TPGAction*>(vertices[idx_vertex]);
+        vertexValues.push_back(action ? action->getActionID() : TPGBinaryExporter::TEAM_VERTEX);
+
+        for (const TPG::TPGEdge* edge : vertices[idx_vertex]->getOutgoingEdges())
+        {
+            // Shared programs and vertices are stored once
+            auto destination = vertexIndices.emplace(edge->getDestination(), (uint32_t) vertices.size());
+            if (destination.second)
+                vertices.push_back(edge->getDestination());
+            auto program = programIndices.emplace(&edge->getProgram(), (uint32_t) programs.size());
+            if (program.second)
+                programs.push_back(&edge->getProgram());
+
+            edges.insert(edges.end(), {(uint32_t) idx_vertex, destination.first->second, program.first->second});
+        }
+    }
+
+    // ------------------ Flatten the programs (introns are dropped) ------------------
+    std::vector<int32_t> constants;
+    std::vector<uint32_t> lineCounts;
+    std::vector<uint32_t> lines;
+    for (const Program::Program* program : programs)
+    {
+        for (size_t idx_const = 0; idx_const < env.getNbConstant(); idx_const++)
+            constants.push_back(program->getConstantAt(idx_const).value);
+
+        uint32_t nbLines = 0;
+        for (uint64_t idx_line = 0; idx_line < program->getNbLines(); idx_line++)
+        {
+            if (program->isIntron(idx_line))
+                continue;
+            const Program::Line& line = program->getLine(idx_line);
+            lines.push_back((uint32_t) line.getDestinationIndex());
+            lines.push_back((uint32_t) line.getInstructionIndex());
+            for (uint64_t idx_op = 0; idx_op < maxNbOperands; idx_op++)
+            {
+                lines.push_back((uint32_t) line.getOperand(idx_op).first);
+                lines.push_back((uint32_t) line.getOperand(idx_op).second);
+            }
+            nbLines++;
+        }
+        lineCounts.push_back(nbLines);
+    }
+
+    // ------------------ Write the header and the arrays ------------------
+    TPGBinaryHeader header{};
+    std::memcpy(header.magic, TPGBinaryExporter::MAGIC, sizeof(header.magic));
+    header.version = TPGBinaryExporter::VERSION;
+    header.nbInstructions = (uint32_t) env.getNbInstructions();
+    header.nbRegisters = (uint32_t) env.getNbRegisters();
+    header.nbConstants = (uint32_t) env.getNbConstant();
+    header.nbDataSources = (uint32_t) env.getNbDataSources();
+    header.maxNbOperands = (uint32_t) maxNbOperands;
+    header.nbVertices = (uint32_t) vertices.size();
+    header.nbEdges = (uint32_t) (edges.size() / 3);
+    header.nbPrograms = (uint32_t) programs.size();
+    header.nbLines = (uint32_t) (lines.size() / (2 + 2 * maxNbOperands));
+
+    std::FILE* output = std::fopen(this->filePath.c_str(), "wb");
+    if (!output)
+        throw std::runtime_error("Binary TPG file opening failed : " + this->filePath);
+    bool written = std::fwrite(&header, sizeof(TPGBinaryHeader), 1, output) == 1
+                   && std::fwrite(vertexValues.data(), sizeof(uint64_t), vertexValues.size(), output) == vertexValues.size()
+                   && std::fwrite(edges.data(), sizeof(uint32_t), edges.size(), output) == edges.size()
+                   && std::fwrite(constants.data(), sizeof(int32_t), constants.size(), output) == constants.size()
+                   && std::fwrite(lineCounts.data(), sizeof(uint32_t), lineCounts.size(), output) == lineCounts.size()
+                   && std::fwrite(lines.data(), sizeof(uint32_t), lines.size(), output) == lines.size();
+    std::fclose(output);
+    if (!written)
+        throw std::runtime_error("Binary TPG file writing failed : " + this->filePath);
+}
@@ -0,0 +1,110 @@
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "../../include/inference/TPGBinaryImporter.h"
+
+TPGBinaryImporter::TPGBinaryImporter(const char* filePath, Environment& env, TPG::TPGGraph& tpg)
+{
+    const std::string path(filePath);
+
+    // ------------------ Read the whole file ------------------
+    std::FILE* input = std::fopen(filePath, "rb");
+    if (!input)
+        throw std::runtime_error("Binary TPG file opening failed : " + path);
+    std::fseek(input, 0, SEEK_END);
+    long fileSize = std::ftell(input);
+    std::fseek(input, 0, SEEK_SET);
+    std::vector<uint8_t> content(fileSize > 0 ? (size_t) fileSize : 0);
+    size_t nbRead = std::fread(content.data(), 1, content.size(), input);
+    std::fclose(input);
+    if (nbRead != content.size() || content.size() < sizeof(TPGBinaryHeader))
+        throw std::runtime_error("Not a binary TPG file : " + path);
+
+    // ------------------ Check the header ------------------
+    TPGBinaryHeader header{};
+    std::memcpy(&header, content.data(), sizeof(TPGBinaryHeader));
+    if (std::memcmp(header.magic, TPGBinaryExporter::MAGIC, sizeof(TPGBinaryExporter::MAGIC)) != 0
+        || header.version != TPGBinaryExporter::VERSION)
+        throw std::runtime_error("Not a binary TPG file (or unsupported version) : " + path);
+    if (header.nbInstructions != env.getNbInstructions() || header.nbRegisters != env.getNbRegisters()
+        || header.nbConstants != env.getNbConstant() || header.nbDataSources != env.getNbDataSources()
+        || header.maxNbOperands != env.getMaxNbOperands())
+        throw std::runtime_error("Binary TPG file trained in a different Environment : " + path);
+
+    const size_t lineSize = 2 + 2 * (size_t) header.maxNbOperands;
+    size_t expectedSize = sizeof(TPGBinaryHeader) + header.nbVertices * sizeof(uint64_t)
+                          + (3 * (size_t) header.nbEdges + header.nbPrograms + header.nbLines * lineSize) * sizeof(uint32_t)
+                          + (size_t) header.nbPrograms * header.nbConstants * sizeof(int32_t);
+    if (content.size() != expectedSize || header.nbVertices == 0)
+        throw std::runtime_error("Truncated or corrupted binary TPG file : " + path);
+
+    // ------------------ Copy the arrays (the file gives no alignment guarantee) ------------------
+    size_t offset = sizeof(TPGBinaryHeader);
+    auto readArray = [&content, &offset](void* destination, size_t size) {
+        std::memcpy(destination, content.data() + offset, size);
+        offset += size;
+    };
+    std::vector<uint64_t> vertexValues(header.nbVertices);
+    std::vector<uint32_t> edges(3 * (size_t) header.nbEdges);
+    std::vector<int32_t> constants((size_t) header.nbPrograms * header.nbConstants);
+    std::vector<uint32_t> lineCounts(header.nbPrograms);
+    std::vector<uint32_t> lines(header.nbLines * lineSize);
+    readArray(vertexValues.data(), vertexValues.size() * sizeof(uint64_t));
+    readArray(edges.data(), edges.size() * sizeof(uint32_t));
+    readArray(constants.data(), constants.size() * sizeof(int32_t));
+    readArray(lineCounts.data(), lineCounts.size() * sizeof(uint32_t));
+    readArray(lines.data(), lines.size() * sizeof(uint32_t));
+
+    // ------------------ Rebuild the vertices (the root first) ------------------
+    std::vector<const TPG::TPGVertex*> vertices;
+    for (uint64_t value : vertexValues)
+    {
+        if (value == TPGBinaryExporter::TEAM_VERTEX)
+            vertices.push_back(&tpg.addNewTeam());
+        else
+            vertices.push_back(&tpg.addNewAction(value));
+    }
+
+    // ------------------ Rebuild the programs ------------------
+    std::vector<std::shared_ptr<Program::Program>> programs;
+    size_t idx_line = 0;
+    for (uint32_t idx_prog = 0; idx_prog < header.nbPrograms; idx_prog++)
+    {
+        auto program = std::make_shared<Program::Program>(env);
+        for (uint32_t idx_const = 0; idx_const < header.nbConstants; idx_const++)
+            program->getConstantHandler().setDataAt(typeid(Data::Constant), idx_const,
+                                                    Data::Constant{constants[idx_prog * header.nbConstants + idx_const]});
+
+        if (idx_line + lineCounts[idx_prog] > header.nbLines)
+            throw std::runtime_error("Corrupted binary TPG file (lines) : " + path);
+        for (uint32_t i = 0; i < lineCounts[idx_prog]; i++, idx_line++)
+        {
+            const uint32_t* values = &lines[idx_line * lineSize];
+            Program::Line& line = program->addNewLine();
+            bool valid = line.setDestinationIndex(values[0]) && line.setInstructionIndex(values[1]);
+            for (uint32_t idx_op = 0; idx_op < header.maxNbOperands; idx_op++)
+                valid = valid && line.setOperand(idx_op, values[2 + 2 * idx_op], values[3 + 2 * idx_op]);
+            if (!valid)
+                throw std::runtime_error("Corrupted binary TPG file (invalid line) : " + path);
+        }
+        programs.push_back(program);
+    }
+
+    // ------------------ Rebuild the edges (in their bidding order) ------------------
+    for (uint32_t idx_edge = 0; idx_edge < header.nbEdges; idx_edge++)
+    {
+        uint32_t source = edges[3 * idx_edge], destination = edges[3 * idx_edge + 1], program = edges[3 * idx_edge + 2];
+        if (source >= vertices.size() || destination >= vertices.size() || program >= programs.size())
+            throw std::runtime_error("Corrupted binary TPG file (invalid edge) : " + path);
+        tpg.addNewEdge(*vertices[source], *vertices[destination], programs[program]);
+    }
+}
+
+bool TPGBinaryImporter::isBinaryTPGFile(const std::string& path)
+{
+    const std::string& ext = TPGBinaryExporter::FILE_EXTENSION;
+    return path.size() > ext.size() && path.compare(path.size() - ext.size(), ext.size(), ext) == 0;
+}
@@ -0,0 +1,140 @@
+#include <map>
+#include <stdexcept>
+#include <utility>
+
+#include "../../include/inference/TPGCodeGenerator.h"
+
+TPGCodeGenerator::TPGCodeGenerator(const Environment& env, std::vector<std::string> instructionTemplates, std::string helpers,
+                                   TPGInputLayout input)
+        : env(env),
+          instructionTemplates(std::move(instructionTemplates)),
+          helpers(std::move(helpers)),
+          input(std::move(input))
+{
+    if (this->env.getDataSources().size() != 1)
+        throw std::runtime_error("TPGCodeGenerator: the Environment must have a single data source");
+    if (this->instructionTemplates.size() != this->env.getInstructionSet().getNbInstructions())
+        throw std::runtime_error("TPGCodeGenerator: one C++ template is needed for each instruction");
+}
+
+std::string TPGCodeGenerator::getOperandExpression(const Program::Program& program, size_t programIdx, const std::type_info& type,
+                                                   const std::pair<uint64_t, uint64_t>& operand, uint64_t& stride) const
+{
+    TPGOperand resolved = TPGOperand::resolve(this->env, this->input, type, operand);
+    stride = resolved.stride;
+    switch (resolved.source)
+    {
+        case TPGOperand::REGISTER:
+            return "r[" + std::to_string(resolved.offset) + "]";
+        case TPGOperand::CONSTANT:
+            // Scalar constants are written as literals
+            if (resolved.size == 1)
+                return "((int32_t) " + std::to_string(program.getConstantAt(resolved.offset).value) + ")";
+            return "(constants_" + std::to_string(programIdx) + " + " + std::to_string(resolved.offset) + ")";
+        default:
+            if (resolved.size == 1)
+                return "in[" + std::to_string(resolved.offset) + "]";
+            return "(in + " + std::to_string(resolved.offset) + ")";
+    }
+}
+
+void TPGCodeGenerator::generate(const TPG::TPGVertex* root, const std::string& functionName, std::ostream& output) const
+{
+    const Instructions::Set& set = this->env.getInstructionSet();
+    const uint64_t nbConstants = this->env.getNbConstant();
+
+    // ------------------ Number the reachable vertices and programs (breadth-first from the root) ------------------
+    std::vector<const TPG::TPGVertex*> vertices = {root};
+    std::map<const TPG::TPGVertex*, size_t> vertexIndices = {{root, 0}};
+    std::vector<const Program::Program*> programs;
+    std::map<const Program::Program*, size_t> programIndices;
+    for (size_t idx_vertex = 0; idx_vertex < vertices.size(); idx_vertex++)
+    {
+        for (const TPG::TPGEdge* edge : vertices[idx_vertex]->getOutgoingEdges())
+        {
+            if (vertexIndices.emplace(edge->getDestination(), vertices.size()).second)
+                vertices.push_back(edge->getDestination());
+            if (programIndices.emplace(&edge->getProgram(), programs.size()).second)
+                programs.push_back(&edge->getProgram());
+        }
+    }
+
+    // ------------------ Preamble ------------------
+    output << "// Generated by TPGCodeGenerator (" << vertices.size() << " vertices, " << programs.size()
+           << " programs) : do not edit" << std::endl;
+    output << "#include <algorithm>\n#include <cmath>\n#include <cstddef>\n#include <cstdint>\n#include <limits>\n" << std::endl;
+    output << "namespace {" << std::endl;
+    output << this->helpers << std::endl;
+
+    // ------------------ Programs : straight-line code on local registers ------------------
+    for (size_t idx_prog = 0; idx_prog < programs.size(); idx_prog++)
+    {
+        const Program::Program& program = *programs[idx_prog];
+        if (nbConstants > 0)
+        {
+            output << "const int32_t constants_" << idx_prog << "[" << nbConstants << "] = {";
+            for (uint64_t idx_const = 0; idx_const < nbConstants; idx_const++)
+                output << (idx_const ? ", " : "") << program.getConstantAt(idx_const).value;
+            output << "};" << std::endl;
+        }
+
+        output << "inline double program_" << idx_prog << "(const " << this->input.cType << "* in)" << std::endl << "{" << std::endl;
+        output << "    double r[" << this->env.getNbRegisters() << "] = {};" << std::endl;
+        for (uint64_t idx_line = 0; idx_line < program.getNbLines(); idx_line++)
+        {
+            if (program.isIntron(idx_line))
+                continue;
+            const Program::Line& line = program.getLine(idx_line);
+            const Instructions::Instruction& instruction = set.getInstruction(line.getInstructionIndex());
+
+            // Replace the "%Sk" (strides) then the "%k" (operands) of the template
+            std::string code = this->instructionTemplates.at(line.getInstructionIndex());
+            for (size_t idx_op = instruction.getOperandTypes().size(); idx_op-- > 0;)
+            {
+                uint64_t stride;
+                std::string operand = this->getOperandExpression(program, idx_prog, instruction.getOperandTypes()[idx_op].get(),
+                                                                 line.getOperand(idx_op), stride);
+                for (const auto& token : {std::make_pair("%S" + std::to_string(idx_op), std::to_string(stride)),
+                                          std::make_pair("%" + std::to_string(idx_op), operand)})
+                    for (size_t pos = code.find(token.first); pos != std::string::npos; pos = code.find(token.first, pos + token.second.size()))
+                        code.replace(pos, token.first.size(), token.second);
+            }
+            output << "    r[" << line.getDestinationIndex() << "] = " << code << ";" << std::endl;
+        }
+        output << "    return r[0];" << std::endl << "}" << std::endl << std::endl;
+    }
+    output << "} // namespace" << std::endl << std::endl;
+
+    // ------------------ Vertices : the best bid of each team designates the next vertex ------------------
+    output << "uint64_t " << functionName << "(const " << this->input.cType << "* in)" << std::endl << "{" << std::endl;
+    output << "    bool visited[" << vertices.size() << "] = {};" << std::endl;
+    output << "    size_t vertex = 0;" << std::endl;
+    output << "    while (true)" << std::endl << "    {" << std::endl;
+    output << "        visited[vertex] = true;" << std::endl;
+    output << "        double bestBid = -std::numeric_limits<double>::infinity(), bid;" << std::endl;
+    output << "        size_t next = vertex;" << std::endl;
+    output << "        switch (vertex)" << std::endl << "        {" << std::endl;
+    for (size_t idx_vertex = 0; idx_vertex < vertices.size(); idx_vertex++)
+    {
+        output << "        case " << idx_vertex << ":" << std::endl;
+        const auto* action = dynamic_cast<const TPG::TPGAction*>(vertices[idx_vertex]);
+        if (action)
+        {
+            output << "            return " << action->getActionID() << ";" << std::endl;
+            continue;
+        }
+        for (const TPG::TPGEdge* edge : vertices[idx_vertex]->getOutgoingEdges())
+        {
+            size_t destination = vertexIndices.at(edge->getDestination());
+            output << "            if (!visited[" << destination << "]) { bid = program_" << programIndices.at(&edge->getProgram())
+                   << "(in); if (std::isnan(bid)) bid = -std::numeric_limits<double>::infinity();"
+                   << " if (bid >= bestBid) { bestBid = bid; next = " << destination << "; } }" << std::endl;
+        }
+        output << "            break;" << std::endl;
+    }
+    output << "        }" << std::endl;
+    output << "        if (next == vertex)" << std::endl;
+    output << "            return UINT64_MAX; // Every edge leads to a visited vertex" << std::endl;
+    output << "        vertex = next;" << std::endl;
+    output << "    }" << std::endl << "}" << std::endl;
+}
@@ -0,0 +1,65 @@
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+#include "../../include/inference/TPGModelRegistry.h"
+#include "../../include/inference/TPGBinaryImporter.h"
+
+TPGModelRegistry::TPGModelRegistry(const Instructions::Set& set, const std::vector<std::reference_wrapper<const Data::DataHandler>>& dataSources,
+                                   size_t nbRegisters, size_t nbConstants, std::string tpgDirectory)
+        : env(set, dataSources, nbRegisters, nbConstants),
+          tpgDirectory(std::move(tpgDirectory)),
+          tee(this->env)
+{
+}
+
+const TPG::TPGVertex* TPGModelRegistry::getRoot(const std::string& tpgName)
+{
+    auto imported = this->roots.find(tpgName);
+    if (imported == this->roots.end())
+    {
+        // ---------------- Import TPG graph (only once), from its binary file if it was exported ----------------
+        std::unique_ptr<TPG::TPGGraph> graph(new TPG::TPGGraph(this->env));
+        std::string tpgPath = this->tpgDirectory + tpgName + TPGBinaryExporter::FILE_EXTENSION;
+        if (std::ifstream(tpgPath).good())
+            TPGBinaryImporter binaryImporter(tpgPath.c_str(), this->env, *graph);
+        else
+        {
+            tpgPath = this->tpgDirectory + tpgName + ".dot";
+            File::TPGGraphDotImporter dotImporter(tpgPath.c_str(), this->env, *graph);
+        }
+
+        auto rootVertices = graph->getRootVertices();
+        if (rootVertices.empty())
+            throw std::runtime_error("TPGModelRegistry: no root in " + tpgPath);
+        imported = this->roots.emplace(tpgName, rootVertices.front()).first;
+        this->graphs.emplace(tpgName, std::move(graph));
+    }
+    return imported->second;
+}
+
+uint64_t TPGModelRegistry::execute(const TPG::TPGVertex* root)
+{
+    return ((const TPG::TPGAction *) this->tee.executeFromRoot(*root).back())->getActionID();
+}
+
+FlatTPGEngine& TPGModelRegistry::getFlatEngine(const std::string& tpgName, const std::vector<FlatOpcode>& opcodes,
+                                               const TPGInputLayout& input)
+{
+    if (this->programPool == nullptr)
+        this->programPool.reset(new FlatProgramPool(this->env, opcodes, input));
+    else if (!this->programPool->matches(opcodes, input))
+        throw std::runtime_error("TPGModelRegistry: every flattened TPG must use the same opcodes and input layout");
+
+    auto flattened = this->flatEngines.find(tpgName);
+    if (flattened == this->flatEngines.end())
+    {
+        std::unique_ptr<FlatTPGEngine> engine(new FlatTPGEngine(this->getRoot(tpgName), *this->programPool));
+        flattened = this->flatEngines.emplace(tpgName, std::move(engine)).first;
+    }
+    return *flattened->second;
+}
+
+size_t TPGModelRegistry::getNbGraphs() const { return this->graphs.size(); }
+
+const Environment& TPGModelRegistry::getEnvironment() const { return this->env; }
@@ -0,0 +1,75 @@
+#include <stdexcept>
+#include <vector>
+
+#include "../../include/inference/TPGOperand.h"
+
+namespace {
+    /// Operand type supported by the inference backends : a scalar, a 1D array [width] or a 2D array [height][width]
+    struct OperandType {
+        const std::type_info& type;
+        const std::type_info& element;
+        uint64_t height;
+        uint64_t width;
+        bool isArray;
+    };
+
+    const std::vector<OperandType>& getSupportedTypes()
+    {
+        static const std::vector<OperandType> supportedTypes = {
+                {typeid(double),            typeid(double),         1, 1, false},
+                {typeid(float),             typeid(float),          1, 1, false},
+                {typeid(uint8_t),           typeid(uint8_t),        1, 1, false},
+                {typeid(Data::Constant),    typeid(Data::Constant), 1, 1, false},
+                {typeid(Data::Constant[9]), typeid(Data::Constant), 1, 9, true},
+                {typeid(uint8_t[2][2]),     typeid(uint8_t),        2, 2, true},
+                {typeid(uint8_t[3][3]),     typeid(uint8_t),        3, 3, true},
+                {typeid(uint8_t[4][4]),     typeid(uint8_t),        4, 4, true},
+                {typeid(uint8_t[5][5]),     typeid(uint8_t),        5, 5, true},
+                {typeid(double[3][3]),      typeid(double),         3, 3, true}
+        };
+        return supportedTypes;
+    }
+}
+
+TPGOperand TPGOperand::resolve(const Environment& env, const TPGInputLayout& input, const std::type_info& type,
+                               const std::pair<uint64_t, uint64_t>& operand)
+{
+    const OperandType* operandType = nullptr;
+    for (const OperandType& supportedType : getSupportedTypes())
+        if (supportedType.type == type)
+            operandType = &supportedType;
+    if (operandType == nullptr)
+        throw std::runtime_error(std::string("TPGOperand: unsupported operand type ") + type.name());
+
+    const uint64_t nbConstants = env.getNbConstant();
+    const uint64_t inputSource = (nbConstants > 0) ? 2 : 1;
+    const uint64_t location = operand.second;
+    const uint64_t size = operandType->width * operandType->height;
+
+    // ------------------ Registers ------------------
+    if (operand.first == 0 && operandType->element == typeid(double) && !operandType->isArray)
+        return {REGISTER, location % env.getNbRegisters(), 0, 1};
+
+    // ------------------ Constants of the program ------------------
+    if (operand.first == 1 && nbConstants > 0 && operandType->element == typeid(Data::Constant) && size <= nbConstants)
+        return {CONSTANT, location % (nbConstants - size + 1), 0, size};
+
+    // ------------------ Input ------------------
+    if (operand.first == inputSource && operandType->element == input.type)
+    {
+        if (!operandType->isArray)
+            return {INPUT, location % (input.width * input.height), 0, 1};
+        if (operandType->height == 1 && input.height == 1 && operandType->width <= input.width)
+            return {INPUT, location % (input.width - operandType->width + 1), 0, size};
+        if (operandType->height > 1 && input.height > 1 && operandType->width <= input.width && operandType->height <= input.height)
+        {
+            // Top-left corner of the window, the address space being the possible positions of the window
+            uint64_t nbPositionsX = input.width - operandType->width + 1;
+            uint64_t address = location % (nbPositionsX * (input.height - operandType->height + 1));
+            return {INPUT, (address / nbPositionsX) * input.width + address % nbPositionsX, input.width, size};
+        }
+    }
+
+    throw std::runtime_error("TPGOperand: operand (" + std::to_string(operand.first) + ", "
+                             + std::to_string(operand.second) + ") can't be read as " + type.name());
+}
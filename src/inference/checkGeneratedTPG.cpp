@@ -0,0 +1,91 @@
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+
+#include <gegelati.h>
+
+#include "../../include/database/FeaturesDatabase.h"
+#include "../../include/database/PackedCUDatabase.h"
+#include "../../include/database/ParallelTargetsLoader.h"
+#include "../../include/features/FeatureType.h"
+#include "../../include/inference/TPGBinaryImporter.h"
+#include "../../include/instructions/InstructionSetFactory.h"
+
+// Function written by TPGVVCPartDatabase_generateTPGCode (compiled with this file, Cf. CMakeLists.txt)
+#ifdef CODEGEN_PIXELS
+typedef uint8_t InputType;
+#else
+typedef FeatureType InputType;
+#endif
+uint64_t generatedTPG(const InputType* in);
+
+/**
+ * Cross-check of a generated TPG function against TPG::TPGExecutionEngine on the CUs of a validation set
+ *
+ * The validation CUs are drawn as the environments draw them (Cf. ParallelTargetsLoader::VALIDATION_STREAM).
+ * Returns 0 only if every decision of the generated function matches the decision of the engine.
+ */
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        std::cout << "Waiting 2 arguments : tpgFile (.tpgb or .dot, the one the code was generated from) and database"
+                  << " (" << FeaturesDatabase::FILE_EXTENSION << " or " << PackedCUDatabase::FILE_EXTENSION
+                  << "), and optionally nbValidationTargets and seed." << std::endl;
+        return 1;
+    }
+    std::string tpgFile = argv[1];
+    std::string databasePath = argv[2];
+    uint64_t nbValidationTargets = (argc > 3) ? std::strtoull(argv[3], nullptr, 10) : 1000;
+    size_t seed = (argc > 4) ? std::strtoull(argv[4], nullptr, 10) : 0;
+
+    // ---------------- Instruction set, parameters and data source of the trained TPG ----------------
+#ifdef CODEGEN_PIXELS
+    InstructionSetFactory instructions(InstructionSetFactory::getPixelsNames());
+    PackedCUDatabase& database = PackedCUDatabase::getShared(databasePath);
+    std::vector<uint8_t> input(32 * 32);
+    Data::Array2DWrapper<uint8_t> dataSource(32, 32, &input);
+#else
+    InstructionSetFactory instructions(InstructionSetFactory::getFeaturesNames());
+    FeaturesDatabase& database = FeaturesDatabase::getShared(databasePath);
+    std::vector<FeatureType> input(database.getNbFeatures() + 1);
+    Data::ArrayWrapper<FeatureType> dataSource(input.size(), &input);
+#endif
+
+    Learn::LearningParameters params;
+    File::ParametersParser::loadParametersFromJson(ROOT_DIR "/TPG/params.json", params);
+    Environment env(instructions.getSet(), {dataSource}, params.nbRegisters, params.nbProgramConstant);
+    TPG::TPGGraph tpg(env);
+    if (TPGBinaryImporter::isBinaryTPGFile(tpgFile))
+        TPGBinaryImporter binaryImporter(tpgFile.c_str(), env, tpg);
+    else
+        File::TPGGraphDotImporter dotImporter(tpgFile.c_str(), env, tpg);
+    const TPG::TPGVertex* root = tpg.getRootVertices().front();
+    TPG::TPGExecutionEngine tee(env);
+
+    // ---------------- Compare the decisions on every validation CU ----------------
+    uint64_t nbMismatches = 0;
+    for (uint64_t idx_targ = 0; idx_targ < nbValidationTargets; idx_targ++)
+    {
+        Mutator::RNG loaderRng(ParallelTargetsLoader::getSubstreamSeed(seed, ParallelTargetsLoader::VALIDATION_STREAM, idx_targ));
+        uint32_t cuNumber = loaderRng.getInt32(0, (int32_t) database.getNbElements() - 1);
+#ifdef CODEGEN_PIXELS
+        const uint8_t* values = database.getCU(cuNumber);
+#else
+        const double* values = database.getValues(cuNumber);
+#endif
+        input.assign(values, values + input.size());
+
+        uint64_t engineAction = ((const TPG::TPGAction *) tee.executeFromRoot(*root).back())->getActionID();
+        uint64_t generatedAction = generatedTPG(input.data());
+        if (engineAction != generatedAction)
+        {
+            if (nbMismatches < 10)
+                std::cout << "Mismatch on CU " << cuNumber << " : engine " << engineAction << ", generated " << generatedAction << std::endl;
+            nbMismatches++;
+        }
+    }
+    std::cout << nbValidationTargets - nbMismatches << "/" << nbValidationTargets << " identical decisions" << std::endl;
+
+    return (nbMismatches == 0) ? 0 : 1;
+}
@@ -0,0 +1,81 @@
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+
+#include <gegelati.h>
+
+#include "../../include/features/FeatureType.h"
+#include "../../include/inference/TPGBinaryImporter.h"
+#include "../../include/inference/TPGCodeGenerator.h"
+#include "../../include/instructions/InstructionSetFactory.h"
+
+/**
+ * Write a standalone C++ function from a trained binary TPG (Cf. TPGCodeGenerator)
+ *
+ * Example : "./TPGVVCPartDatabase_generateTPGCode features /Path/To/TPG/NP.tpgb partitionNP /Path/To/partitionNP.cpp"
+ * The generated function is "uint64_t partitionNP(const double* input)" with input the QP followed by the features
+ * ("const float* input" in a FEATURES_FLOAT build, "const uint8_t* input" with the 32x32 pixels of the CU in pixels
+ * mode), and returns the action of the TPG.
+ */
+int main(int argc, char* argv[])
+{
+    if (argc != 5 && argc != 6)
+    {
+        std::cout << "Waiting 4 arguments : mode (features or pixels), tpgFile (.tpgb or .dot), functionName and outputFile (and optionally nbFeatures)." << std::endl;
+        std::cout << "Example : \"./TPGVVCPartDatabase_generateTPGCode features /Path/To/TPG/NP.tpgb partitionNP /Path/To/partitionNP.cpp\"" << std::endl;
+        return 1;
+    }
+    bool pixels = std::strcmp(argv[1], "pixels") == 0;
+    std::string tpgFile = argv[2];
+    std::string functionName = argv[3];
+    std::string outputFile = argv[4];
+    uint64_t nbFeatures = (argc == 6) ? std::strtoull(argv[5], nullptr, 10) : 112;
+
+    // ---------------- Instruction set, parameters and data source of the trained TPG ----------------
+    InstructionSetFactory instructions(pixels ? InstructionSetFactory::getPixelsNames() : InstructionSetFactory::getFeaturesNames());
+
+    Learn::LearningParameters params;
+    File::ParametersParser::loadParametersFromJson(ROOT_DIR "/TPG/params.json", params);
+
+    Data::ArrayWrapper<FeatureType> features(nbFeatures + 1, nullptr);   // +1 for QP
+    Data::Array2DWrapper<uint8_t> cu(32, 32, nullptr);
+    std::vector<std::reference_wrapper<const Data::DataHandler>> dataSources;
+    if (pixels)
+        dataSources.emplace_back(cu);
+    else
+        dataSources.emplace_back(features);
+    TPGInputLayout layout = pixels ? TPGInputLayout{"uint8_t", typeid(uint8_t), 32, 32}
+                                   : TPGInputLayout{(typeid(FeatureType) == typeid(float)) ? "float" : "double",
+                                                    typeid(FeatureType), nbFeatures + 1, 1};
+
+    int status = 0;
+    try
+    {
+        // ---------------- Import the TPG ----------------
+        instructions.checkSignature(tpgFile.substr(0, tpgFile.find_last_of('/') + 1));
+        Environment env(instructions.getSet(), dataSources, params.nbRegisters, params.nbProgramConstant);
+        TPG::TPGGraph tpg(env);
+        if (TPGBinaryImporter::isBinaryTPGFile(tpgFile))
+            TPGBinaryImporter binaryImporter(tpgFile.c_str(), env, tpg);
+        else
+            File::TPGGraphDotImporter dotImporter(tpgFile.c_str(), env, tpg);
+        if (tpg.getRootVertices().empty())
+            throw std::runtime_error("No root in " + tpgFile);
+
+        // ---------------- Generate the code of its first root ----------------
+        std::ofstream output(outputFile, std::ios::out | std::ios::trunc);
+        if (!output)
+            throw std::runtime_error("File opening failed : " + outputFile);
+        TPGCodeGenerator generator(env, instructions.getTemplates(), InstructionSetFactory::HELPERS, layout);
+        generator.generate(tpg.getRootVertices().front(), functionName, output);
+        std::cout << "Function " << functionName << " generated in " << outputFile << std::endl;
+    }
+    catch (std::runtime_error& e)
+    {
+        std::cerr << e.what() << std::endl;
+        status = 1;
+    }
+
+    return status;
+}
@@ -0,0 +1,221 @@
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+#include "../../include/instructions/InstructionSetFactory.h"
+#include "../../include/instructions/TypedInstructions.h"
+
+using namespace TypedInstructions;
+
+namespace {
+    template <class Kernel, typename... Operands> std::unique_ptr<Instructions::Instruction> create()
+    {
+        return std::unique_ptr<Instructions::Instruction>(new KernelInstruction<Kernel, Operands...>());
+    }
+
+    const std::vector<std::string> UINT8_NAMES = {"minus_u8", "add_u8", "mult_u8", "div_u8", "max_u8", "multByConst_u8"};
+    const std::vector<std::string> WINDOW_NAMES = {"mean2_u8", "var2_u8", "mean3_u8", "var3_u8",
+                                                   "mean4_u8", "var4_u8", "mean5_u8", "var5_u8"};
+    const std::vector<std::string> INTEGRAL_WINDOW_NAMES = {"mean2_sat", "var2_sat", "mean3_sat", "var3_sat",
+                                                            "mean4_sat", "var4_sat", "mean5_sat", "var5_sat"};
+    const std::vector<std::string> DOUBLE_NAMES = {"minus", "add", "mult", "div", "max", "exp", "ln", "multByConst"};
+    const std::vector<std::string> FLOAT_NAMES = {"minus_f32", "add_f32", "mult_f32", "div_f32",
+                                                  "max_f32", "exp_f32", "ln_f32", "multByConst_f32"};
+
+    /// Concatenation of name lists
+    std::vector<std::string> concat(std::initializer_list<std::vector<std::string>> lists)
+    {
+        std::vector<std::string> names;
+        for (const std::vector<std::string>& list : lists)
+            names.insert(names.end(), list.begin(), list.end());
+        return names;
+    }
+}
+
+const std::string InstructionSetFactory::HELPERS =
+        "template <typename T>\n"
+        "inline double tpg_conv2D(const int32_t* coeff, const T* data, size_t stride)\n"
+        "{\n"
+        "    double res = 0.0;\n"
+        "    for (int i = 0; i < 3; i++)\n"
+        "        for (int j = 0; j < 3; j++)\n"
+        "            res += (double) coeff[i * 3 + j] * data[i * stride + j];\n"
+        "    return res;\n"
+        "}\n"
+        "inline double tpg_mean(const uint8_t* data, size_t stride, int n)\n"
+        "{\n"
+        "    uint8_t sum = 0;\n"
+        "    for (int i = 0; i < n; i++)\n"
+        "        for (int j = 0; j < n; j++)\n"
+        "            sum += data[i * stride + j];\n"
+        "    return sum;\n"
+        "}\n"
+        "inline double tpg_var(const uint8_t* data, size_t stride, int n)\n"
+        "{\n"
+        "    double sum = 0;\n"
+        "    for (int i = 0; i < n; i++)\n"
+        "        for (int j = 0; j < n; j++)\n"
+        "            sum += data[i * stride + j];\n"
+        "    return sum / (n * n);\n"
+        "}\n";
+
+const std::string InstructionSetFactory::SIGNATURE_FILE = "instructions.txt";
+
+const std::vector<InstructionSetFactory::NamedInstruction>& InstructionSetFactory::getAvailableInstructions()
+{
+    static const std::vector<NamedInstruction> available = {
+            // ------------------ uint8_t instructions (pixels) ------------------
+            {"minus_u8",       create<Minus, uint8_t, uint8_t>,       "(double) (%0 - %1)",                 FlatOpcode::MINUS_U8},
+            {"add_u8",         create<Add, uint8_t, uint8_t>,         "(double) (%0 + %1)",                 FlatOpcode::ADD_U8},
+            {"mult_u8",        create<Mult, uint8_t, uint8_t>,        "(double) (%0 * %1)",                 FlatOpcode::MULT_U8},
+            {"div_u8",         create<Div, uint8_t, uint8_t>,         "%0 / (double) %1",                   FlatOpcode::DIV_U8},
+            {"max_u8",         create<Max, uint8_t, uint8_t>,         "(double) std::max<uint8_t>(%0, %1)", FlatOpcode::MAX_U8},
+            {"multByConst_u8", create<MultByConst, uint8_t, Data::Constant>, "%0 * (double) %1",            FlatOpcode::MULT_BY_CONST_U8},
+            {"mean2_u8",       create<Mean<2>, uint8_t[2][2]>,        "tpg_mean(%0, %S0, 2)",               FlatOpcode::UNSUPPORTED},
+            {"var2_u8",        create<Var<2>, uint8_t[2][2]>,         "tpg_var(%0, %S0, 2)",                FlatOpcode::UNSUPPORTED},
+            {"mean3_u8",       create<Mean<3>, uint8_t[3][3]>,        "tpg_mean(%0, %S0, 3)",               FlatOpcode::UNSUPPORTED},
+            {"var3_u8",        create<Var<3>, uint8_t[3][3]>,         "tpg_var(%0, %S0, 3)",                FlatOpcode::UNSUPPORTED},
+            {"mean4_u8",       create<Mean<4>, uint8_t[4][4]>,        "tpg_mean(%0, %S0, 4)",               FlatOpcode::UNSUPPORTED},
+            {"var4_u8",        create<Var<4>, uint8_t[4][4]>,         "tpg_var(%0, %S0, 4)",                FlatOpcode::UNSUPPORTED},
+            {"mean5_u8",       create<Mean<5>, uint8_t[5][5]>,        "tpg_mean(%0, %S0, 5)",               FlatOpcode::UNSUPPORTED},
+            {"var5_u8",        create<Var<5>, uint8_t[5][5]>,         "tpg_var(%0, %S0, 5)",                FlatOpcode::UNSUPPORTED},
+            {"conv2D_u8",      create<Conv2D, Data::Constant[9], uint8_t[3][3]>, "tpg_conv2D(%0, %1, %S1)", FlatOpcode::CONV2D_U8},
+
+            // ------------------ NxN window instructions on the integral images of the CU (no template, Cf. IntegralImageHandler) ------------------
+            {"mean2_sat",      create<WindowMean<2>, WindowSums<2>>,  "",                                   FlatOpcode::UNSUPPORTED},
+            {"var2_sat",       create<WindowVar<2>, WindowSums<2>>,   "",                                   FlatOpcode::UNSUPPORTED},
+            {"mean3_sat",      create<WindowMean<3>, WindowSums<3>>,  "",                                   FlatOpcode::UNSUPPORTED},
+            {"var3_sat",       create<WindowVar<3>, WindowSums<3>>,   "",                                   FlatOpcode::UNSUPPORTED},
+            {"mean4_sat",      create<WindowMean<4>, WindowSums<4>>,  "",                                   FlatOpcode::UNSUPPORTED},
+            {"var4_sat",       create<WindowVar<4>, WindowSums<4>>,   "",                                   FlatOpcode::UNSUPPORTED},
+            {"mean5_sat",      create<WindowMean<5>, WindowSums<5>>,  "",                                   FlatOpcode::UNSUPPORTED},
+            {"var5_sat",       create<WindowVar<5>, WindowSums<5>>,   "",                                   FlatOpcode::UNSUPPORTED},
+
+            // ------------------ double instructions (registers, or features in a double build) ------------------
+            {"minus",          create<Minus, double, double>,         "%0 - %1",                            FlatOpcode::MINUS},
+            {"add",            create<Add, double, double>,           "%0 + %1",                            FlatOpcode::ADD},
+            {"mult",           create<Mult, double, double>,          "%0 * %1",                            FlatOpcode::MULT},
+            {"div",            create<Div, double, double>,           "%0 / %1",                            FlatOpcode::DIV},
+            {"max",            create<Max, double, double>,           "std::max<double>(%0, %1)",           FlatOpcode::MAX},
+            {"exp",            create<Exp, double>,                   "std::exp(%0)",                       FlatOpcode::EXP},
+            {"ln",             create<Ln, double>,                    "std::log(%0)",                       FlatOpcode::LN},
+            {"multByConst",    create<MultByConst, double, Data::Constant>, "%0 * (double) %1",             FlatOpcode::MULT_BY_CONST},
+            {"conv2D",         create<Conv2D, Data::Constant[9], double[3][3]>, "tpg_conv2D(%0, %1, %S1)",  FlatOpcode::UNSUPPORTED},
+
+            // ------------------ float instructions (features in a FEATURES_FLOAT build, Cf. FeatureType.h) ------------------
+            {"minus_f32",      create<Minus, float, float>,           "(double) (%0 - %1)",                 FlatOpcode::MINUS_F32},
+            {"add_f32",        create<Add, float, float>,             "(double) (%0 + %1)",                 FlatOpcode::ADD_F32},
+            {"mult_f32",       create<Mult, float, float>,            "(double) (%0 * %1)",                 FlatOpcode::MULT_F32},
+            {"div_f32",        create<Div, float, float>,             "(double) (%0 / %1)",                 FlatOpcode::DIV_F32},
+            {"max_f32",        create<Max, float, float>,             "(double) std::max<float>(%0, %1)",   FlatOpcode::MAX_F32},
+            {"exp_f32",        create<Exp, float>,                    "(double) std::exp(%0)",              FlatOpcode::EXP_F32},
+            {"ln_f32",         create<Ln, float>,                     "(double) std::log(%0)",              FlatOpcode::LN_F32},
+            {"multByConst_f32", create<MultByConst, float, Data::Constant>, "(double) (%0 * (float) %1)",   FlatOpcode::MULT_BY_CONST_F32}
+    };
+    return available;
+}
+
+std::vector<std::string> InstructionSetFactory::getClassificationNames()
+{
+    return concat({UINT8_NAMES, INTEGRAL_WINDOW_NAMES, DOUBLE_NAMES, {"conv2D_u8"}});
+}
+
+std::vector<std::string> InstructionSetFactory::getPixelWindowNames()
+{
+    return concat({UINT8_NAMES, WINDOW_NAMES, DOUBLE_NAMES, {"conv2D_u8"}});
+}
+
+std::vector<std::string> InstructionSetFactory::getPixelsNames()
+{
+    return concat({UINT8_NAMES, DOUBLE_NAMES, {"conv2D_u8"}});
+}
+
+std::vector<std::string> InstructionSetFactory::getFeaturesNames()
+{
+#ifdef FEATURES_FLOAT
+    return concat({DOUBLE_NAMES, FLOAT_NAMES});
+#else
+    return DOUBLE_NAMES;
+#endif
+}
+
+std::vector<std::string> InstructionSetFactory::getClassificationFeaturesNames()
+{
+#ifdef FEATURES_FLOAT
+    return concat({DOUBLE_NAMES, {"conv2D"}, FLOAT_NAMES});
+#else
+    return concat({DOUBLE_NAMES, {"conv2D"}});
+#endif
+}
+
+InstructionSetFactory::InstructionSetFactory(std::vector<std::string> names)
+        : names(std::move(names))
+{
+    for (const std::string& name : this->names)
+    {
+        const NamedInstruction* entry = nullptr;
+        for (const NamedInstruction& available : InstructionSetFactory::getAvailableInstructions())
+            if (available.name == name)
+                entry = &available;
+        if (entry == nullptr)
+            throw std::runtime_error("InstructionSetFactory: unknown instruction " + name);
+
+        this->entries.push_back(entry);
+        this->instructions.push_back(entry->create());
+        this->set.add(*this->instructions.back());
+    }
+}
+
+const Instructions::Set& InstructionSetFactory::getSet() const { return this->set; }
+
+const std::vector<std::string>& InstructionSetFactory::getNames() const { return this->names; }
+
+std::vector<std::string> InstructionSetFactory::getTemplates() const
+{
+    std::vector<std::string> templates;
+    for (const NamedInstruction* entry : this->entries)
+    {
+        if (entry->codeTemplate.empty())
+            throw std::runtime_error("InstructionSetFactory: instruction " + entry->name + " has no C++ template");
+        templates.push_back(entry->codeTemplate);
+    }
+    return templates;
+}
+
+std::vector<FlatOpcode> InstructionSetFactory::getOpcodes() const
+{
+    std::vector<FlatOpcode> opcodes;
+    for (const NamedInstruction* entry : this->entries)
+    {
+        if (entry->opcode == FlatOpcode::UNSUPPORTED)
+            throw std::runtime_error("InstructionSetFactory: instruction " + entry->name + " can't be flattened");
+        opcodes.push_back(entry->opcode);
+    }
+    return opcodes;
+}
+
+void InstructionSetFactory::writeSignature(const std::string& directory) const
+{
+    std::ofstream file(directory + SIGNATURE_FILE, std::ios::out | std::ios::trunc);
+    if (!file)
+        throw std::runtime_error("File opening failed : " + directory + SIGNATURE_FILE);
+    for (const std::string& name : this->names)
+        file << name << std::endl;
+}
+
+void InstructionSetFactory::checkSignature(const std::string& directory) const
+{
+    std::ifstream file(directory + SIGNATURE_FILE);
+    if (!file)
+        throw std::runtime_error("InstructionSetFactory: no " + SIGNATURE_FILE + " in " + directory + ", the instruction set of its TPGs "
+                                 "can't be checked (write the names of the set used for their training in this file, one per line)");
+
+    std::vector<std::string> trainedNames;
+    std::string name;
+    while (std::getline(file, name))
+        if (!name.empty())
+            trainedNames.push_back(name);
+    if (trainedNames != this->names)
+        throw std::runtime_error("InstructionSetFactory: the TPGs of " + directory + " were trained with another instruction set (Cf. "
+                                 + directory + SIGNATURE_FILE + ")");
+}
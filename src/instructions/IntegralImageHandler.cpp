@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+#include "../../include/instructions/IntegralImageHandler.h"
+
+IntegralImageHandler::IntegralImageHandler(size_t width, size_t height)
+        : width(width), height(height), sums((width + 1) * (height + 1), 0), squareSums((width + 1) * (height + 1), 0)
+{
+}
+
+void IntegralImageHandler::setPixels(const uint8_t* pixels)
+{
+    // The first row and column of the tables stay 0
+    const size_t stride = this->width + 1;
+    for (size_t y = 0; y < this->height; y++)
+    {
+        uint32_t rowSum = 0, rowSquareSum = 0;
+        for (size_t x = 0; x < this->width; x++)
+        {
+            uint32_t pixel = pixels[y * this->width + x];
+            rowSum += pixel;
+            rowSquareSum += pixel * pixel;
+            this->sums[(y + 1) * stride + x + 1] = this->sums[y * stride + x + 1] + rowSum;
+            this->squareSums[(y + 1) * stride + x + 1] = this->squareSums[y * stride + x + 1] + rowSquareSum;
+        }
+    }
+    this->invalidCachedHash = true;
+}
+
+int IntegralImageHandler::getWindowSize(const std::type_info& type)
+{
+    if (type == typeid(WindowSums<2>))
+        return 2;
+    if (type == typeid(WindowSums<3>))
+        return 3;
+    if (type == typeid(WindowSums<4>))
+        return 4;
+    if (type == typeid(WindowSums<5>))
+        return 5;
+    return 0;
+}
+
+uint32_t IntegralImageHandler::getWindowSum(const std::vector<uint32_t>& table, int n, size_t address) const
+{
+    const size_t stride = this->width + 1;
+    size_t x = address % (this->width - n + 1);
+    size_t y = address / (this->width - n + 1);
+    return table[(y + n) * stride + x + n] - table[y * stride + x + n] - table[(y + n) * stride + x] + table[y * stride + x];
+}
+
+template <int N> Data::UntypedSharedPtr IntegralImageHandler::getWindow(size_t address) const
+{
+    // Pointer on the handler storage, not deleted (as the data of a Data::PrimitiveTypeArray)
+    WindowSums<N>& window = std::get<WindowSums<N>>(this->fetchedWindows);
+    window.sum = this->getWindowSum(this->sums, N, address);
+    window.squareSum = this->getWindowSum(this->squareSums, N, address);
+    return Data::UntypedSharedPtr(std::make_shared<Data::UntypedSharedPtr::Model<const WindowSums<N>>>(
+            &window, Data::UntypedSharedPtr::emptyDestructor<const WindowSums<N>>()));
+}
+
+// ------------------ DataHandler ------------------
+bool IntegralImageHandler::canHandle(const std::type_info& type) const
+{
+    return IntegralImageHandler::getWindowSize(type) != 0;
+}
+
+size_t IntegralImageHandler::getAddressSpace(const std::type_info& type) const
+{
+    int n = IntegralImageHandler::getWindowSize(type);
+    if (n == 0)
+        return 0;
+    return (this->width - n + 1) * (this->height - n + 1);
+}
+
+size_t IntegralImageHandler::getLargestAddressSpace() const
+{
+    return this->getAddressSpace(typeid(WindowSums<MIN_WINDOW>));
+}
+
+void IntegralImageHandler::resetData()
+{
+    std::fill(this->sums.begin(), this->sums.end(), 0);
+    std::fill(this->squareSums.begin(), this->squareSums.end(), 0);
+    this->invalidCachedHash = true;
+}
+
+const Data::UntypedSharedPtr IntegralImageHandler::getDataAt(const std::type_info& type, const size_t address) const
+{
+#ifndef NDEBUG
+    if (address >= this->getAddressSpace(type))
+        throw std::out_of_range("Address of a window exceeds the address space of the integral images");
+#endif
+    switch (IntegralImageHandler::getWindowSize(type))
+    {
+        case 2:
+            return this->getWindow<2>(address);
+        case 3:
+            return this->getWindow<3>(address);
+        case 4:
+            return this->getWindow<4>(address);
+        case 5:
+            return this->getWindow<5>(address);
+        default:
+            throw std::invalid_argument("IntegralImageHandler can't provide the type " + std::string(type.name()));
+    }
+}
+
+std::vector<size_t> IntegralImageHandler::getAddressesAccessed(const std::type_info& type, const size_t address) const
+{
+    // Pixels of the window in the CU
+    std::vector<size_t> addresses;
+    int n = IntegralImageHandler::getWindowSize(type);
+    if (n == 0 || address >= this->getAddressSpace(type))
+        return addresses;
+    size_t x = address % (this->width - n + 1);
+    size_t y = address / (this->width - n + 1);
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < n; j++)
+            addresses.push_back((y + i) * this->width + x + j);
+    return addresses;
+}
+
+size_t IntegralImageHandler::updateHash() const
+{
+    // The sums table is enough to identify the pixels of the CU
+    this->cachedHash = std::hash<size_t>()(this->id);
+    for (uint32_t sum : this->sums)
+        this->cachedHash ^= std::hash<uint32_t>()(sum) + 0x9e3779b9 + (this->cachedHash << 6) + (this->cachedHash >> 2);
+    this->invalidCachedHash = false;
+    return this->cachedHash;
+}
+
+Data::DataHandler* IntegralImageHandler::clone() const
+{
+    return new IntegralImageHandler(*this);
+}